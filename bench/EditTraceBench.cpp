@@ -0,0 +1,217 @@
+// Replays the same generated edit trace against every
+// TextStorage backend and reports the time per operation.
+//
+//   bench_edittrace [--size MiB] [--ops n] [--seed n]
+
+#include "PieceTable.hpp"
+#include "Rope.hpp"
+
+// std
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+struct Op {
+    enum class Kind {
+        Insert,
+        Erase,
+        LineStart,
+        Position,
+    };
+
+    Kind kind;
+    size_t offset;
+    size_t length;
+    std::string text;
+};
+
+std::string makeDocument(size_t size, std::mt19937& rng) {
+    std::uniform_int_distribution<size_t> lineLength(20,
+                                                     160);
+    std::string out;
+    out.reserve(size);
+
+    while (out.size() < size) {
+        size_t length = lineLength(rng);
+        out.append(length, 'a' + static_cast<char>(
+                                     length % 26));
+        out.push_back('\n');
+    }
+
+    out.resize(size);
+    return out;
+}
+
+// Bursts of typing at random places, with some deletes,
+// pastes and cursor-style lookups mixed in. Offsets are
+// generated against a simulated document size so every
+// backend sees exactly the same operations.
+std::vector<Op> makeTrace(size_t documentSize, size_t count,
+                          std::mt19937& rng) {
+    std::vector<Op> ops;
+    size_t size = documentSize;
+    size_t lines = documentSize / 90 + 1;
+
+    while (ops.size() < count) {
+        int kind = static_cast<int>(rng() % 100);
+        size_t offset = size == 0 ? 0 : rng() % size;
+
+        if (kind < 50) {
+            for (int i = 0; i < 16 && ops.size() < count;
+                 i++) {
+                ops.push_back({Op::Kind::Insert, offset + i, 1,
+                               i % 8 == 7 ? "\n" : "x"});
+                size++;
+            }
+        } else if (kind < 65) {
+            size_t length = std::min<size_t>(
+                1 + rng() % 64, size - offset);
+            ops.push_back(
+                {Op::Kind::Erase, offset, length, {}});
+            size -= length;
+        } else if (kind < 70) {
+            std::string text(1 + rng() % 4096, 'p');
+            text[text.size() / 2] = '\n';
+            ops.push_back({Op::Kind::Insert, offset,
+                           text.size(), text});
+            size += text.size();
+        } else if (kind < 85) {
+            ops.push_back({Op::Kind::LineStart, rng() % lines,
+                           0,
+                           {}});
+        } else {
+            ops.push_back(
+                {Op::Kind::Position, offset, 0, {}});
+        }
+    }
+
+    return ops;
+}
+
+struct Result {
+    double loadSeconds;
+    double replaySeconds;
+    size_t memory;
+    size_t lookups;
+    size_t checksum;
+};
+
+Result replay(TextStorage& storage,
+              const std::string& document,
+              const std::vector<Op>& ops) {
+    Result result{};
+    size_t sink = 0;
+
+    auto start = std::chrono::steady_clock::now();
+    storage.load(FileBuffer{document});
+    auto loaded = std::chrono::steady_clock::now();
+
+    for (const auto& op : ops) {
+        switch (op.kind) {
+            case Op::Kind::Insert:
+                storage.insert(op.offset, op.text);
+                break;
+            case Op::Kind::Erase:
+                storage.erase(op.offset, op.length);
+                break;
+            case Op::Kind::LineStart:
+                sink += storage.lineStart(
+                    op.offset % storage.lineCount());
+                break;
+            case Op::Kind::Position:
+                sink += storage.positionOf(op.offset).column;
+                break;
+        }
+    }
+
+    auto end = std::chrono::steady_clock::now();
+
+    result.loadSeconds =
+        std::chrono::duration<double>(loaded - start).count();
+    result.replaySeconds =
+        std::chrono::duration<double>(end - loaded).count();
+    result.memory = storage.memoryUsage();
+    result.lookups = sink;
+
+    std::string text;
+    storage.copy(0, storage.size(), text);
+    result.checksum = std::hash<std::string>{}(text);
+
+    return result;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    size_t size = 64;
+    size_t count = 200000;
+    uint32_t seed = 1;
+
+    for (int i = 1; i + 1 < argc; i += 2) {
+        std::string arg = argv[i];
+
+        if (arg == "--size") {
+            size = std::strtoull(argv[i + 1], nullptr, 10);
+        } else if (arg == "--ops") {
+            count = std::strtoull(argv[i + 1], nullptr, 10);
+        } else if (arg == "--seed") {
+            seed = static_cast<uint32_t>(
+                std::strtoul(argv[i + 1], nullptr, 10));
+        }
+    }
+
+    std::mt19937 rng(seed);
+    std::string document = makeDocument(size << 20, rng);
+    std::vector<Op> ops = makeTrace(document.size(), count, rng);
+
+    struct Backend {
+        const char* name;
+        std::unique_ptr<TextStorage> storage;
+    };
+
+    Backend backends[] = {
+        {"piece-table", std::make_unique<PieceTable>()},
+        {"rope", std::make_unique<Rope>()},
+    };
+
+    std::printf("document: %zu bytes, trace: %zu ops\n",
+                document.size(), ops.size());
+    std::printf("%-12s %10s %12s %12s %18s\n", "backend",
+                "load ms", "replay ms", "ns/op", "memory bytes");
+
+    size_t expected = 0;
+
+    for (auto& backend : backends) {
+        Result result =
+            replay(*backend.storage, document, ops);
+
+        std::printf("%-12s %10.2f %12.2f %12.1f %18zu\n",
+                    backend.name, result.loadSeconds * 1e3,
+                    result.replaySeconds * 1e3,
+                    result.replaySeconds * 1e9 /
+                        static_cast<double>(ops.size()),
+                    result.memory);
+
+        // Every backend must end up with the same text and
+        // have answered the same lookups.
+        if (expected == 0) {
+            expected = result.checksum ^ result.lookups;
+        } else if (expected !=
+                   (result.checksum ^ result.lookups)) {
+            std::fprintf(stderr,
+                         "ERROR: %s diverged from the first "
+                         "backend\n",
+                         backend.name);
+            return EXIT_FAILURE;
+        }
+    }
+
+    return EXIT_SUCCESS;
+}
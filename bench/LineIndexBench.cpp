@@ -0,0 +1,140 @@
+// Measures the throughput of the LineIndex newline scanning
+// kernels on synthetic buffers and on real files.
+//
+//   bench_lineindex [--size MiB] [--runs n] [file...]
+
+#include "FileBuffer.hpp"
+#include "LineIndex.hpp"
+
+// c std
+#include <errno.h>
+#include <string.h>
+
+// std
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+struct Input {
+    std::string name;
+    FileBuffer buffer;
+};
+
+// Lines with lengths drawn from [0, maxLine], which makes
+// the newline density (and so the branchiness of the mask
+// walk) controllable.
+std::string makeSynthetic(size_t size, size_t maxLine,
+                          uint32_t seed) {
+    std::mt19937 rng(seed);
+    std::uniform_int_distribution<size_t> lineLength(
+        0, maxLine);
+    std::string out(size, 'x');
+
+    size_t position = lineLength(rng);
+
+    while (position < size) {
+        out[position] = '\n';
+        position += lineLength(rng) + 1;
+    }
+
+    return out;
+}
+
+double measure(const Input& input, LineIndex::Kernel kernel,
+               int runs, size_t& lines) {
+    double best = 0.0;
+
+    for (int run = 0; run < runs; run++) {
+        LineIndex index;
+
+        auto start = std::chrono::steady_clock::now();
+        index.build(input.buffer.data(), input.buffer.size(),
+                    kernel);
+        auto end = std::chrono::steady_clock::now();
+
+        double seconds =
+            std::chrono::duration<double>(end - start)
+                .count();
+        double gbPerSecond =
+            static_cast<double>(input.buffer.size()) /
+            seconds / 1e9;
+
+        best = std::max(best, gbPerSecond);
+        lines = index.lineCount();
+    }
+
+    return best;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    size_t size = 256;
+    int runs = 5;
+    std::vector<Input> files;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+
+        if (arg == "--size" && i + 1 < argc) {
+            size = std::strtoull(argv[++i], nullptr, 10);
+        } else if (arg == "--runs" && i + 1 < argc) {
+            runs = std::max(1, std::atoi(argv[++i]));
+        } else {
+            Input input{arg, FileBuffer{}};
+
+            if (input.buffer.open(arg) < 0) {
+                std::fprintf(stderr,
+                             "ERROR: Couldn't open %s: %s\n",
+                             arg.c_str(), strerror(errno));
+                return EXIT_FAILURE;
+            }
+
+            files.push_back(std::move(input));
+        }
+    }
+
+    size_t bytes = size * 1024 * 1024;
+
+    std::vector<Input> inputs;
+    inputs.push_back({"synthetic-log",
+                      FileBuffer{makeSynthetic(bytes, 160, 1)}});
+    inputs.push_back({"synthetic-dense",
+                      FileBuffer{makeSynthetic(bytes, 8, 2)}});
+    inputs.push_back(
+        {"synthetic-sparse",
+         FileBuffer{makeSynthetic(bytes, 4096, 3)}});
+
+    for (auto& file : files) {
+        inputs.push_back(std::move(file));
+    }
+
+    std::printf("best kernel: %s\n",
+                LineIndex::kernelName(LineIndex::bestKernel()));
+    std::printf("%-24s %-8s %12s %12s %10s\n", "input",
+                "kernel", "bytes", "lines", "GB/s");
+
+    for (const auto& input : inputs) {
+        for (auto kernel : {LineIndex::Kernel::Scalar,
+                            LineIndex::Kernel::Sse2,
+                            LineIndex::Kernel::Avx2}) {
+            size_t lines = 0;
+            double gbPerSecond =
+                measure(input, kernel, runs, lines);
+
+            std::printf("%-24s %-8s %12zu %12zu %10.2f\n",
+                        input.name.c_str(),
+                        LineIndex::kernelName(kernel),
+                        input.buffer.size(), lines,
+                        gbPerSecond);
+        }
+    }
+
+    return EXIT_SUCCESS;
+}
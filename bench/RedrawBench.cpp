@@ -0,0 +1,325 @@
+// Measures how much CPU the main loop burns while the
+// editor is idle and while the user types, for three loop
+// policies:
+//
+//   spin       poll for events and redraw as fast as
+//              possible, what a bare glfwPollEvents loop
+//              does
+//   vsync      poll and redraw every refresh, blocking in
+//              present like a FIFO swap chain
+//   scheduled  wait for events and only draw the frames the
+//              RedrawScheduler asks for
+//
+// Windowing and the GPU are simulated: a frame lays out
+// the visible lines of a FileView, presenting sleeps until
+// the next refresh and waiting for events sleeps until the
+// next simulated keystroke.
+//
+//   bench_redraw [--seconds n] [--refresh hz]
+//                [--keys-per-second n] [--seed n]
+
+#include "FileView.hpp"
+#include "RedrawScheduler.hpp"
+#include "Utf8.hpp"
+
+// c std
+#include <time.h>
+
+// std
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+constexpr size_t kVisibleLines = 50;
+
+struct Options {
+    // Half of it idle, half of it typing.
+    double seconds = 4.0;
+    double refresh = 60.0;
+    double keysPerSecond = 10.0;
+    unsigned seed = 1;
+};
+
+struct Phase {
+    double cpu = 0.0;
+    double wall = 0.0;
+    size_t frames = 0;
+    size_t wakeups = 0;
+};
+
+struct Result {
+    Phase idle;
+    Phase typing;
+};
+
+using Clock = std::chrono::steady_clock;
+
+double cpuSeconds() {
+    timespec ts;
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+    return static_cast<double>(ts.tv_sec) +
+           static_cast<double>(ts.tv_nsec) * 1e-9;
+}
+
+class Session {
+   public:
+    Session(const Options& options, double start)
+        : m_options(options), m_start(start) {
+        std::mt19937 rng(options.seed);
+        std::string document;
+
+        for (size_t line = 0; line < 2000; line++) {
+            document.append(20 + rng() % 80,
+                            'a' + static_cast<char>(line % 26));
+            document.push_back('\n');
+        }
+
+        m_view.insertText(document);
+        m_view.jumpToLine(10);
+
+        // Keystrokes in bursts of a few words with pauses
+        // for thinking in between.
+        std::exponential_distribution<double> gap(
+            options.keysPerSecond);
+        double t = start + options.seconds / 2;
+
+        while (t < start + options.seconds) {
+            m_keys.push_back(t);
+            t += gap(rng);
+
+            if (rng() % 30 == 0) {
+                t += 1.0;
+            }
+        }
+    }
+
+    double typingStart() const {
+        return m_start + m_options.seconds / 2;
+    }
+    double end() const {
+        return m_start + m_options.seconds;
+    }
+    double nextKey() const {
+        return m_next < m_keys.size() ? m_keys[m_next]
+                                      : end();
+    }
+
+    // Applies the keystrokes due by now and returns how
+    // many there were.
+    size_t takeKeys(double now) {
+        size_t count = 0;
+
+        while (m_next < m_keys.size() &&
+               m_keys[m_next] <= now) {
+            m_view.insertText("x");
+            m_next++;
+            count++;
+        }
+
+        return count;
+    }
+
+    // Stand-in for the work of a frame: decoding every
+    // visible character as the glyph layout does.
+    void drawFrame() {
+        size_t first = m_view.cursorY() > kVisibleLines / 2
+                           ? m_view.cursorY() -
+                                 kVisibleLines / 2
+                           : 0;
+        size_t last = std::min(first + kVisibleLines,
+                               m_view.lineCount());
+
+        for (size_t line = first; line < last; line++) {
+            std::string text = m_view.line(line);
+            size_t offset = 0;
+
+            while (offset < text.size()) {
+                size_t length;
+                m_checksum += utf8::decode(
+                    text.data() + offset,
+                    text.size() - offset, length);
+                offset += length;
+            }
+        }
+    }
+
+    uint64_t checksum() const {
+        return m_checksum;
+    }
+
+   private:
+    const Options& m_options;
+    double m_start;
+    FileView m_view;
+    std::vector<double> m_keys;
+    size_t m_next = 0;
+    uint64_t m_checksum = 0;
+};
+
+double now() {
+    return std::chrono::duration<double>(
+               Clock::now().time_since_epoch())
+        .count();
+}
+
+void sleepUntil(double time) {
+    double remaining = time - now();
+
+    if (remaining > 0.0) {
+        std::this_thread::sleep_for(
+            std::chrono::duration<double>(remaining));
+    }
+}
+
+// Blocks like vkQueuePresentKHR on a FIFO swap chain.
+void present(double refresh) {
+    double period = 1.0 / refresh;
+    sleepUntil((std::floor(now() / period) + 1.0) * period);
+}
+
+enum class Mode { Spin, Vsync, Scheduled };
+
+Result run(Mode mode, const Options& options) {
+    Session session(options, now() + 0.05);
+    RedrawScheduler scheduler;
+    Result result;
+
+    sleepUntil(session.typingStart() - options.seconds / 2);
+
+    double phaseCpu = cpuSeconds();
+    double phaseWall = now();
+    Phase* phase = &result.idle;
+    double t = now();
+
+    scheduler.restartBlink(t);
+
+    while (t < session.end()) {
+        if (phase == &result.idle &&
+            t >= session.typingStart()) {
+            phase->cpu = cpuSeconds() - phaseCpu;
+            phase->wall = t - phaseWall;
+            phaseCpu = cpuSeconds();
+            phaseWall = t;
+            phase = &result.typing;
+        }
+
+        if (mode == Mode::Scheduled) {
+            double wake = std::min(
+                {t + scheduler.timeout(t),
+                 session.nextKey(), session.end()});
+
+            if (phase == &result.idle) {
+                wake = std::min(wake,
+                                session.typingStart());
+            }
+
+            sleepUntil(wake);
+            t = now();
+        }
+
+        phase->wakeups++;
+
+        if (session.takeKeys(t) > 0) {
+            scheduler.invalidate(RedrawScheduler::kText);
+            scheduler.restartBlink(t);
+        }
+
+        if (mode != Mode::Scheduled ||
+            scheduler.needsFrame(t)) {
+            session.drawFrame();
+
+            if (mode != Mode::Spin) {
+                present(options.refresh);
+            }
+
+            scheduler.frameDrawn(t);
+            phase->frames++;
+        }
+
+        t = now();
+    }
+
+    phase->cpu = cpuSeconds() - phaseCpu;
+    phase->wall = t - phaseWall;
+
+    if (session.checksum() == 0) {
+        std::fprintf(stderr, "nothing was drawn\n");
+    }
+
+    return result;
+}
+
+void printPhase(const char* name, const Phase& phase,
+                bool last) {
+    std::printf(
+        "      \"%s\": {\"cpu_percent\": %.2f, "
+        "\"frames_per_second\": %.1f, "
+        "\"wakeups_per_second\": %.1f}%s\n",
+        name, 100.0 * phase.cpu / phase.wall,
+        phase.frames / phase.wall,
+        phase.wakeups / phase.wall, last ? "" : ",");
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    Options options;
+
+    for (int i = 1; i + 1 < argc; i += 2) {
+        std::string arg = argv[i];
+
+        if (arg == "--seconds") {
+            options.seconds = std::atof(argv[i + 1]);
+        } else if (arg == "--refresh") {
+            options.refresh = std::atof(argv[i + 1]);
+        } else if (arg == "--keys-per-second") {
+            options.keysPerSecond = std::atof(argv[i + 1]);
+        } else if (arg == "--seed") {
+            options.seed = static_cast<unsigned>(
+                std::atoi(argv[i + 1]));
+        } else {
+            std::fprintf(stderr, "unknown option %s\n",
+                         argv[i]);
+            return 1;
+        }
+    }
+
+    const struct {
+        const char* name;
+        Mode mode;
+    } modes[] = {
+        {"spin", Mode::Spin},
+        {"vsync", Mode::Vsync},
+        {"scheduled", Mode::Scheduled},
+    };
+
+    std::printf("{\n  \"seconds\": %.1f,\n"
+                "  \"refresh_hz\": %.0f,\n"
+                "  \"keys_per_second\": %.1f,\n"
+                "  \"modes\": [\n",
+                options.seconds, options.refresh,
+                options.keysPerSecond);
+
+    for (size_t i = 0; i < std::size(modes); i++) {
+        Result result = run(modes[i].mode, options);
+
+        std::printf("    {\n      \"mode\": \"%s\",\n",
+                    modes[i].name);
+        printPhase("idle", result.idle, false);
+        printPhase("typing", result.typing, true);
+        std::printf("    }%s\n",
+                    i + 1 < std::size(modes) ? "," : "");
+        std::fflush(stdout);
+    }
+
+    std::printf("  ]\n}\n");
+    return 0;
+}
@@ -0,0 +1,150 @@
+// Measures how fast the text renderer draws a screen full
+// of glyphs, against the number of glyphs on it.
+//
+// Renders offscreen on a headless device, so it runs
+// without a window or display, including on lavapipe. Every
+// frame is laid out, recorded, submitted and waited for,
+// once without reading the image back and once with, so
+// the frame rate includes the CPU side of a frame but no
+// presentation. The screen is filled with lines of
+// printable ASCII, growing the number of columns.
+//
+//   bench_render [--frames n] [--width px] [--height px]
+//
+// Set EDITOR_FONT to compare runs on different machines.
+// The JSON goes to stdout, the device's setup log to
+// stderr.
+
+#include "VeHeadlessRenderer.hpp"
+
+// std
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+namespace {
+
+struct Options {
+    int frames = 300;
+    uint32_t width = 800;
+    uint32_t height = 600;
+};
+
+struct Result {
+    size_t glyphs = 0;
+    double framesPerSecond = 0.0;
+    double readbackFramesPerSecond = 0.0;
+};
+
+double now() {
+    return std::chrono::duration<double>(
+               std::chrono::steady_clock::now()
+                   .time_since_epoch())
+        .count();
+}
+
+std::vector<std::string> screen(size_t lines,
+                                size_t columns) {
+    std::vector<std::string> text(lines);
+
+    for (size_t line = 0; line < lines; line++) {
+        for (size_t column = 0; column < columns;
+             column++) {
+            text[line].push_back(static_cast<char>(
+                '!' + (line * 7 + column) % ('~' - '!')));
+        }
+    }
+
+    return text;
+}
+
+double framesPerSecond(
+    ve::VeHeadlessRenderer& renderer,
+    const std::vector<std::string>& text, int frames,
+    bool readback) {
+    // Uploads the glyphs and warms up the driver.
+    renderer.render(text, readback);
+
+    double start = now();
+
+    for (int i = 0; i < frames; i++) {
+        renderer.render(text, readback);
+    }
+
+    return frames / (now() - start);
+}
+
+Result run(ve::VeHeadlessRenderer& renderer,
+           size_t columns, const Options& options) {
+    std::vector<std::string> text =
+        screen(renderer.visibleLines(), columns);
+
+    Result result;
+    result.glyphs = renderer.render(text);
+    result.framesPerSecond = framesPerSecond(
+        renderer, text, options.frames, false);
+    result.readbackFramesPerSecond = framesPerSecond(
+        renderer, text, options.frames, true);
+    return result;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    Options options;
+
+    for (int i = 1; i < argc; i += 2) {
+        std::string arg = argv[i];
+
+        if (i + 1 == argc) {
+            std::fprintf(stderr, "missing value for %s\n",
+                         argv[i]);
+            return 1;
+        }
+
+        if (arg == "--frames") {
+            options.frames = std::atoi(argv[i + 1]);
+        } else if (arg == "--width") {
+            options.width = static_cast<uint32_t>(
+                std::atoi(argv[i + 1]));
+        } else if (arg == "--height") {
+            options.height = static_cast<uint32_t>(
+                std::atoi(argv[i + 1]));
+        } else {
+            std::fprintf(stderr, "unknown option %s\n",
+                         argv[i]);
+            return 1;
+        }
+    }
+
+    ve::VeHeadlessRenderer renderer{
+        {options.width, options.height}};
+
+    // The last ones are cut off at the right edge, which
+    // still costs the layout.
+    const size_t columns[] = {0, 10, 20, 40, 80, 160};
+
+    std::printf("{\n  \"width\": %u,\n  \"height\": %u,\n"
+                "  \"frames\": %d,\n  \"runs\": [\n",
+                options.width, options.height,
+                options.frames);
+
+    for (size_t i = 0; i < std::size(columns); i++) {
+        Result result = run(renderer, columns[i], options);
+
+        std::printf(
+            "    {\"columns\": %zu, \"glyphs\": %zu, "
+            "\"frames_per_second\": %.1f, "
+            "\"readback_frames_per_second\": %.1f}%s\n",
+            columns[i], result.glyphs,
+            result.framesPerSecond,
+            result.readbackFramesPerSecond,
+            i + 1 < std::size(columns) ? "," : "");
+        std::fflush(stdout);
+    }
+
+    std::printf("  ]\n}\n");
+    return 0;
+}
@@ -0,0 +1,273 @@
+// End to end benchmark of the text buffer subsystem through
+// FileView: open, random edits, line lookups, a cursor sweep
+// and the memory used, for every backend on generated files
+// of growing size. Runs headless and prints JSON.
+//
+//   bench_textbuffer [--sizes MiB,MiB,...] [--ops n]
+//                    [--dir path] [--seed n]
+
+#include "FileView.hpp"
+
+// c std
+#include <unistd.h>
+
+// std
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// Keeps the lookups from being optimized away.
+volatile size_t g_sink;
+
+double nanoseconds(Clock::time_point start) {
+    return std::chrono::duration<double, std::nano>(
+               Clock::now() - start)
+        .count();
+}
+
+// Writes size bytes of source-code-like lines, with some
+// multibyte text mixed in, a block at a time so even the
+// largest inputs never have to fit in memory.
+bool generate(const std::string& path, size_t size,
+              uint32_t seed) {
+    FILE* file = std::fopen(path.c_str(), "wb");
+
+    if (file == nullptr) {
+        return false;
+    }
+
+    std::mt19937 rng(seed);
+    std::uniform_int_distribution<size_t> lineLength(0, 120);
+    std::string block;
+    size_t written = 0;
+
+    while (written < size) {
+        block.clear();
+
+        while (block.size() < (1 << 20)) {
+            size_t length = lineLength(rng);
+            block.append(length % 8, ' ');
+            block.append(length - length % 8,
+                         'a' + static_cast<char>(length % 26));
+
+            if (length % 17 == 0) {
+                block.append("\xc3\xa9\xe4\xb8\xad");
+            }
+
+            block.push_back('\n');
+        }
+
+        size_t take = std::min(block.size(), size - written);
+
+        if (std::fwrite(block.data(), 1, take, file) != take) {
+            std::fclose(file);
+            return false;
+        }
+
+        written += take;
+    }
+
+    return std::fclose(file) == 0;
+}
+
+struct Result {
+    double openNs = 0;
+    double indexNs = 0;
+    size_t lines = 0;
+    double editNs = 0;
+    double lookupNs = 0;
+    double sweepNs = 0;
+    size_t textMemory = 0;
+    size_t memory = 0;
+};
+
+double perOp(double ns, size_t ops) {
+    return ops == 0 ? 0 : ns / static_cast<double>(ops);
+}
+
+Result run(FileView::Backend backend, const std::string& path,
+           size_t ops, uint32_t seed) {
+    Result result;
+    FileView view(backend);
+
+    // Time to first screen, then until every line is known.
+    auto start = Clock::now();
+
+    if (view.openFile(path) < 0) {
+        std::exit(EXIT_FAILURE);
+    }
+
+    view.line(0);
+    result.openNs = nanoseconds(start);
+
+    result.lines = view.lineCount();
+    result.indexNs = nanoseconds(start);
+
+    std::mt19937 rng(seed);
+    size_t sink = 0;
+
+    // Random single character inserts and deletes, each at
+    // a freshly jumped to line.
+    start = Clock::now();
+
+    for (size_t i = 0; i < ops; i++) {
+        view.jumpToLine(rng() % result.lines);
+        view.cursorRight();
+
+        if (i % 2 == 0) {
+            view.insertText("x");
+        } else {
+            view.deleteBackward();
+        }
+    }
+
+    result.editNs = perOp(nanoseconds(start), ops);
+
+    start = Clock::now();
+
+    for (size_t i = 0; i < ops; i++) {
+        sink += view.line(rng() % result.lines).size();
+    }
+
+    result.lookupNs = perOp(nanoseconds(start), ops);
+
+    // Walk down a stretch of the file the way scrolling
+    // with the arrow keys does.
+    size_t steps = std::min(ops, result.lines - 1);
+    view.jumpToLine(rng() % (result.lines - steps));
+
+    start = Clock::now();
+
+    for (size_t i = 0; i < steps; i++) {
+        view.cursorDown();
+        sink += view.cursorX();
+    }
+
+    result.sweepNs = perOp(nanoseconds(start), steps);
+
+    // After the edits, so the undo history is included.
+    result.textMemory = view.text().memoryUsage();
+    result.memory = view.memoryUsage();
+    g_sink = sink;
+
+    return result;
+}
+
+// Empty if list isn't a comma separated list of numbers.
+std::vector<size_t> parseSizes(const char* list) {
+    std::vector<size_t> sizes;
+    char* end = nullptr;
+
+    for (const char* cursor = list;; cursor = end + 1) {
+        sizes.push_back(std::strtoull(cursor, &end, 10));
+
+        if (end == cursor || (*end != ',' && *end != '\0')) {
+            return {};
+        }
+
+        if (*end == '\0') {
+            return sizes;
+        }
+    }
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    std::vector<size_t> sizes = {1, 16, 256, 1024, 4096};
+    size_t ops = 100000;
+    std::string dir = "/tmp";
+    uint32_t seed = 1;
+
+    for (int i = 1; i < argc; i += 2) {
+        std::string arg = argv[i];
+
+        if (i + 1 == argc) {
+            std::fprintf(stderr, "missing value for %s\n",
+                         argv[i]);
+            return EXIT_FAILURE;
+        }
+
+        if (arg == "--sizes") {
+            sizes = parseSizes(argv[i + 1]);
+        } else if (arg == "--ops") {
+            ops = std::strtoull(argv[i + 1], nullptr, 10);
+        } else if (arg == "--dir") {
+            dir = argv[i + 1];
+        } else if (arg == "--seed") {
+            seed = static_cast<uint32_t>(
+                std::strtoul(argv[i + 1], nullptr, 10));
+        } else {
+            std::fprintf(stderr, "unknown option %s\n",
+                         argv[i]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    if (sizes.empty()) {
+        std::fprintf(stderr, "bad --sizes list\n");
+        return EXIT_FAILURE;
+    }
+
+    struct Backend {
+        const char* name;
+        FileView::Backend backend;
+    };
+
+    const Backend backends[] = {
+        {"piece-table", FileView::Backend::PieceTable},
+        {"rope", FileView::Backend::Rope},
+    };
+
+    std::printf("{\n  \"benchmark\": \"textbuffer\",\n"
+                "  \"ops\": %zu,\n  \"results\": [",
+                ops);
+
+    const char* separator = "\n";
+
+    for (size_t size : sizes) {
+        std::string path = dir + "/bench_textbuffer_" +
+                           std::to_string(size) + ".txt";
+
+        if (!generate(path, size << 20, seed)) {
+            std::fprintf(stderr,
+                         "ERROR: Couldn't write %s\n",
+                         path.c_str());
+            return EXIT_FAILURE;
+        }
+
+        for (const auto& backend : backends) {
+            Result result = run(backend.backend, path, ops,
+                                seed);
+
+            std::printf(
+                "%s    {\"backend\": \"%s\", \"bytes\": %zu, "
+                "\"lines\": %zu, \"open_ms\": %.3f, "
+                "\"index_ms\": %.3f, \"edit_ns\": %.1f, "
+                "\"lookup_ns\": %.1f, \"sweep_ns\": %.1f, "
+                "\"text_memory_bytes\": %zu, "
+                "\"memory_bytes\": %zu}",
+                separator, backend.name, size << 20,
+                result.lines, result.openNs / 1e6,
+                result.indexNs / 1e6, result.editNs,
+                result.lookupNs, result.sweepNs,
+                result.textMemory, result.memory);
+            std::fflush(stdout);
+
+            separator = ",\n";
+        }
+
+        unlink(path.c_str());
+    }
+
+    std::printf("\n  ]\n}\n");
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,216 @@
+// Measures what recording undo history adds to every
+// keystroke, and how long undoing and redoing all of it
+// takes, on a large document.
+//
+//   bench_undo [--size MiB] [--keys n] [--seed n]
+
+#include "PieceTable.hpp"
+#include "Rope.hpp"
+#include "UndoHistory.hpp"
+
+// std
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+struct Key {
+    size_t offset;
+    // Backspace when zero.
+    char c;
+    // Cursor jumped here, so a new undo group starts.
+    bool jump;
+};
+
+std::string makeDocument(size_t size, std::mt19937& rng) {
+    std::uniform_int_distribution<size_t> lineLength(20,
+                                                     160);
+    std::string out;
+    out.reserve(size);
+
+    while (out.size() < size) {
+        size_t length = lineLength(rng);
+        out.append(length, 'a' + static_cast<char>(
+                                     length % 26));
+        out.push_back('\n');
+    }
+
+    out.resize(size);
+    return out;
+}
+
+// Bursts of typing at random places, some of them fixed up
+// with a few backspaces.
+std::vector<Key> makeKeys(size_t documentSize, size_t count,
+                          std::mt19937& rng) {
+    std::vector<Key> keys;
+    size_t size = documentSize;
+
+    while (keys.size() < count) {
+        size_t offset = rng() % size;
+        size_t burst = 4 + rng() % 60;
+
+        for (size_t i = 0; i < burst && keys.size() < count;
+             i++) {
+            keys.push_back({offset++, i % 40 == 39 ? '\n' : 'x',
+                            i == 0});
+            size++;
+        }
+
+        for (size_t i = rng() % 4; i > 0; i--) {
+            keys.push_back({--offset, 0, false});
+            size--;
+        }
+    }
+
+    return keys;
+}
+
+double seconds(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(
+               std::chrono::steady_clock::now() - start)
+        .count();
+}
+
+size_t checksum(const TextStorage& storage) {
+    std::string text;
+    storage.copy(0, storage.size(), text);
+    return std::hash<std::string>{}(text);
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    size_t size = 500;
+    size_t count = 200000;
+    uint32_t seed = 1;
+
+    for (int i = 1; i + 1 < argc; i += 2) {
+        std::string arg = argv[i];
+
+        if (arg == "--size") {
+            size = std::strtoull(argv[i + 1], nullptr, 10);
+        } else if (arg == "--keys") {
+            count = std::strtoull(argv[i + 1], nullptr, 10);
+        } else if (arg == "--seed") {
+            seed = static_cast<uint32_t>(
+                std::strtoul(argv[i + 1], nullptr, 10));
+        }
+    }
+
+    std::mt19937 rng(seed);
+    std::string document = makeDocument(size << 20, rng);
+    std::vector<Key> keys = makeKeys(document.size(), count, rng);
+    size_t original = std::hash<std::string>{}(document);
+
+    using Factory = std::function<std::unique_ptr<TextStorage>()>;
+
+    struct Backend {
+        const char* name;
+        Factory make;
+    };
+
+    Backend backends[] = {
+        {"piece-table",
+         [] { return std::make_unique<PieceTable>(); }},
+        {"rope", [] { return std::make_unique<Rope>(); }},
+    };
+
+    std::printf("document: %zu bytes, keys: %zu\n",
+                document.size(), keys.size());
+    std::printf("%-12s %10s %10s %10s %8s %14s %10s %10s\n",
+                "backend", "plain ns", "undo ns", "overhead",
+                "groups", "history bytes", "undo ms",
+                "redo ms");
+
+    for (auto& backend : backends) {
+        // Same keys twice, straight into the storage and
+        // through the history.
+        auto plain = backend.make();
+        plain->load(FileBuffer{document});
+        plain->lineCount();
+
+        auto start = std::chrono::steady_clock::now();
+
+        for (const auto& key : keys) {
+            if (key.c != 0) {
+                plain->insert(key.offset,
+                              std::string_view(&key.c, 1));
+            } else {
+                plain->erase(key.offset, 1);
+            }
+        }
+
+        double plainSeconds = seconds(start);
+        size_t edited = checksum(*plain);
+        plain.reset();
+
+        auto text = backend.make();
+        text->load(FileBuffer{document});
+        text->lineCount();
+
+        UndoHistory history(size_t{1} << 30);
+        start = std::chrono::steady_clock::now();
+
+        for (const auto& key : keys) {
+            if (key.jump) {
+                history.breakGroup();
+            }
+
+            if (key.c != 0) {
+                history.insert(*text, key.offset,
+                               std::string_view(&key.c, 1));
+            } else {
+                history.erase(*text, key.offset, 1);
+            }
+        }
+
+        double historySeconds = seconds(start);
+        size_t groups = history.undoCount();
+        size_t memory = history.memoryUsage();
+
+        start = std::chrono::steady_clock::now();
+
+        while (history.canUndo()) {
+            history.undo(*text);
+        }
+
+        double undoSeconds = seconds(start);
+        bool restored = checksum(*text) == original;
+
+        start = std::chrono::steady_clock::now();
+
+        while (history.canRedo()) {
+            history.redo(*text);
+        }
+
+        double redoSeconds = seconds(start);
+        bool replayed = checksum(*text) == edited;
+
+        double perKey = 1e9 / static_cast<double>(keys.size());
+
+        std::printf(
+            "%-12s %10.1f %10.1f %10.1f %8zu %14zu %10.2f "
+            "%10.2f\n",
+            backend.name, plainSeconds * perKey,
+            historySeconds * perKey,
+            (historySeconds - plainSeconds) * perKey, groups,
+            memory, undoSeconds * 1e3, redoSeconds * 1e3);
+
+        if (!restored || !replayed) {
+            std::fprintf(stderr,
+                         "ERROR: %s didn't %s the document\n",
+                         backend.name,
+                         restored ? "redo" : "restore");
+            return EXIT_FAILURE;
+        }
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,18 @@
+#version 450
+
+layout(location = 0) in vec2 fragUv;
+layout(location = 1) flat in uint fragColorIndex;
+
+layout(location = 0) out vec4 outColor;
+
+layout(set = 0, binding = 0) uniform sampler2D atlas;
+layout(set = 0, binding = 1) uniform Palette {
+  vec4 colors[16];
+} palette;
+
+void main() {
+  float coverage = texture(atlas, fragUv).r;
+  vec4 color = palette.colors[fragColorIndex];
+
+  outColor = vec4(color.rgb, color.a * coverage);
+}
@@ -0,0 +1,28 @@
+#version 450
+
+// One instance per glyph, the quad corners come from
+// gl_VertexIndex so no vertex buffer is bound for them.
+layout(location = 0) in ivec2 position;
+layout(location = 1) in uvec2 atlasPosition;
+layout(location = 2) in uvec2 size;
+layout(location = 3) in uint colorIndex;
+
+layout(location = 0) out vec2 fragUv;
+layout(location = 1) flat out uint fragColorIndex;
+
+layout(push_constant) uniform Push {
+  vec2 viewportSize;
+  vec2 atlasSize;
+  // Screen pixels per atlas pixel, 1 unless the atlas
+  // holds distance fields.
+  float scale;
+} push;
+
+void main() {
+  vec2 corner = vec2(gl_VertexIndex & 1, gl_VertexIndex >> 1);
+  vec2 pixel = vec2(position) + corner * vec2(size) * push.scale;
+
+  gl_Position = vec4(pixel / push.viewportSize * 2.0 - 1.0, 0.0, 1.0);
+  fragUv = (vec2(atlasPosition) + corner * vec2(size)) / push.atlasSize;
+  fragColorIndex = colorIndex;
+}
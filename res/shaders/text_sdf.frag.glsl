@@ -0,0 +1,24 @@
+#version 450
+
+layout(location = 0) in vec2 fragUv;
+layout(location = 1) flat in uint fragColorIndex;
+
+layout(location = 0) out vec4 outColor;
+
+// Signed distance fields, 0.5 on the outline and larger
+// inside, see GlyphMode::Distance.
+layout(set = 0, binding = 0) uniform sampler2D atlas;
+layout(set = 0, binding = 1) uniform Palette {
+  vec4 colors[16];
+} palette;
+
+void main() {
+  float signedDistance = texture(atlas, fragUv).r - 128.0 / 255.0;
+  // How much the distance changes over one screen pixel,
+  // so edges stay one pixel wide at any scale.
+  float width = max(fwidth(signedDistance), 1e-4);
+  float coverage = clamp(signedDistance / width + 0.5, 0.0, 1.0);
+  vec4 color = palette.colors[fragColorIndex];
+
+  outColor = vec4(color.rgb, color.a * coverage);
+}
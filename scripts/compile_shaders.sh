@@ -4,3 +4,6 @@ echo "Compiling shaders..."
 
 glslc -fshader-stage=vertex res/shaders/simple.vert.glsl -o res/shaders/simple.vert.spv
 glslc -fshader-stage=fragment res/shaders/simple.frag.glsl -o res/shaders/simple.frag.spv
+glslc -fshader-stage=vertex res/shaders/text.vert.glsl -o res/shaders/text.vert.spv
+glslc -fshader-stage=fragment res/shaders/text.frag.glsl -o res/shaders/text.frag.spv
+glslc -fshader-stage=fragment res/shaders/text_sdf.frag.glsl -o res/shaders/text_sdf.frag.spv
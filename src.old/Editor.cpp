@@ -1,14 +1,95 @@
+#include <vulkan/vulkan_core.h>
+
 #include <cstdlib>
 #include <exception>
 #include <iostream>
+#include <string>
+#include <vector>
 
+#include "FileView.hpp"
 #include "VeApp.hpp"
+#include "VeHeadlessRenderer.hpp"
+
+namespace {
+
+// Tells the snapshot test that there is nothing to render
+// with, see test/Snapshot.cmake.
+constexpr int EXIT_NO_DEVICE = 77;
+
+// Whether a Vulkan driver with a device is installed.
+bool hasVulkanDevice() {
+    VkInstanceCreateInfo createInfo{};
+    createInfo.sType =
+        VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
+
+    VkInstance instance;
+
+    if (vkCreateInstance(&createInfo, nullptr,
+                         &instance) != VK_SUCCESS) {
+        return false;
+    }
+
+    uint32_t deviceCount = 0;
+    vkEnumeratePhysicalDevices(instance, &deviceCount,
+                               nullptr);
+    vkDestroyInstance(instance, nullptr);
+    return deviceCount > 0;
+}
+
+// Renders the first screen of fileName without a window
+// and writes it to out as a PPM, for comparing against a
+// golden image, e.g. with cmp.
+int snapshot(const std::string& out,
+             const std::string& fileName) {
+    if (!hasVulkanDevice()) {
+        std::cerr << "no Vulkan device" << std::endl;
+        return EXIT_NO_DEVICE;
+    }
+
+    FileView fileView;
+
+    if (!fileName.empty() &&
+        fileView.openFile(fileName) == -1) {
+        std::cerr << "failed to open file: " << fileName
+                  << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    ve::VeHeadlessRenderer renderer{
+        {ve::VeApp::WIDTH, ve::VeApp::HEIGHT}};
+    std::vector<std::string> lines;
+
+    for (size_t line = 0;
+         line < fileView.lineCount() &&
+         line < renderer.visibleLines();
+         line++) {
+        lines.push_back(fileView.line(line));
+    }
+
+    renderer.render(lines);
+    renderer.savePpm(out);
+    return EXIT_SUCCESS;
+}
+
+}  // namespace
+
+// editor [file]
+// editor --snapshot out.ppm [file]
+int main(int argc, char** argv) {
+    if (argc > 2 && std::string{argv[1]} == "--snapshot") {
+        try {
+            return snapshot(argv[2],
+                            argc > 3 ? argv[3] : "");
+        } catch (const std::exception& except) {
+            std::cerr << except.what() << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
 
-int main() {
     std::cout << "Start of Normal section..." << std::endl;
     std::cout << "Start of Vulkan section..." << std::endl;
 
-    ve::VeApp app{};
+    ve::VeApp app{argc > 1 ? argv[1] : ""};
 
     try {
         app.run();
@@ -0,0 +1,164 @@
+#include "FileBuffer.hpp"
+
+// c std
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// std
+#include <utility>
+
+FileBuffer::FileBuffer(std::string contents)
+    : m_heap(std::move(contents)) {
+    m_data = m_heap.data();
+    m_size = m_heap.size();
+}
+
+FileBuffer::~FileBuffer() {
+    close();
+}
+
+FileBuffer::FileBuffer(FileBuffer&& other) noexcept {
+    *this = std::move(other);
+}
+
+FileBuffer& FileBuffer::operator=(
+    FileBuffer&& other) noexcept {
+    if (this == &other) {
+        return *this;
+    }
+
+    close();
+
+    m_mapped = std::exchange(other.m_mapped, false);
+    m_fd = std::exchange(other.m_fd, -1);
+    m_size = std::exchange(other.m_size, 0);
+    m_heap = std::move(other.m_heap);
+    m_data = m_mapped ? other.m_data : m_heap.data();
+    other.m_data = nullptr;
+    other.m_heap.clear();
+
+    return *this;
+}
+
+int FileBuffer::open(const std::string& fileName,
+                     OpenMode mode) {
+    close();
+
+    int fd = ::open(fileName.c_str(), O_RDONLY | O_CLOEXEC);
+
+    if (fd < 0) {
+        return -1;
+    }
+
+    struct stat info;
+
+    if (fstat(fd, &info) < 0) {
+        int saved = errno;
+        ::close(fd);
+        errno = saved;
+        return -1;
+    }
+
+    bool mappable = S_ISREG(info.st_mode) && info.st_size > 0;
+
+    if (mode == OpenMode::Map && !mappable) {
+        ::close(fd);
+        errno = ENODEV;
+        return -1;
+    }
+
+    if (mode != OpenMode::Stream && mappable) {
+        if (map(fd, static_cast<size_t>(info.st_size)) == 0) {
+            return 0;
+        }
+
+        if (mode == OpenMode::Map) {
+            int saved = errno;
+            ::close(fd);
+            errno = saved;
+            return -1;
+        }
+    }
+
+    int result = stream(fd);
+    int saved = errno;
+    ::close(fd);
+    errno = saved;
+
+    return result;
+}
+
+void FileBuffer::close() {
+    if (m_mapped) {
+        munmap(const_cast<char*>(m_data), m_size);
+    }
+
+    if (m_fd >= 0) {
+        ::close(m_fd);
+    }
+
+    m_data = nullptr;
+    m_size = 0;
+    m_mapped = false;
+    m_fd = -1;
+    m_heap.clear();
+}
+
+int FileBuffer::map(int fd, size_t size) {
+    // MAP_PRIVATE keeps the view stable while we write the
+    // file back out through a temporary and rename.
+    void* address =
+        mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+    if (address == MAP_FAILED) {
+        return -1;
+    }
+
+    // The first pass over the mapping is the newline scan.
+    madvise(address, size, MADV_SEQUENTIAL);
+
+    m_data = static_cast<const char*>(address);
+    m_size = size;
+    m_mapped = true;
+    m_fd = fd;
+
+    return 0;
+}
+
+int FileBuffer::stream(int fd) {
+    constexpr size_t kChunkSize = 64 * 1024;
+
+    std::string contents;
+
+    for (;;) {
+        size_t used = contents.size();
+        contents.resize(used + kChunkSize);
+
+        ssize_t count =
+            read(fd, contents.data() + used, kChunkSize);
+
+        if (count < 0) {
+            if (errno == EINTR) {
+                contents.resize(used);
+                continue;
+            }
+
+            return -1;
+        }
+
+        contents.resize(used + static_cast<size_t>(count));
+
+        if (count == 0) {
+            break;
+        }
+    }
+
+    m_heap = std::move(contents);
+    m_data = m_heap.data();
+    m_size = m_heap.size();
+
+    return 0;
+}
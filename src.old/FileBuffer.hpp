@@ -0,0 +1,59 @@
+#pragma once
+
+// std
+#include <cstddef>
+#include <string>
+
+// Read-only view of a file's bytes. Regular files are
+// memory mapped so that opening costs no copies at all;
+// pipes, character devices and files that report a zero
+// size (e.g. /proc) are streamed into a heap buffer instead.
+class FileBuffer {
+   public:
+    enum class OpenMode {
+        Auto,
+        Map,
+        Stream,
+    };
+
+    FileBuffer() = default;
+    explicit FileBuffer(std::string contents);
+    ~FileBuffer();
+
+    FileBuffer(const FileBuffer&) = delete;
+    FileBuffer& operator=(const FileBuffer&) = delete;
+
+    FileBuffer(FileBuffer&& other) noexcept;
+    FileBuffer& operator=(FileBuffer&& other) noexcept;
+
+    // Returns 0 on success and -1 on failure, in which case
+    // errno describes the error.
+    int open(const std::string& fileName,
+             OpenMode mode = OpenMode::Auto);
+    void close();
+
+    const char* data() const {
+        return m_data;
+    }
+    size_t size() const {
+        return m_size;
+    }
+    bool mapped() const {
+        return m_mapped;
+    }
+    // Descriptor of the mapped file, -1 for heap buffers.
+    int fd() const {
+        return m_fd;
+    }
+
+   private:
+    int map(int fd, size_t size);
+    int stream(int fd);
+
+    const char* m_data = nullptr;
+    size_t m_size = 0;
+    bool m_mapped = false;
+    int m_fd = -1;
+
+    std::string m_heap;
+};
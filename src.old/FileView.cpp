@@ -1,101 +1,392 @@
-#include <GLFW/glfw3.h>
-#include <glad/glad.h>
+#include "FileView.hpp"
 
-#include <fstream>
+#include "PieceTable.hpp"
+#include "Rope.hpp"
+#include "Utf8.hpp"
+
+// c std
+#include <errno.h>
+#include <string.h>
+
+// std
+#include <algorithm>
 #include <iostream>
-#include <sstream>
 #include <string>
-#include <vector>
 
-class FileView {
-   public:
-    // Constructor / Destructor
-    FileView() = default;
-    ~FileView() = default;
+FileView::FileView(Backend backend) {
+    if (backend == Backend::Rope) {
+        m_text = std::make_unique<Rope>();
+    } else {
+        m_text = std::make_unique<PieceTable>();
+    }
+}
 
-    int openFile(const std::string& fileName);
+int FileView::openFile(const std::string& fileName,
+                       FileBuffer::OpenMode mode) {
+    m_fileName = fileName;
+
+    // Regular files are mapped and become the read-only
+    // original buffer of the piece table as they are. The
+    // newline scan runs in the background, so the first
+    // screen can be shown before it is done.
+    FileBuffer buffer;
 
-    // Move Cursor
-    void cursorUp();
-    void cursorLeft();
-    void cursorRight();
-    void cursorDown();
+    if (buffer.open(m_fileName, mode) < 0) {
+        std::cerr << "ERROR: Couldn't open " << m_fileName
+                  << ": " << strerror(errno) << std::endl;
+        return -1;
+    }
 
-    // Debug
-    void dbgPrint();
+    m_text->load(std::move(buffer));
+    m_history.clear();
+    resetLines();
 
-   private:
-    std::string m_fileName;
+    if (filewriter::stamp(m_fileName, m_diskStamp) < 0) {
+        m_diskStamp = {};
+    }
 
-    unsigned int m_cursorX = 0;
-    unsigned int m_cursorY = 0;
+    m_savedSize = m_text->size();
+    m_firstEdit = kUnmodified;
+    m_cursorX = 0;
+    m_cursorY = 0;
+    m_preferredColumn = 0;
 
-    std::vector<std::string> m_rows;
-};
+    return 0;
+}
 
-int FileView::openFile(const std::string& fileName) {
-    m_fileName = fileName;
+int FileView::saveFile(const std::string& fileName,
+                       filewriter::Sync sync) {
+    std::string target =
+        fileName.empty() ? m_fileName : fileName;
 
-    std::ifstream fileStream(m_fileName);
+    filewriter::FileStamp current;
+    bool appendOnly =
+        target == m_fileName && m_diskStamp.valid() &&
+        m_firstEdit >= m_savedSize &&
+        m_text->size() >= m_savedSize &&
+        filewriter::stamp(target, current) == 0 &&
+        current == m_diskStamp;
 
-    if (!fileStream.is_open()) {
-        std::cerr << "ERROR: Couldn't open " << m_fileName
-                  << std::endl;
+    int result = 0;
+
+    if (!appendOnly) {
+        result = filewriter::replace(target, *m_text, sync);
+    } else if (m_text->size() > m_savedSize) {
+        result = filewriter::append(target, *m_text,
+                                    m_savedSize, sync);
+    }
+
+    if (result < 0) {
+        std::cerr << "ERROR: Couldn't save " << target << ": "
+                  << strerror(errno) << std::endl;
         return -1;
     }
 
-    std::string line;
+    // The file is replaced either way, so it is what the
+    // stamp has to describe.
+    if (result == filewriter::kNotDurable) {
+        std::cerr << "WARNING: Saved " << target
+                  << ", but it may not survive a crash: "
+                  << strerror(errno) << std::endl;
+    }
 
-    while (std::getline(fileStream, line)) {
-        m_rows.push_back(line);
+    m_fileName = target;
+
+    if (filewriter::stamp(m_fileName, m_diskStamp) < 0) {
+        m_diskStamp = {};
     }
 
-    fileStream.close();
+    m_savedSize = m_text->size();
+    m_firstEdit = kUnmodified;
 
     return 0;
 }
 
 void FileView::cursorUp() {
+    m_history.breakGroup();
+
     if (m_cursorY > 0) {
         m_cursorY--;
-
-        if (m_cursorX > m_rows[m_cursorY].length()) {
-            m_cursorX = m_rows[m_cursorY].length();
-        }
+        snapToPreferredColumn();
     }
 }
 
 void FileView::cursorLeft() {
+    m_history.breakGroup();
+
     if (m_cursorX > 0) {
-        m_cursorX--;
+        m_cursorX = static_cast<unsigned int>(
+            columns(m_cursorY).previous(m_cursorX));
+        rememberColumn();
     }
 }
 
 void FileView::cursorRight() {
-    if (m_cursorX < m_rows[m_cursorY].size()) {
-        m_cursorX++;
+    m_history.breakGroup();
+
+    const LineColumns& line = columns(m_cursorY);
+
+    if (m_cursorX < line.length()) {
+        m_cursorX =
+            static_cast<unsigned int>(line.next(m_cursorX));
+        rememberColumn();
     }
 }
 
 void FileView::cursorDown() {
-    if (m_cursorY < m_rows.size()) {
+    m_history.breakGroup();
+
+    if (m_text->hasLine(m_cursorY + 1)) {
         m_cursorY++;
+        snapToPreferredColumn();
+    }
+}
+
+void FileView::jumpToLine(size_t line) {
+    m_history.breakGroup();
+
+    // Only jumps past the end have to wait for the whole
+    // file to be indexed.
+    if (!m_text->hasLine(line)) {
+        line = m_text->lineCount() - 1;
+    }
+
+    m_cursorY = static_cast<unsigned int>(line);
+    snapToPreferredColumn();
+}
+
+bool FileView::insertText(std::string_view text) {
+    if (text.empty()) {
+        return true;
+    }
+
+    // Pasted or piped text can be anything, keep what is
+    // stored decodable.
+    if (!utf8::validate(text.data(), text.size())) {
+        return false;
+    }
+
+    size_t offset = cursorOffset();
+
+    m_history.insert(*m_text, offset, text);
+    markEdited(offset);
+
+    size_t newlines =
+        std::count(text.begin(), text.end(), '\n');
+
+    if (newlines == 0) {
+        editLine(m_cursorY, m_cursorX, 0, text.size());
+        m_cursorX += text.size();
+        rememberColumn();
+        return true;
+    }
+
+    invalidateLines(m_cursorY, 1, newlines + 1);
+
+    size_t lastNewline = text.rfind('\n');
+
+    m_cursorY += newlines;
+    m_cursorX = text.size() - lastNewline - 1;
+    rememberColumn();
+    return true;
+}
+
+void FileView::deleteBackward() {
+    size_t offset = cursorOffset();
+
+    if (offset == 0) {
+        return;
+    }
+
+    // Remove the whole cluster before the cursor, or the
+    // newline ending the previous line.
+    size_t length = 1;
+    bool joinsLines = m_cursorX == 0;
+
+    if (joinsLines) {
+        m_cursorY--;
+        m_cursorX = static_cast<unsigned int>(
+            m_text->lineLength(m_cursorY));
+    } else {
+        size_t previous = columns(m_cursorY).previous(m_cursorX);
+
+        length = m_cursorX - previous;
+        m_cursorX = static_cast<unsigned int>(previous);
+    }
+
+    m_history.erase(*m_text, offset - length, length);
+    markEdited(offset - length);
+
+    if (joinsLines) {
+        invalidateLines(m_cursorY, 2, 1);
+    } else {
+        editLine(m_cursorY, m_cursorX, length, 0);
+    }
+
+    rememberColumn();
+}
+
+void FileView::deleteForward() {
+    size_t offset = cursorOffset();
+
+    if (offset >= m_text->size()) {
+        return;
+    }
+
+    const LineColumns& line = columns(m_cursorY);
+    bool joinsLines = m_cursorX >= line.length();
+    size_t length =
+        joinsLines ? 1 : line.next(m_cursorX) - m_cursorX;
+
+    m_history.erase(*m_text, offset, length);
+    markEdited(offset);
+
+    if (joinsLines) {
+        invalidateLines(m_cursorY, 2, 1);
+    } else {
+        editLine(m_cursorY, m_cursorX, length, 0);
+    }
+}
+
+bool FileView::undo() {
+    if (!m_history.canUndo()) {
+        return false;
+    }
+
+    size_t cursor = m_history.undo(*m_text);
+    resetLines();
+    // Undoing may touch anything, so don't try to append.
+    markEdited(0);
+    moveCursorTo(cursor);
+    return true;
+}
+
+bool FileView::redo() {
+    if (!m_history.canRedo()) {
+        return false;
+    }
+
+    size_t cursor = m_history.redo(*m_text);
+    resetLines();
+    markEdited(0);
+    moveCursorTo(cursor);
+    return true;
+}
+
+size_t FileView::cursorOffset() const {
+    return m_text->lineStart(m_cursorY) + m_cursorX;
+}
+
+void FileView::moveCursorTo(size_t offset) {
+    size_t line = m_text->lineOf(offset);
+
+    m_cursorY = static_cast<unsigned int>(line);
+    m_cursorX = static_cast<unsigned int>(
+        offset - m_text->lineStart(line));
+    rememberColumn();
+}
+
+void FileView::snapToPreferredColumn() {
+    m_cursorX = static_cast<unsigned int>(
+        columns(m_cursorY).offsetOf(m_preferredColumn));
+}
+
+void FileView::rememberColumn() {
+    m_preferredColumn = columns(m_cursorY).columnOf(m_cursorX);
+}
+
+const LineColumns& FileView::columns(size_t line) const {
+    auto found = m_columns.find(line);
+
+    if (found != m_columns.end()) {
+        return found->second;
+    }
+
+    if (m_columns.size() >= kMaxCachedLines) {
+        m_columns.clear();
+    }
+
+    return m_columns
+        .emplace(line, LineColumns(m_text->line(line)))
+        .first->second;
+}
+
+size_t FileView::memoryUsage() const {
+    size_t columns =
+        m_columns.bucket_count() * sizeof(void*);
+
+    // Every entry is a node holding the key, the value and
+    // a next pointer.
+    for (const auto& entry : m_columns) {
+        columns += sizeof(void*) + sizeof(entry.first) +
+                   entry.second.memoryUsage();
+    }
+
+    return m_text->memoryUsage() + m_history.memoryUsage() +
+           m_metadata.memoryUsage() + columns;
+}
+
+size_t FileView::lineWidth(size_t line) const {
+    uint32_t width = m_metadata.width(line);
+
+    if (width == LineMetadata::kUnknownWidth) {
+        auto found = m_columns.find(line);
+
+        width = static_cast<uint32_t>(
+            found != m_columns.end()
+                ? found->second.width()
+                : LineColumns(m_text->line(line)).width());
+        m_metadata.setWidth(line, width);
+    }
+
+    return width;
+}
+
+void FileView::invalidateLines(size_t line, size_t removed,
+                               size_t added) {
+    m_columns.clear();
+    m_metadata.splice(line, removed, added);
+}
+
+void FileView::editLine(size_t line, size_t offset,
+                        size_t removed, size_t added) {
+    m_metadata.invalidate(line);
+
+    auto found = m_columns.find(line);
+
+    if (found == m_columns.end()) {
+        return;
+    }
+
+    LineColumns& columns = found->second;
+    size_t restart = columns.previous(offset);
+    size_t length = columns.length() - removed + added;
+    size_t window =
+        std::min(length - restart,
+                 offset + added + kSpliceWindow - restart);
+
+    std::string bytes;
+    m_text->copy(m_text->lineStart(line) + restart, window,
+                 bytes);
 
-        if (m_cursorX > m_rows[m_cursorY].length()) {
-            m_cursorX = m_rows[m_cursorY].length();
-        }
+    if (!columns.splice(offset, removed, added, bytes,
+                        restart + window == length)) {
+        m_columns.erase(found);
     }
 }
 
 void FileView::dbgPrint() {
     std::cout << "DEBUG: File name: " << m_fileName
               << std::endl;
-    std::cout << "DEBUG: Number of rows: " << m_rows.size()
+    std::cout << "DEBUG: Number of rows: "
+              << m_text->lineCount() << std::endl;
+    std::cout << "DEBUG: Memory usage: "
+              << m_text->memoryUsage() << " bytes"
               << std::endl;
     std::cout << "DEBUG: File contents: " << std::endl;
 
-    for (std::string row : m_rows) {
-        std::cout << row << std::endl;
+    for (size_t i = 0; i < m_text->lineCount(); i++) {
+        std::cout << m_text->line(i) << std::endl;
     }
 
     std::cout << std::endl;
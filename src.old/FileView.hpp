@@ -0,0 +1,174 @@
+#pragma once
+
+#include "FileBuffer.hpp"
+#include "FileWriter.hpp"
+#include "LineColumns.hpp"
+#include "LineMetadata.hpp"
+#include "TextStorage.hpp"
+#include "UndoHistory.hpp"
+
+// std
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+class FileView {
+   public:
+    // Storage engine holding the document.
+    enum class Backend {
+        PieceTable,
+        Rope,
+    };
+
+    // Constructor / Destructor
+    explicit FileView(Backend backend = Backend::PieceTable);
+    ~FileView() = default;
+
+    int openFile(const std::string& fileName,
+                 FileBuffer::OpenMode mode =
+                     FileBuffer::OpenMode::Auto);
+    // Saves to fileName, or back to the opened file if it
+    // is empty. Returns 0 on success and -1 on failure. A
+    // save that is in place but couldn't be made durable
+    // counts as done, with a warning.
+    int saveFile(const std::string& fileName = {},
+                 filewriter::Sync sync =
+                     filewriter::Sync::Durable);
+
+    // Move Cursor
+    void cursorUp();
+    void cursorLeft();
+    void cursorRight();
+    void cursorDown();
+    void jumpToLine(size_t line);
+
+    // Edit
+    // Leaves the text alone and returns false if text is
+    // not well formed UTF-8.
+    bool insertText(std::string_view text);
+    void deleteBackward();
+    void deleteForward();
+
+    // History
+    bool undo();
+    bool redo();
+    void setUndoMemoryLimit(size_t bytes) {
+        m_history.setMemoryLimit(bytes);
+    }
+
+    // Access
+    size_t lineCount() const {
+        return m_text->lineCount();
+    }
+    std::string line(size_t index) const {
+        return m_text->line(index);
+    }
+    const TextStorage& text() const {
+        return *m_text;
+    }
+    // Bytes held by the text, its undo history and the
+    // caches kept per line.
+    size_t memoryUsage() const;
+    bool modified() const {
+        return m_firstEdit != kUnmodified;
+    }
+    // Whether the opened file is well formed UTF-8. Its
+    // malformed bytes show as U+FFFD. Checked by the
+    // background indexer, so it only becomes final once
+    // indexingProgress() reaches 1.
+    bool validUtf8() const {
+        return m_text->validUtf8();
+    }
+    // Byte offset of the cursor in its line, always at the
+    // start of a grapheme cluster.
+    unsigned int cursorX() const {
+        return m_cursorX;
+    }
+    // Screen column of the cursor.
+    size_t cursorColumn() const {
+        return columns(m_cursorY).columnOf(m_cursorX);
+    }
+    unsigned int cursorY() const {
+        return m_cursorY;
+    }
+    // Screen columns the line takes up, cached.
+    size_t lineWidth(size_t line) const;
+    // Highlight and fold state kept per line. Entries are
+    // moved along as lines are added and removed, and reset
+    // on undo and redo.
+    LineMetadata& lineMetadata() {
+        return m_metadata;
+    }
+    const LineMetadata& lineMetadata() const {
+        return m_metadata;
+    }
+
+    // Indexing
+    double indexingProgress() const {
+        return m_text->indexingProgress();
+    }
+    void cancelIndexing() {
+        m_text->cancelIndexing();
+    }
+
+    // Debug
+    void dbgPrint();
+
+   private:
+    static constexpr size_t kMaxCachedLines = 1024;
+    // Bytes past an edit read to patch the line's columns,
+    // clusters almost always line up again within them.
+    static constexpr size_t kSpliceWindow = 64;
+    static constexpr size_t kUnmodified =
+        static_cast<size_t>(-1);
+
+    size_t cursorOffset() const;
+    void moveCursorTo(size_t offset);
+    // Moves to the current line's cluster closest to the
+    // preferred column.
+    void snapToPreferredColumn();
+    void rememberColumn();
+
+    const LineColumns& columns(size_t line) const;
+    // Updates the per-line caches after lines [line, line +
+    // removed) were edited into added lines.
+    void invalidateLines(size_t line, size_t removed,
+                         size_t added);
+    // Same for an edit within the line, replacing removed
+    // bytes at offset by added ones. Patches the cached
+    // columns instead of dropping them.
+    void editLine(size_t line, size_t offset,
+                  size_t removed, size_t added);
+    // Drops everything cached per line.
+    void resetLines() {
+        m_columns.clear();
+        m_metadata.clear();
+    }
+    void markEdited(size_t offset) {
+        m_firstEdit = std::min(m_firstEdit, offset);
+    }
+
+    std::string m_fileName;
+
+    // What the file looked like on disk when it was last
+    // read or written, and the lowest offset edited since.
+    // Edits that all lie past the saved size can be saved
+    // by appending.
+    filewriter::FileStamp m_diskStamp;
+    size_t m_savedSize = 0;
+    size_t m_firstEdit = kUnmodified;
+
+    unsigned int m_cursorX = 0;
+    unsigned int m_cursorY = 0;
+    // Column vertical motion tries to return to, so that
+    // moving through a short line doesn't lose it.
+    size_t m_preferredColumn = 0;
+
+    mutable std::unordered_map<size_t, LineColumns> m_columns;
+    mutable LineMetadata m_metadata;
+
+    std::unique_ptr<TextStorage> m_text;
+    UndoHistory m_history;
+};
@@ -0,0 +1,342 @@
+#include "FileWriter.hpp"
+
+// c std
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+// std
+#include <algorithm>
+#include <vector>
+
+namespace filewriter {
+
+namespace {
+
+// Batches iovecs for writev and copies spans of the
+// original file with copy_file_range where it can.
+class SpanWriter {
+   public:
+    SpanWriter(int fd, const TextBuffers& buffers)
+        : m_fd(fd), m_buffers(buffers) {
+        m_iov.reserve(kMaxIov);
+    }
+
+    void add(const TextSpan& span) {
+        if (m_pending.length > 0 &&
+            m_pending.source == span.source &&
+            m_pending.start + m_pending.length == span.start) {
+            m_pending.length += span.length;
+            return;
+        }
+
+        emit();
+        m_pending = span;
+    }
+
+    int finish() {
+        emit();
+        flush();
+
+        if (m_error != 0) {
+            errno = m_error;
+            return -1;
+        }
+
+        return 0;
+    }
+
+   private:
+#ifdef IOV_MAX
+    static constexpr size_t kMaxIov = IOV_MAX;
+#else
+    static constexpr size_t kMaxIov = 1024;
+#endif
+
+    void emit() {
+        if (m_pending.length == 0 || m_error != 0) {
+            return;
+        }
+
+        TextSpan span = m_pending;
+        m_pending.length = 0;
+
+        int source = m_buffers.original().fd();
+
+        if (span.source == TextSource::Original &&
+            source >= 0 && m_copy) {
+            flush();
+
+            if (copy(source, span)) {
+                return;
+            }
+        }
+
+        const char* data =
+            m_buffers.data(span.source) + span.start;
+
+        m_iov.push_back(
+            {const_cast<char*>(data), span.length});
+
+        if (m_iov.size() == kMaxIov) {
+            flush();
+        }
+    }
+
+    // Copies the span in the kernel. Returns false without
+    // writing anything if the file system can't, in which
+    // case the span goes through writev instead.
+    bool copy(int source, TextSpan span) {
+        auto offset = static_cast<off_t>(span.start);
+        bool copied = false;
+
+        while (span.length > 0) {
+            ssize_t done =
+                copy_file_range(source, &offset, m_fd, nullptr,
+                                span.length, 0);
+
+            if (done < 0 && errno == EINTR) {
+                continue;
+            }
+
+            if (done <= 0) {
+                if (copied) {
+                    // Part of the span is already written.
+                    m_error = done < 0 ? errno : EIO;
+                    return true;
+                }
+
+                // Cross-device copies, old kernels, O_APPEND
+                // targets and copies within one file.
+                if (done < 0 &&
+                    (errno == EXDEV || errno == ENOSYS ||
+                     errno == EINVAL || errno == EOPNOTSUPP ||
+                     errno == EBADF)) {
+                    m_copy = false;
+                    return false;
+                }
+
+                m_error = done < 0 ? errno : EIO;
+                return true;
+            }
+
+            copied = true;
+            span.length -= static_cast<size_t>(done);
+        }
+
+        return true;
+    }
+
+    void flush() {
+        size_t first = 0;
+
+        while (first < m_iov.size() && m_error == 0) {
+            ssize_t done =
+                writev(m_fd, m_iov.data() + first,
+                       static_cast<int>(m_iov.size() - first));
+
+            if (done < 0) {
+                if (errno != EINTR) {
+                    m_error = errno;
+                }
+
+                continue;
+            }
+
+            // Skip what was written, a short write may end
+            // in the middle of an entry.
+            auto left = static_cast<size_t>(done);
+
+            while (first < m_iov.size() &&
+                   left >= m_iov[first].iov_len) {
+                left -= m_iov[first].iov_len;
+                first++;
+            }
+
+            if (left > 0) {
+                m_iov[first].iov_base =
+                    static_cast<char*>(m_iov[first].iov_base) +
+                    left;
+                m_iov[first].iov_len -= left;
+            }
+        }
+
+        m_iov.clear();
+    }
+
+    int m_fd;
+    const TextBuffers& m_buffers;
+
+    std::vector<iovec> m_iov;
+    TextSpan m_pending{TextSource::Add, 0, 0};
+    bool m_copy = true;
+    int m_error = 0;
+};
+
+int fail(int fd, const std::string& tempName) {
+    int saved = errno;
+
+    if (fd >= 0) {
+        ::close(fd);
+    }
+
+    if (!tempName.empty()) {
+        unlink(tempName.c_str());
+    }
+
+    errno = saved;
+    return -1;
+}
+
+std::string directoryOf(const std::string& path) {
+    size_t slash = path.rfind('/');
+
+    if (slash == std::string::npos) {
+        return ".";
+    }
+
+    return slash == 0 ? "/" : path.substr(0, slash);
+}
+
+}  // namespace
+
+bool FileStamp::operator==(const FileStamp& other) const {
+    return device == other.device && inode == other.inode &&
+           size == other.size &&
+           modified.tv_sec == other.modified.tv_sec &&
+           modified.tv_nsec == other.modified.tv_nsec;
+}
+
+int stamp(const std::string& fileName, FileStamp& out) {
+    struct stat info;
+
+    if (::stat(fileName.c_str(), &info) < 0) {
+        return -1;
+    }
+
+    out.device = info.st_dev;
+    out.inode = info.st_ino;
+    out.size = info.st_size;
+    out.modified = info.st_mtim;
+
+    return 0;
+}
+
+int write(int fd, const TextStorage& text, size_t offset) {
+    SpanWriter writer(fd, text.buffers());
+
+    text.forEachChunk(
+        offset, text.size() - std::min(offset, text.size()),
+        [&](const char* data, size_t size) {
+            writer.add(text.buffers().spanOf(data, size));
+        });
+
+    return writer.finish();
+}
+
+int replace(const std::string& fileName,
+            const TextStorage& text, Sync sync) {
+    // Write next to the file the link points to, renaming
+    // over the link would replace it with a regular file.
+    std::string target = fileName;
+    char* resolved = realpath(fileName.c_str(), nullptr);
+
+    if (resolved != nullptr) {
+        target = resolved;
+        free(resolved);
+    } else if (errno != ENOENT) {
+        return -1;
+    }
+
+    std::string tempName = target + ".XXXXXX";
+    int fd = mkostemp(tempName.data(), O_CLOEXEC);
+
+    if (fd < 0) {
+        return -1;
+    }
+
+    struct stat info;
+
+    if (::stat(target.c_str(), &info) == 0) {
+        if (fchmod(fd, info.st_mode & 07777) < 0) {
+            return fail(fd, tempName);
+        }
+
+        // Only root can give the file away, keep our own
+        // ownership otherwise.
+        (void)fchown(fd, info.st_uid, info.st_gid);
+    } else {
+        mode_t mask = umask(0);
+        umask(mask);
+
+        if (fchmod(fd, 0666 & ~mask) < 0) {
+            return fail(fd, tempName);
+        }
+    }
+
+    if (write(fd, text, 0) < 0) {
+        return fail(fd, tempName);
+    }
+
+    // The data has to be on disk before the rename makes it
+    // visible, or a crash could leave an empty file behind.
+    if (sync == Sync::Durable && fsync(fd) < 0) {
+        return fail(fd, tempName);
+    }
+
+    if (::close(fd) < 0) {
+        return fail(-1, tempName);
+    }
+
+    if (rename(tempName.c_str(), target.c_str()) < 0) {
+        return fail(-1, tempName);
+    }
+
+    if (sync == Sync::Durable) {
+        // Persist the rename itself.
+        int directory =
+            ::open(directoryOf(target).c_str(),
+                   O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+
+        if (directory < 0) {
+            return kNotDurable;
+        }
+
+        int result = fsync(directory);
+        int saved = errno;
+        ::close(directory);
+        errno = saved;
+
+        return result < 0 ? kNotDurable : 0;
+    }
+
+    return 0;
+}
+
+int append(const std::string& fileName,
+           const TextStorage& text, size_t offset, Sync sync) {
+    int fd = ::open(fileName.c_str(),
+                    O_WRONLY | O_APPEND | O_CLOEXEC);
+
+    if (fd < 0) {
+        return -1;
+    }
+
+    if (write(fd, text, offset) < 0) {
+        return fail(fd, {});
+    }
+
+    // The file already exists, only its data and size need
+    // to reach the disk.
+    if (sync == Sync::Durable && fdatasync(fd) < 0) {
+        return fail(fd, {});
+    }
+
+    return ::close(fd);
+}
+
+}  // namespace filewriter
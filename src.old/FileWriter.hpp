@@ -0,0 +1,75 @@
+#pragma once
+
+#include "TextStorage.hpp"
+
+// c std
+#include <sys/types.h>
+#include <time.h>
+
+// std
+#include <cstddef>
+#include <string>
+
+// Writes documents back to disk straight from the storage
+// buffers: spans of the original file are copied in the
+// kernel with copy_file_range and everything else goes out
+// through writev, so the document is never concatenated
+// into one big string.
+//
+// All functions return 0 on success and -1 on failure, in
+// which case errno describes the error.
+namespace filewriter {
+
+// Returned by replace when the file was replaced but the
+// rename could not be made durable, errno says why. The
+// new contents are in place, they may only be lost in a
+// crash.
+constexpr int kNotDurable = 1;
+
+enum class Sync {
+    // fsync whatever is needed for the result to survive a
+    // crash or power loss.
+    Durable,
+    // Leave flushing to the kernel.
+    None,
+};
+
+// Identity and state of a file on disk, used to tell
+// whether anyone else changed it since we last looked.
+struct FileStamp {
+    dev_t device = 0;
+    ino_t inode = 0;
+    off_t size = -1;
+    timespec modified{};
+
+    bool valid() const {
+        return size >= 0;
+    }
+    bool operator==(const FileStamp& other) const;
+    bool operator!=(const FileStamp& other) const {
+        return !(*this == other);
+    }
+};
+
+int stamp(const std::string& fileName, FileStamp& out);
+
+// Writes text[offset, text.size()) to fd at its current
+// position.
+int write(int fd, const TextStorage& text, size_t offset);
+
+// Atomically replaces fileName with text: the document is
+// written to a temporary file in the same directory which
+// is then renamed over it, so a crash leaves either the old
+// or the new contents. Symlinks are followed and the
+// permissions of an existing file are kept. Returns
+// kNotDurable if only syncing the directory failed.
+int replace(const std::string& fileName,
+            const TextStorage& text, Sync sync);
+
+// Appends text[offset, text.size()) to fileName, for
+// documents that were only added to at the end since the
+// file was last read or written.
+int append(const std::string& fileName,
+           const TextStorage& text, size_t offset, Sync sync);
+
+}  // namespace filewriter
@@ -0,0 +1,82 @@
+#include "LatencyProbe.hpp"
+
+// std
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+LatencyProbe::LatencyProbe(size_t capacity)
+    : m_capacity(std::max<size_t>(capacity, 1)) {
+    m_samples.reserve(m_capacity);
+}
+
+void LatencyProbe::end(double time) {
+    if (!running()) {
+        return;
+    }
+
+    record(time - m_start);
+    m_start = -1.0;
+}
+
+void LatencyProbe::record(double seconds) {
+    if (m_samples.size() < m_capacity) {
+        m_samples.push_back(seconds);
+    } else {
+        m_samples[m_next] = seconds;
+    }
+
+    m_next = (m_next + 1) % m_capacity;
+    m_count++;
+}
+
+void LatencyProbe::clear() {
+    m_samples.clear();
+    m_next = 0;
+    m_count = 0;
+    m_start = -1.0;
+}
+
+double LatencyProbe::min() const {
+    if (m_samples.empty()) {
+        return 0.0;
+    }
+
+    return *std::min_element(m_samples.begin(),
+                             m_samples.end());
+}
+
+double LatencyProbe::max() const {
+    if (m_samples.empty()) {
+        return 0.0;
+    }
+
+    return *std::max_element(m_samples.begin(),
+                             m_samples.end());
+}
+
+double LatencyProbe::mean() const {
+    if (m_samples.empty()) {
+        return 0.0;
+    }
+
+    return std::accumulate(m_samples.begin(),
+                           m_samples.end(), 0.0) /
+           static_cast<double>(kept());
+}
+
+double LatencyProbe::percentile(double p) const {
+    if (m_samples.empty()) {
+        return 0.0;
+    }
+
+    std::vector<double> sorted = m_samples;
+    size_t rank = static_cast<size_t>(
+        std::ceil(std::clamp(p, 0.0, 1.0) *
+                  static_cast<double>(sorted.size())));
+    size_t index = rank > 0 ? rank - 1 : 0;
+
+    std::nth_element(sorted.begin(),
+                     sorted.begin() + index, sorted.end());
+    return sorted[index];
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+// std
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Measures how long something takes to show up and
+// summarizes the most recent measurements.
+//
+// begin marks the start of a measurement, e.g. a key press,
+// and end its completion, e.g. the frame showing it being
+// presented. Starts arriving while one is running are
+// ignored, so the first of several inputs drawn in one
+// frame, which waited longest, is the one measured.
+//
+// Times are in seconds on any monotonic clock.
+class LatencyProbe {
+   public:
+    static constexpr size_t kCapacity = 1024;
+
+    explicit LatencyProbe(size_t capacity = kCapacity);
+
+    void begin(double time) {
+        if (m_start < 0.0) {
+            m_start = time;
+        }
+    }
+    // Records the running measurement, if there is one.
+    void end(double time);
+    bool running() const {
+        return m_start >= 0.0;
+    }
+
+    // Adds a sample directly, dropping the oldest once
+    // the capacity is reached.
+    void record(double seconds);
+    void clear();
+
+    // Samples over the probe's lifetime.
+    uint64_t count() const {
+        return m_count;
+    }
+
+    // Over the samples kept, 0 if there are none.
+    double min() const;
+    double max() const;
+    double mean() const;
+    // p between 0 and 1, nearest rank.
+    double percentile(double p) const;
+
+   private:
+    size_t kept() const {
+        return m_samples.size();
+    }
+
+    size_t m_capacity;
+    std::vector<double> m_samples;
+    size_t m_next = 0;
+    uint64_t m_count = 0;
+    double m_start = -1.0;
+};
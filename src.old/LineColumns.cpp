@@ -0,0 +1,264 @@
+#include "LineColumns.hpp"
+
+#include "Utf8.hpp"
+
+// std
+#include <algorithm>
+
+namespace {
+
+// Decides for each codepoint, in order, whether it joins
+// the cluster before it.
+class ClusterRules {
+   public:
+    // started says whether a cluster came before the first
+    // codepoint, which otherwise never joins.
+    explicit ClusterRules(bool started)
+        : m_started(started) {
+    }
+
+    bool joins(char32_t codepoint) {
+        bool joins = false;
+
+        if (m_started) {
+            if (utf8::extendsGrapheme(codepoint)) {
+                joins = true;
+            } else if (m_previous == 0x200D) {
+                // Zero width joiner sequences, e.g. family
+                // emoji, form a single cluster.
+                joins = true;
+            } else if (
+                utf8::isRegionalIndicator(codepoint) &&
+                utf8::isRegionalIndicator(m_previous) &&
+                !m_pairedIndicator) {
+                joins = true;
+            }
+        }
+
+        if (utf8::isRegionalIndicator(codepoint)) {
+            m_pairedIndicator = joins;
+        }
+
+        m_started = true;
+        m_previous = codepoint;
+        return joins;
+    }
+
+   private:
+    bool m_started;
+    char32_t m_previous = 0;
+    bool m_pairedIndicator = false;
+};
+
+}  // namespace
+
+LineColumns::LineColumns(std::string_view line)
+    : m_length(line.size()) {
+    size_t ascii = utf8::asciiPrefix(line.data(), line.size());
+
+    if (ascii == line.size()) {
+        return;
+    }
+
+    m_ascii = false;
+
+    // The ASCII prefix is one cluster per byte.
+    for (size_t i = 0; i < ascii; i++) {
+        m_starts.push_back(static_cast<uint32_t>(i));
+        m_columns.push_back(static_cast<uint32_t>(i));
+    }
+
+    size_t column = ascii;
+    size_t offset = ascii;
+    ClusterRules rules(ascii > 0);
+
+    while (offset < line.size()) {
+        size_t length;
+        char32_t codepoint = utf8::decode(
+            line.data() + offset, line.size() - offset, length);
+
+        if (!rules.joins(codepoint)) {
+            m_starts.push_back(static_cast<uint32_t>(offset));
+            m_columns.push_back(static_cast<uint32_t>(column));
+            column += utf8::columnWidth(codepoint);
+        }
+
+        offset += length;
+    }
+
+    m_starts.push_back(static_cast<uint32_t>(line.size()));
+    m_columns.push_back(static_cast<uint32_t>(column));
+
+    m_byColumn.resize(column);
+
+    for (size_t i = 0; i + 1 < m_starts.size(); i++) {
+        for (size_t c = m_columns[i]; c < m_columns[i + 1];
+             c++) {
+            m_byColumn[c] = static_cast<uint32_t>(i);
+        }
+    }
+}
+
+size_t LineColumns::columnOf(size_t offset) const {
+    if (offset >= m_length) {
+        return width();
+    }
+
+    return m_ascii ? offset : m_columns[clusterOf(offset)];
+}
+
+size_t LineColumns::next(size_t offset) const {
+    if (offset >= m_length) {
+        return m_length;
+    }
+
+    return m_ascii ? offset + 1
+                   : m_starts[clusterOf(offset) + 1];
+}
+
+size_t LineColumns::previous(size_t offset) const {
+    if (offset == 0) {
+        return 0;
+    }
+
+    if (m_ascii) {
+        return std::min(offset, m_length) - 1;
+    }
+
+    // The cluster ending at or containing offset - 1.
+    return m_starts[clusterOf(std::min(offset, m_length) - 1)];
+}
+
+bool LineColumns::splice(size_t offset, size_t removed,
+                         size_t added,
+                         std::string_view window,
+                         bool complete) {
+    size_t restart = previous(offset);
+    // End of the added bytes, in the window.
+    size_t edited = offset + added - restart;
+
+    if (m_ascii) {
+        if (utf8::asciiPrefix(window.data(), edited) ==
+            edited) {
+            m_length = m_length - removed + added;
+            return true;
+        }
+
+        expandAscii();
+    }
+
+    size_t first = clusterOf(restart);
+    std::vector<uint32_t> starts;
+    std::vector<uint32_t> columns;
+    size_t column = m_columns[first];
+    size_t i = 0;
+    // The cluster at restart comes before the edit, so it
+    // still starts a cluster.
+    ClusterRules rules(false);
+
+    while (true) {
+        char32_t codepoint = 0;
+        size_t length = 0;
+        bool joins = false;
+
+        if (i < window.size()) {
+            // Could be cut short by the window.
+            if (!complete && window.size() - i < 4) {
+                return false;
+            }
+
+            codepoint = utf8::decode(window.data() + i,
+                                     window.size() - i,
+                                     length);
+            joins = rules.joins(codepoint);
+        } else if (!complete) {
+            return false;
+        }
+
+        // Past the edit, a cluster that also started one
+        // in the old line starts the same clusters as
+        // before, only moved. The old line's end is one.
+        if (!joins && i >= edited) {
+            auto old = static_cast<uint32_t>(
+                restart + i + removed - added);
+            auto found =
+                std::lower_bound(m_starts.begin() + first,
+                                 m_starts.end(), old);
+
+            if (found != m_starts.end() && *found == old) {
+                size_t resume =
+                    static_cast<size_t>(found -
+                                        m_starts.begin());
+                // Wrap around when they shrink.
+                auto startShift =
+                    static_cast<uint32_t>(added - removed);
+                auto columnShift = static_cast<uint32_t>(
+                    column - m_columns[resume]);
+
+                for (size_t k = resume; k < m_starts.size();
+                     k++) {
+                    m_starts[k] += startShift;
+                    m_columns[k] += columnShift;
+                }
+
+                m_starts.erase(m_starts.begin() + first,
+                               m_starts.begin() + resume);
+                m_starts.insert(m_starts.begin() + first,
+                                starts.begin(),
+                                starts.end());
+                m_columns.erase(m_columns.begin() + first,
+                                m_columns.begin() + resume);
+                m_columns.insert(m_columns.begin() + first,
+                                 columns.begin(),
+                                 columns.end());
+                break;
+            }
+        }
+
+        if (!joins) {
+            starts.push_back(
+                static_cast<uint32_t>(restart + i));
+            columns.push_back(
+                static_cast<uint32_t>(column));
+            column += utf8::columnWidth(codepoint);
+        }
+
+        i += length;
+    }
+
+    m_length = m_length - removed + added;
+    m_byColumn.resize(m_columns.back());
+
+    for (size_t k = first; k + 1 < m_starts.size(); k++) {
+        for (size_t c = m_columns[k]; c < m_columns[k + 1];
+             c++) {
+            m_byColumn[c] = static_cast<uint32_t>(k);
+        }
+    }
+
+    return true;
+}
+
+void LineColumns::expandAscii() {
+    m_ascii = false;
+    m_starts.resize(m_length + 1);
+    m_columns.resize(m_length + 1);
+    m_byColumn.resize(m_length);
+
+    for (size_t i = 0; i <= m_length; i++) {
+        m_starts[i] = static_cast<uint32_t>(i);
+        m_columns[i] = static_cast<uint32_t>(i);
+    }
+
+    for (size_t i = 0; i < m_length; i++) {
+        m_byColumn[i] = static_cast<uint32_t>(i);
+    }
+}
+
+size_t LineColumns::clusterOf(size_t offset) const {
+    auto found =
+        std::upper_bound(m_starts.begin(), m_starts.end(),
+                         static_cast<uint32_t>(offset));
+
+    return static_cast<size_t>(found - m_starts.begin()) - 1;
+}
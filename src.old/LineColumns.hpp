@@ -0,0 +1,85 @@
+#pragma once
+
+// std
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+// Grapheme cluster boundaries and screen columns of one
+// line, so the cursor can move by what the user sees as a
+// character and keep its column across lines of mixed
+// width. Plain ASCII lines, the common case, need no tables
+// at all since every byte is one column.
+//
+// Clusters follow the extended grapheme rules closely
+// enough for editing: combining marks, variation selectors,
+// emoji modifiers and zero width joiner sequences attach to
+// the codepoint before them and regional indicators pair
+// into flags. Malformed bytes are clusters of their own.
+class LineColumns {
+   public:
+    LineColumns() = default;
+    explicit LineColumns(std::string_view line);
+
+    size_t length() const {
+        return m_length;
+    }
+    size_t width() const {
+        return m_ascii ? m_length : m_columns.back();
+    }
+
+    // Column of the cluster containing the byte offset.
+    size_t columnOf(size_t offset) const;
+    // Start of the cluster covering column, or the end of
+    // the line for columns past it.
+    size_t offsetOf(size_t column) const {
+        if (column >= width()) {
+            return m_length;
+        }
+
+        return m_ascii ? column
+                       : m_starts[m_byColumn[column]];
+    }
+
+    // Cluster boundaries around offset.
+    size_t next(size_t offset) const;
+    size_t previous(size_t offset) const;
+
+    // Updates the tables after the bytes [offset, offset +
+    // removed) were replaced by added bytes, both on
+    // cluster boundaries. Only the clusters from the one
+    // before the edit up to where they line up with the
+    // old ones again are segmented anew. window holds the
+    // edited line from previous(offset) on, complete says
+    // whether it reaches the line's end. Returns false,
+    // leaving the tables alone, if the window ends before
+    // the clusters line up.
+    bool splice(size_t offset, size_t removed, size_t added,
+                std::string_view window, bool complete);
+
+    // Bytes held, including the object itself.
+    size_t memoryUsage() const {
+        return sizeof(*this) +
+               (m_starts.capacity() + m_columns.capacity() +
+                m_byColumn.capacity()) *
+                   sizeof(uint32_t);
+    }
+
+   private:
+    // Index of the cluster containing offset.
+    size_t clusterOf(size_t offset) const;
+    // Builds the tables of an ASCII line, one cluster per
+    // byte.
+    void expandAscii();
+
+    size_t m_length = 0;
+    bool m_ascii = true;
+
+    // Byte offset and first column of every cluster, each
+    // followed by the line's length and width.
+    std::vector<uint32_t> m_starts;
+    std::vector<uint32_t> m_columns;
+    // Cluster covering each column.
+    std::vector<uint32_t> m_byColumn;
+};
@@ -0,0 +1,451 @@
+#include "LineIndex.hpp"
+
+#include "Utf8.hpp"
+
+// std
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define LINE_INDEX_X86 1
+#include <immintrin.h>
+#endif
+
+namespace {
+
+void pushMask(std::vector<uint32_t>& out, uint32_t base,
+              uint64_t mask) {
+    while (mask != 0) {
+        out.push_back(base + __builtin_ctzll(mask));
+        mask &= mask - 1;
+    }
+}
+
+// The kernels append the offsets of the newlines in data,
+// shifted by base, to out. A scan never crosses a chunk, so
+// the offsets always fit in 32 bits.
+
+void scanScalar(const char* data, uint32_t base,
+                size_t size, std::vector<uint32_t>& out) {
+    const char* cursor = data;
+    const char* end = data + size;
+
+    while (cursor < end) {
+        auto found = static_cast<const char*>(
+            memchr(cursor, '\n', end - cursor));
+
+        if (found == nullptr) {
+            break;
+        }
+
+        out.push_back(base + (found - data));
+        cursor = found + 1;
+    }
+}
+
+#ifdef LINE_INDEX_X86
+
+// Both vector kernels compare 64 bytes per iteration and
+// walk the resulting bit mask, the tail goes through memchr.
+
+void scanSse2(const char* data, uint32_t base, size_t size,
+              std::vector<uint32_t>& out) {
+    const __m128i newline = _mm_set1_epi8('\n');
+    size_t i = 0;
+
+    for (; i + 64 <= size; i += 64) {
+        auto block =
+            reinterpret_cast<const __m128i*>(data + i);
+
+        uint64_t m0 = static_cast<uint32_t>(_mm_movemask_epi8(
+            _mm_cmpeq_epi8(_mm_loadu_si128(block), newline)));
+        uint64_t m1 = static_cast<uint32_t>(_mm_movemask_epi8(
+            _mm_cmpeq_epi8(_mm_loadu_si128(block + 1),
+                           newline)));
+        uint64_t m2 = static_cast<uint32_t>(_mm_movemask_epi8(
+            _mm_cmpeq_epi8(_mm_loadu_si128(block + 2),
+                           newline)));
+        uint64_t m3 = static_cast<uint32_t>(_mm_movemask_epi8(
+            _mm_cmpeq_epi8(_mm_loadu_si128(block + 3),
+                           newline)));
+
+        pushMask(out, base + i,
+                 m0 | (m1 << 16) | (m2 << 32) | (m3 << 48));
+    }
+
+    scanScalar(data + i, base + i, size - i, out);
+}
+
+__attribute__((target("avx2"))) void scanAvx2(
+    const char* data, uint32_t base, size_t size,
+    std::vector<uint32_t>& out) {
+    const __m256i newline = _mm256_set1_epi8('\n');
+    size_t i = 0;
+
+    for (; i + 64 <= size; i += 64) {
+        auto block =
+            reinterpret_cast<const __m256i*>(data + i);
+
+        uint64_t lo =
+            static_cast<uint32_t>(_mm256_movemask_epi8(
+                _mm256_cmpeq_epi8(_mm256_loadu_si256(block),
+                                  newline)));
+        uint64_t hi =
+            static_cast<uint32_t>(_mm256_movemask_epi8(
+                _mm256_cmpeq_epi8(
+                    _mm256_loadu_si256(block + 1),
+                    newline)));
+
+        pushMask(out, base + i, lo | (hi << 32));
+    }
+
+    scanScalar(data + i, base + i, size - i, out);
+}
+
+#endif
+
+LineIndex::Kernel detectKernel() {
+#ifdef LINE_INDEX_X86
+    __builtin_cpu_init();
+
+    if (__builtin_cpu_supports("avx2")) {
+        return LineIndex::Kernel::Avx2;
+    }
+
+    if (__builtin_cpu_supports("sse2")) {
+        return LineIndex::Kernel::Sse2;
+    }
+#endif
+
+    return LineIndex::Kernel::Scalar;
+}
+
+void scan(LineIndex::Kernel kernel, const char* data,
+          uint32_t base, size_t size,
+          std::vector<uint32_t>& out) {
+    LineIndex::Kernel best = LineIndex::bestKernel();
+
+    // Never run a kernel the CPU can't execute.
+    if (kernel == LineIndex::Kernel::Auto ||
+        (kernel == LineIndex::Kernel::Avx2 &&
+         best != LineIndex::Kernel::Avx2) ||
+        (kernel == LineIndex::Kernel::Sse2 &&
+         best == LineIndex::Kernel::Scalar)) {
+        kernel = best;
+    }
+
+    switch (kernel) {
+#ifdef LINE_INDEX_X86
+        case LineIndex::Kernel::Avx2:
+            scanAvx2(data, base, size, out);
+            break;
+        case LineIndex::Kernel::Sse2:
+            scanSse2(data, base, size, out);
+            break;
+#endif
+        default:
+            scanScalar(data, base, size, out);
+            break;
+    }
+}
+
+}  // namespace
+
+LineIndex::~LineIndex() {
+    cancel();
+}
+
+void LineIndex::build(const char* data, size_t size,
+                      Kernel kernel, bool checkUtf8) {
+    start(data, size, kernel, checkUtf8);
+
+    if (!m_chunks.empty()) {
+        waitForChunk(m_chunks.size() - 1);
+    }
+}
+
+void LineIndex::buildAsync(const char* data, size_t size,
+                           Kernel kernel, bool checkUtf8) {
+    start(data, size, kernel, checkUtf8);
+
+    if (!m_chunks.empty()) {
+        m_running = true;
+        m_thread = std::thread(&LineIndex::run, this);
+    }
+}
+
+void LineIndex::append(const char* data, size_t base,
+                       size_t size, Kernel kernel) {
+    assert(complete() && "append while indexing");
+    assert((m_chunks.empty() ||
+            base >= (m_chunks.size() - 1) * kChunkSize) &&
+           "appended data must follow the indexed data");
+
+    while (size > 0) {
+        size_t chunk = base >> kChunkShift;
+
+        while (m_chunks.size() <= chunk) {
+            size_t before = readyNewlines(m_chunks.size());
+            m_chunks.push_back({before, {}});
+        }
+
+        auto inner =
+            static_cast<uint32_t>(base & (kChunkSize - 1));
+        size_t take =
+            std::min<size_t>(size, kChunkSize - inner);
+
+        scan(kernel, data, inner, take,
+             m_chunks[chunk].newlines);
+
+        data += take;
+        base += take;
+        size -= take;
+    }
+
+    m_ready.store(m_chunks.size(), std::memory_order_release);
+}
+
+void LineIndex::clear() {
+    cancel();
+
+    m_chunks.clear();
+    m_ready.store(0, std::memory_order_release);
+    m_data = nullptr;
+    m_size = 0;
+    m_checkUtf8 = false;
+    m_validUtf8.store(true, std::memory_order_release);
+}
+
+void LineIndex::cancel() {
+    if (m_thread.joinable()) {
+        m_cancel = true;
+        m_thread.join();
+        m_cancel = false;
+    }
+}
+
+double LineIndex::progress() const {
+    if (m_chunks.empty()) {
+        return 1.0;
+    }
+
+    return static_cast<double>(
+               m_ready.load(std::memory_order_acquire)) /
+           static_cast<double>(m_chunks.size());
+}
+
+size_t LineIndex::indexedNewlineCount() const {
+    return readyNewlines(
+        m_ready.load(std::memory_order_acquire));
+}
+
+size_t LineIndex::newlineCount() const {
+    if (m_chunks.empty()) {
+        return 0;
+    }
+
+    waitForChunk(m_chunks.size() - 1);
+    return readyNewlines(m_chunks.size());
+}
+
+uint64_t LineIndex::newline(size_t i) const {
+    [[maybe_unused]] bool found = waitForNewline(i);
+    assert(found && "newline index out of range");
+
+    auto last = m_chunks.begin() +
+                m_ready.load(std::memory_order_acquire);
+
+    // Last chunk starting at or before newline i, it must
+    // contain it since the next one starts past it.
+    auto chunk =
+        std::upper_bound(m_chunks.begin(), last, i,
+                         [](size_t value, const Chunk& chunk) {
+                             return value < chunk.before;
+                         }) -
+        1;
+
+    auto index =
+        static_cast<uint64_t>(chunk - m_chunks.begin());
+
+    return (index << kChunkShift) +
+           chunk->newlines[i - chunk->before];
+}
+
+size_t LineIndex::lowerBound(uint64_t position) const {
+    auto index =
+        static_cast<size_t>(position >> kChunkShift);
+
+    if (index >= m_chunks.size()) {
+        return newlineCount();
+    }
+
+    waitForChunk(index);
+
+    const Chunk& chunk = m_chunks[index];
+    auto found = std::lower_bound(
+        chunk.newlines.begin(), chunk.newlines.end(),
+        static_cast<uint32_t>(position & (kChunkSize - 1)));
+
+    return chunk.before +
+           static_cast<size_t>(found - chunk.newlines.begin());
+}
+
+uint64_t LineIndex::findNewline(uint64_t start, size_t n,
+                                uint64_t end) const {
+    size_t target = lowerBound(start) + n;
+
+    if (!waitForNewline(target, end)) {
+        return npos;
+    }
+
+    uint64_t position = newline(target);
+    return position < end ? position : npos;
+}
+
+size_t LineIndex::memoryUsage() const {
+    size_t ready = m_ready.load(std::memory_order_acquire);
+    size_t bytes = m_chunks.capacity() * sizeof(Chunk);
+
+    for (size_t i = 0; i < ready; i++) {
+        bytes += m_chunks[i].newlines.capacity() *
+                 sizeof(uint32_t);
+    }
+
+    return bytes;
+}
+
+void LineIndex::start(const char* data, size_t size,
+                      Kernel kernel, bool checkUtf8) {
+    clear();
+
+    m_data = data;
+    m_size = size;
+    m_kernel = kernel;
+    m_checkUtf8 = checkUtf8;
+    m_chunks.resize((size + kChunkSize - 1) >> kChunkShift);
+}
+
+void LineIndex::run() {
+    for (size_t i = 0; i < m_chunks.size(); i++) {
+        if (m_cancel) {
+            break;
+        }
+
+        scanChunk(i);
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_ready.store(i + 1, std::memory_order_release);
+        }
+
+        m_chunkReady.notify_all();
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_running = false;
+    }
+
+    m_chunkReady.notify_all();
+}
+
+void LineIndex::scanChunk(size_t index) const {
+    Chunk& chunk = m_chunks[index];
+    uint64_t begin = static_cast<uint64_t>(index)
+                     << kChunkShift;
+
+    chunk.before = readyNewlines(index);
+    chunk.newlines.clear();
+
+    uint64_t end = std::min<uint64_t>(begin + kChunkSize,
+                                      m_size);
+
+    scan(m_kernel, m_data + begin, 0, end - begin,
+         chunk.newlines);
+
+    if (!m_checkUtf8) {
+        return;
+    }
+
+    // A sequence cut by the chunk's start or end is
+    // validated with the chunk it starts in.
+    size_t first =
+        utf8::sequenceBoundary(m_data, m_size, begin);
+    size_t last =
+        utf8::sequenceBoundary(m_data, m_size, end);
+
+    if (first < last &&
+        !utf8::validate(m_data + first, last - first)) {
+        m_validUtf8.store(false, std::memory_order_release);
+    }
+}
+
+void LineIndex::waitForChunk(size_t index) const {
+    if (index < m_ready.load(std::memory_order_acquire)) {
+        return;
+    }
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+
+    while (index >= m_ready.load(std::memory_order_relaxed)) {
+        if (m_running) {
+            m_chunkReady.wait(lock);
+            continue;
+        }
+
+        // Nobody is indexing in the background (anymore), so
+        // index the next chunk here.
+        size_t next = m_ready.load(std::memory_order_relaxed);
+        scanChunk(next);
+        m_ready.store(next + 1, std::memory_order_release);
+    }
+}
+
+bool LineIndex::waitForNewline(size_t i,
+                               uint64_t end) const {
+    while (true) {
+        size_t ready = m_ready.load(std::memory_order_acquire);
+
+        if (readyNewlines(ready) > i) {
+            return true;
+        }
+
+        if (ready == m_chunks.size() ||
+            static_cast<uint64_t>(ready) << kChunkShift >=
+                end) {
+            return false;
+        }
+
+        waitForChunk(ready);
+    }
+}
+
+size_t LineIndex::readyNewlines(size_t ready) const {
+    if (ready == 0) {
+        return 0;
+    }
+
+    const Chunk& last = m_chunks[ready - 1];
+    return last.before + last.newlines.size();
+}
+
+LineIndex::Kernel LineIndex::bestKernel() {
+    static const Kernel kernel = detectKernel();
+    return kernel;
+}
+
+const char* LineIndex::kernelName(Kernel kernel) {
+    switch (kernel) {
+        case Kernel::Auto:
+            return "auto";
+        case Kernel::Scalar:
+            return "scalar";
+        case Kernel::Sse2:
+            return "sse2";
+        case Kernel::Avx2:
+            return "avx2";
+    }
+
+    return "unknown";
+}
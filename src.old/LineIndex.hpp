@@ -0,0 +1,151 @@
+#pragma once
+
+// std
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Table of newline positions for one immutable byte buffer.
+// The buffer is split into fixed-size chunks and each chunk
+// stores its newlines as 32-bit offsets from the chunk
+// start, so a file costs four bytes per line however large
+// it is.
+//
+// The table can be built on a background thread. Chunks are
+// indexed in order and published one at a time; a query
+// only waits for the chunks it actually needs. Building can
+// also check that the buffer is well formed UTF-8 along the
+// way, chunk by chunk.
+class LineIndex {
+   public:
+    enum class Kernel {
+        Auto,
+        Scalar,
+        Sse2,
+        Avx2,
+    };
+
+    static constexpr uint64_t npos =
+        std::numeric_limits<uint64_t>::max();
+
+    LineIndex() = default;
+    ~LineIndex();
+
+    LineIndex(const LineIndex&) = delete;
+    LineIndex& operator=(const LineIndex&) = delete;
+
+    // Replaces the table with the newlines of data, and
+    // validates its UTF-8 if checkUtf8 is set.
+    void build(const char* data, size_t size,
+               Kernel kernel = Kernel::Auto,
+               bool checkUtf8 = false);
+    // Same as build, but indexes on a background thread and
+    // returns immediately. data must stay valid until the
+    // index is complete, cancelled or cleared.
+    void buildAsync(const char* data, size_t size,
+                    Kernel kernel = Kernel::Auto,
+                    bool checkUtf8 = false);
+    // Adds the newlines of data, which starts at position
+    // base of the indexed buffer and must come after
+    // everything indexed so far.
+    void append(const char* data, size_t base, size_t size,
+                Kernel kernel = Kernel::Auto);
+    void clear();
+
+    // Stops the background thread. Chunks it did not get to
+    // are indexed on demand by the queries that need them.
+    void cancel();
+
+    bool complete() const {
+        return m_ready.load(std::memory_order_acquire) ==
+               m_chunks.size();
+    }
+    // Fraction of the buffer indexed so far.
+    double progress() const;
+    // Newlines found so far, never blocks.
+    size_t indexedNewlineCount() const;
+    // False once a malformed UTF-8 sequence was found in the
+    // indexed chunks, never blocks. Only final once the
+    // index is complete. Appended data is not checked.
+    bool validUtf8() const {
+        return m_validUtf8.load(
+            std::memory_order_acquire);
+    }
+
+    size_t newlineCount() const;
+    size_t lineCount() const {
+        return newlineCount() + 1;
+    }
+
+    // Position of the i-th newline.
+    uint64_t newline(size_t i) const;
+    // Offset of the first byte of the given line.
+    uint64_t lineStart(size_t line) const {
+        return line == 0 ? 0 : newline(line - 1) + 1;
+    }
+    // Index of the first newline at or after position.
+    size_t lowerBound(uint64_t position) const;
+    // Number of newlines in [begin, end).
+    size_t countNewlines(uint64_t begin,
+                         uint64_t end) const {
+        return lowerBound(end) - lowerBound(begin);
+    }
+    // Position of the n-th newline in [start, end), or npos
+    // if there are not that many. Only waits for the chunks
+    // up to that newline or end, whichever comes first.
+    uint64_t findNewline(uint64_t start, size_t n,
+                         uint64_t end = npos) const;
+    // Line containing position.
+    size_t lineOf(uint64_t position) const {
+        return lowerBound(position);
+    }
+
+    size_t memoryUsage() const;
+
+    static Kernel bestKernel();
+    static const char* kernelName(Kernel kernel);
+
+   private:
+    static constexpr unsigned kChunkShift = 20;
+    static constexpr uint64_t kChunkSize = uint64_t{1}
+                                           << kChunkShift;
+
+    struct Chunk {
+        // Newlines before this chunk.
+        size_t before = 0;
+        std::vector<uint32_t> newlines;
+    };
+
+    void start(const char* data, size_t size,
+               Kernel kernel, bool checkUtf8);
+    void run();
+    void scanChunk(size_t chunk) const;
+    void waitForChunk(size_t chunk) const;
+    // Waits until the i-th newline is indexed, returns false
+    // if there is no such newline before end.
+    bool waitForNewline(size_t i, uint64_t end = npos) const;
+    size_t readyNewlines(size_t ready) const;
+
+    // Chunks are only written by whoever indexes them
+    // (background thread or a waiting query, never both)
+    // before they are published through m_ready.
+    mutable std::vector<Chunk> m_chunks;
+    mutable std::atomic<size_t> m_ready{0};
+
+    const char* m_data = nullptr;
+    size_t m_size = 0;
+    Kernel m_kernel = Kernel::Auto;
+    bool m_checkUtf8 = false;
+    mutable std::atomic<bool> m_validUtf8{true};
+
+    std::thread m_thread;
+    std::atomic<bool> m_cancel{false};
+    mutable bool m_running = false;
+    mutable std::mutex m_mutex;
+    mutable std::condition_variable m_chunkReady;
+};
@@ -0,0 +1,123 @@
+#include "LineMetadata.hpp"
+
+// std
+#include <algorithm>
+#include <cstring>
+
+void LineMetadata::clear() {
+    m_arena.reset();
+    m_capacity = 0;
+    m_size = 0;
+    m_gapStart = 0;
+    m_gapEnd = 0;
+}
+
+void LineMetadata::splice(size_t line, size_t removed,
+                          size_t added) {
+    if (line >= m_size) {
+        return;
+    }
+
+    removed = std::min(removed, m_size - line);
+
+    moveGap(line);
+    m_gapEnd += removed;
+    m_size -= removed;
+
+    reserveGap(added);
+    fillGap(added);
+}
+
+void LineMetadata::invalidate(size_t line) {
+    if (line >= m_size) {
+        return;
+    }
+
+    size_t index = physical(line);
+    widths()[index] = kUnknownWidth;
+    states()[index] = kUnknownState;
+}
+
+size_t LineMetadata::slot(size_t line) {
+    if (line >= m_size) {
+        moveGap(m_size);
+        reserveGap(line + 1 - m_size);
+        fillGap(line + 1 - m_size);
+    }
+
+    return physical(line);
+}
+
+void LineMetadata::moveGap(size_t line) {
+    if (line == m_gapStart) {
+        return;
+    }
+
+    size_t gap = m_gapEnd - m_gapStart;
+
+    // Entries between the old and the new gap position
+    // cross the gap, in every field.
+    size_t from = line < m_gapStart ? line : m_gapEnd;
+    size_t to = line < m_gapStart ? line + gap : m_gapStart;
+    size_t count = line < m_gapStart ? m_gapStart - line
+                                     : line - m_gapStart;
+
+    std::memmove(widths() + to, widths() + from,
+                 count * sizeof(uint32_t));
+    std::memmove(states() + to, states() + from,
+                 count * sizeof(uint16_t));
+    std::memmove(folds() + to, folds() + from, count);
+
+    m_gapStart = line;
+    m_gapEnd = line + gap;
+}
+
+void LineMetadata::reserveGap(size_t count) {
+    if (m_gapEnd - m_gapStart >= count) {
+        return;
+    }
+
+    size_t capacity = std::max({m_size + count,
+                                m_capacity * 2, kMinCapacity});
+    size_t tail = m_capacity - m_gapEnd;
+    size_t newGapEnd = capacity - tail;
+
+    // The new block is laid out like the old one with a
+    // larger gap, field by field.
+    std::unique_ptr<uint8_t[]> arena(
+        new uint8_t[capacity * kBytesPerLine]);
+
+    auto* newWidths = reinterpret_cast<uint32_t*>(arena.get());
+    auto* newStates = reinterpret_cast<uint16_t*>(
+        arena.get() + capacity * sizeof(uint32_t));
+    uint8_t* newFolds =
+        arena.get() +
+        capacity * (sizeof(uint32_t) + sizeof(uint16_t));
+
+    if (m_arena) {
+        std::memcpy(newWidths, widths(),
+                    m_gapStart * sizeof(uint32_t));
+        std::memcpy(newWidths + newGapEnd, widths() + m_gapEnd,
+                    tail * sizeof(uint32_t));
+        std::memcpy(newStates, states(),
+                    m_gapStart * sizeof(uint16_t));
+        std::memcpy(newStates + newGapEnd, states() + m_gapEnd,
+                    tail * sizeof(uint16_t));
+        std::memcpy(newFolds, folds(), m_gapStart);
+        std::memcpy(newFolds + newGapEnd, folds() + m_gapEnd,
+                    tail);
+    }
+
+    m_arena = std::move(arena);
+    m_capacity = capacity;
+    m_gapEnd = newGapEnd;
+}
+
+void LineMetadata::fillGap(size_t count) {
+    std::fill_n(widths() + m_gapStart, count, kUnknownWidth);
+    std::fill_n(states() + m_gapStart, count, kUnknownState);
+    std::fill_n(folds() + m_gapStart, count, uint8_t{0});
+
+    m_gapStart += count;
+    m_size += count;
+}
@@ -0,0 +1,120 @@
+#pragma once
+
+// std
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+
+// Per-line state the view keeps on top of the text: the
+// cached display width, the highlighter's state at the end
+// of the line and the fold level. Offsets and lengths are
+// not repeated here, the storage's line index already has
+// them.
+//
+// Every field is its own array so a pass over the viewport
+// only reads the fields it uses, and all arrays are carved
+// out of one arena block, seven bytes per line. The arrays
+// share a gap at the last edited line, which makes adding
+// and removing lines where the user is typing cheap even
+// in files with millions of lines.
+//
+// Entries are only created for lines that were touched, so
+// opening a file costs nothing until it is displayed.
+class LineMetadata {
+   public:
+    static constexpr uint32_t kUnknownWidth =
+        std::numeric_limits<uint32_t>::max();
+    static constexpr uint16_t kUnknownState =
+        std::numeric_limits<uint16_t>::max();
+
+    LineMetadata() = default;
+
+    LineMetadata(const LineMetadata&) = delete;
+    LineMetadata& operator=(const LineMetadata&) = delete;
+
+    // Lines that have an entry.
+    size_t size() const {
+        return m_size;
+    }
+    void clear();
+
+    // Replaces the entries of lines [line, line + removed)
+    // with added fresh ones, e.g. 1 and 2 when a newline is
+    // typed into a line.
+    void splice(size_t line, size_t removed, size_t added);
+    // Forgets the width and highlight state of an edited
+    // line, its fold level stays.
+    void invalidate(size_t line);
+
+    uint32_t width(size_t line) const {
+        return line < m_size ? widths()[physical(line)]
+                             : kUnknownWidth;
+    }
+    void setWidth(size_t line, uint32_t width) {
+        size_t index = slot(line);
+        widths()[index] = width;
+    }
+
+    uint16_t highlightState(size_t line) const {
+        return line < m_size ? states()[physical(line)]
+                             : kUnknownState;
+    }
+    void setHighlightState(size_t line, uint16_t state) {
+        size_t index = slot(line);
+        states()[index] = state;
+    }
+
+    uint8_t foldLevel(size_t line) const {
+        return line < m_size ? folds()[physical(line)] : 0;
+    }
+    void setFoldLevel(size_t line, uint8_t level) {
+        size_t index = slot(line);
+        folds()[index] = level;
+    }
+
+    size_t memoryUsage() const {
+        return m_capacity * kBytesPerLine;
+    }
+
+   private:
+    static constexpr size_t kBytesPerLine =
+        sizeof(uint32_t) + sizeof(uint16_t) + sizeof(uint8_t);
+    static constexpr size_t kMinCapacity = 1024;
+
+    size_t physical(size_t line) const {
+        return line < m_gapStart
+                   ? line
+                   : line + (m_gapEnd - m_gapStart);
+    }
+    // Physical index of line, creating the entries up to it.
+    size_t slot(size_t line);
+
+    void moveGap(size_t line);
+    // Makes the gap at least count entries long.
+    void reserveGap(size_t count);
+    // Fills count fresh entries at the start of the gap and
+    // moves them out of it.
+    void fillGap(size_t count);
+
+    uint32_t* widths() const {
+        return reinterpret_cast<uint32_t*>(m_arena.get());
+    }
+    uint16_t* states() const {
+        return reinterpret_cast<uint16_t*>(
+            m_arena.get() + m_capacity * sizeof(uint32_t));
+    }
+    uint8_t* folds() const {
+        return m_arena.get() +
+               m_capacity * (sizeof(uint32_t) + sizeof(uint16_t));
+    }
+
+    std::unique_ptr<uint8_t[]> m_arena;
+    size_t m_capacity = 0;
+    size_t m_size = 0;
+
+    // Physical range of unused entries, logical line
+    // m_gapStart is stored at m_gapEnd.
+    size_t m_gapStart = 0;
+    size_t m_gapEnd = 0;
+};
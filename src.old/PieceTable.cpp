@@ -0,0 +1,381 @@
+#include "PieceTable.hpp"
+
+// std
+#include <algorithm>
+#include <cassert>
+
+void PieceTable::load(FileBuffer original) {
+    clear();
+
+    m_buffers.load(std::move(original));
+
+    const FileBuffer& buffer = m_buffers.original();
+
+    // The newlines are still being indexed, they are
+    // counted as edits and line lookups get to them.
+    if (buffer.size() > 0) {
+        m_pieces.push_back({Source::Original, 0, buffer.size(),
+                            kUnknownNewlines});
+        m_newlines = kUnknownNewlines;
+        m_uncounted = true;
+    }
+
+    m_size = buffer.size();
+}
+
+void PieceTable::clear() {
+    m_buffers.clear();
+    m_pieces.clear();
+    m_size = 0;
+    m_newlines = 0;
+    m_uncounted = false;
+}
+
+size_t PieceTable::lineCount() const {
+    if (m_newlines == kUnknownNewlines) {
+        size_t newlines = 0;
+
+        for (const auto& piece : m_pieces) {
+            newlines += newlinesOf(piece);
+        }
+
+        m_newlines = newlines;
+    }
+
+    return m_newlines + 1;
+}
+
+size_t PieceTable::lineStart(size_t line) const {
+    size_t start = findLine(line);
+    return start == kNoLine ? m_size : start;
+}
+
+size_t PieceTable::lineOf(size_t offset) const {
+    auto [index, inner] = locate(offset);
+    size_t line = 0;
+
+    for (size_t i = 0; i < index; i++) {
+        line += newlinesOf(m_pieces[i]);
+    }
+
+    if (index < m_pieces.size()) {
+        const Piece& piece = m_pieces[index];
+        line += countNewlines(piece.source, piece.start, inner);
+    }
+
+    return line;
+}
+
+char PieceTable::at(size_t offset) const {
+    assert(offset < m_size && "offset out of range");
+
+    auto [index, inner] = locate(offset);
+    const Piece& piece = m_pieces[index];
+
+    return m_buffers.data(piece.source)[piece.start + inner];
+}
+
+void PieceTable::forEachChunk(size_t offset, size_t length,
+                              const ChunkFn& fn) const {
+    if (offset >= m_size) {
+        return;
+    }
+
+    length = std::min(length, m_size - offset);
+
+    auto [index, inner] = locate(offset);
+
+    while (length > 0 && index < m_pieces.size()) {
+        const Piece& piece = m_pieces[index];
+        size_t take = std::min(length, piece.length - inner);
+
+        fn(m_buffers.data(piece.source) + piece.start + inner,
+           take);
+
+        length -= take;
+        inner = 0;
+        index++;
+    }
+}
+
+void PieceTable::insert(size_t offset,
+                        std::string_view text) {
+    assert(offset <= m_size && "offset out of range");
+
+    if (text.empty()) {
+        return;
+    }
+
+    size_t start = m_buffers.append(text);
+    insertSpans(offset, {{Source::Add, start, text.size()}});
+}
+
+void PieceTable::insertSpans(
+    size_t offset, const std::vector<TextSpan>& spans) {
+    assert(offset <= m_size && "offset out of range");
+
+    countPieces();
+
+    // Spans of the original file are left uncounted while
+    // the total is, like the pieces they come from.
+    bool counted = m_newlines != kUnknownNewlines;
+    std::vector<Piece> added;
+
+    for (const auto& span : spans) {
+        if (span.length == 0) {
+            continue;
+        }
+
+        size_t newlines =
+            counted || span.source == Source::Add
+                ? countNewlines(span.source, span.start,
+                                span.length)
+                : kUnknownNewlines;
+
+        added.push_back(
+            {span.source, span.start, span.length, newlines});
+
+        m_size += span.length;
+
+        if (counted) {
+            m_newlines += newlines;
+        }
+    }
+
+    if (added.empty()) {
+        return;
+    }
+
+    auto [index, inner] = locate(offset);
+
+    // Typing usually appends to the piece that was created
+    // by the previous keystroke, so just grow it.
+    if (inner == 0 && index > 0) {
+        Piece& previous = m_pieces[index - 1];
+        const Piece& first = added.front();
+
+        if (previous.source == first.source &&
+            previous.start + previous.length == first.start &&
+            (previous.newlines == kUnknownNewlines) ==
+                (first.newlines == kUnknownNewlines)) {
+            previous.length += first.length;
+
+            if (first.newlines != kUnknownNewlines) {
+                previous.newlines += first.newlines;
+            }
+
+            added.erase(added.begin());
+        }
+    }
+
+    if (inner > 0) {
+        Piece& piece = m_pieces[index];
+        Piece right{piece.source, piece.start + inner,
+                    piece.length - inner, kUnknownNewlines};
+
+        // Splitting a piece the indexer hasn't reached
+        // leaves both halves uncounted instead of waiting
+        // for it.
+        if (piece.newlines != kUnknownNewlines) {
+            size_t leftNewlines =
+                countNewlines(piece.source, piece.start, inner);
+
+            right.newlines = piece.newlines - leftNewlines;
+            piece.newlines = leftNewlines;
+        }
+
+        piece.length = inner;
+        added.push_back(right);
+        index++;
+    }
+
+    m_pieces.insert(m_pieces.begin() + index, added.begin(),
+                    added.end());
+}
+
+void PieceTable::erase(size_t offset, size_t length) {
+    if (offset >= m_size || length == 0) {
+        return;
+    }
+
+    length = std::min(length, m_size - offset);
+
+    countPieces();
+
+    // Removed newlines only need counting when the total or
+    // the piece count they are subtracted from is known.
+    bool counted = m_newlines != kUnknownNewlines;
+
+    auto [index, inner] = locate(offset);
+
+    if (inner > 0) {
+        Piece& piece = m_pieces[index];
+        bool known = piece.newlines != kUnknownNewlines;
+
+        // The whole range lies inside one piece, which
+        // becomes its head and its tail.
+        if (inner + length < piece.length) {
+            Piece right{piece.source,
+                        piece.start + inner + length,
+                        piece.length - inner - length,
+                        kUnknownNewlines};
+
+            if (known || counted) {
+                size_t leftNewlines = countNewlines(
+                    piece.source, piece.start, inner);
+                size_t removedNewlines =
+                    countNewlines(piece.source,
+                                  piece.start + inner, length);
+
+                if (known) {
+                    right.newlines = piece.newlines -
+                                     leftNewlines -
+                                     removedNewlines;
+                    piece.newlines = leftNewlines;
+                }
+
+                if (counted) {
+                    m_newlines -= removedNewlines;
+                }
+            }
+
+            piece.length = inner;
+            m_pieces.insert(m_pieces.begin() + index + 1,
+                            right);
+
+            m_size -= length;
+            return;
+        }
+
+        size_t removed = piece.length - inner;
+
+        if (known || counted) {
+            size_t removedNewlines = countNewlines(
+                piece.source, piece.start + inner, removed);
+
+            if (known) {
+                piece.newlines -= removedNewlines;
+            }
+
+            if (counted) {
+                m_newlines -= removedNewlines;
+            }
+        }
+
+        piece.length = inner;
+
+        m_size -= removed;
+        length -= removed;
+        index++;
+    }
+
+    size_t first = index;
+
+    while (length > 0 && index < m_pieces.size()) {
+        Piece& piece = m_pieces[index];
+        bool known = piece.newlines != kUnknownNewlines;
+
+        if (piece.length > length) {
+            if (known || counted) {
+                size_t removedNewlines = countNewlines(
+                    piece.source, piece.start, length);
+
+                if (known) {
+                    piece.newlines -= removedNewlines;
+                }
+
+                if (counted) {
+                    m_newlines -= removedNewlines;
+                }
+            }
+
+            piece.start += length;
+            piece.length -= length;
+
+            m_size -= length;
+            break;
+        }
+
+        if (counted) {
+            m_newlines -= newlinesOf(piece);
+        }
+
+        m_size -= piece.length;
+        length -= piece.length;
+        index++;
+    }
+
+    m_pieces.erase(m_pieces.begin() + first,
+                   m_pieces.begin() + index);
+}
+
+size_t PieceTable::findLine(size_t line) const {
+    if (line == 0) {
+        return 0;
+    }
+
+    size_t remaining = line;
+    size_t offset = 0;
+
+    for (const auto& piece : m_pieces) {
+        if (piece.newlines == kUnknownNewlines) {
+            uint64_t newline = m_buffers.findNewline(
+                piece.source, piece.start, piece.length,
+                remaining - 1);
+
+            if (newline != LineIndex::npos) {
+                return offset + (newline - piece.start) + 1;
+            }
+
+            // The piece has been indexed to its end by now, so
+            // counting it doesn't wait.
+            remaining -= newlinesOf(piece);
+        } else if (remaining <= piece.newlines) {
+            size_t newline = m_buffers.nthNewline(
+                piece.source, piece.start, remaining - 1);
+            return offset + (newline - piece.start) + 1;
+        } else {
+            remaining -= piece.newlines;
+        }
+
+        offset += piece.length;
+    }
+
+    return kNoLine;
+}
+
+void PieceTable::countPieces() {
+    if (!m_uncounted ||
+        !m_buffers.lines(Source::Original).complete()) {
+        return;
+    }
+
+    size_t newlines = 0;
+
+    for (auto& piece : m_pieces) {
+        if (piece.newlines == kUnknownNewlines) {
+            piece.newlines = countNewlines(
+                piece.source, piece.start, piece.length);
+        }
+
+        newlines += piece.newlines;
+    }
+
+    m_newlines = newlines;
+    m_uncounted = false;
+}
+
+std::pair<size_t, size_t> PieceTable::locate(
+    size_t offset) const {
+    size_t start = 0;
+
+    for (size_t i = 0; i < m_pieces.size(); i++) {
+        if (offset < start + m_pieces[i].length) {
+            return {i, offset - start};
+        }
+
+        start += m_pieces[i].length;
+    }
+
+    return {m_pieces.size(), 0};
+}
@@ -0,0 +1,108 @@
+#pragma once
+
+#include "TextStorage.hpp"
+
+// std
+#include <cstddef>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+// Piece table text storage. The document is described by a
+// list of pieces, each one referring to a span of either
+// the read-only original buffer (the file as it was opened,
+// usually memory mapped) or the append-only add buffer
+// (everything typed since).
+// Neither buffer is ever modified in place, so an edit only
+// has to split and insert pieces.
+class PieceTable : public TextStorage {
+   public:
+    using Source = TextSource;
+
+    // Newline count of pieces of the original file that
+    // the background indexer may not have reached yet.
+    static constexpr size_t kUnknownNewlines =
+        static_cast<size_t>(-1);
+
+    struct Piece {
+        Source source;
+        size_t start;
+        size_t length;
+        size_t newlines;
+    };
+
+    PieceTable() = default;
+    ~PieceTable() override = default;
+
+    PieceTable(const PieceTable&) = delete;
+    PieceTable& operator=(const PieceTable&) = delete;
+
+    void load(FileBuffer original) override;
+    void clear() override;
+
+    size_t size() const override {
+        return m_size;
+    }
+    size_t lineCount() const override;
+    size_t lineStart(size_t line) const override;
+    size_t lineOf(size_t offset) const override;
+    bool hasLine(size_t line) const override {
+        return findLine(line) != kNoLine;
+    }
+
+    char at(size_t offset) const override;
+    void forEachChunk(size_t offset, size_t length,
+                      const ChunkFn& fn) const override;
+
+    void insert(size_t offset,
+                std::string_view text) override;
+    void insertSpans(
+        size_t offset,
+        const std::vector<TextSpan>& spans) override;
+    void erase(size_t offset, size_t length) override;
+
+    size_t memoryUsage() const override {
+        return m_buffers.memoryUsage() +
+               m_pieces.capacity() * sizeof(Piece);
+    }
+
+    const std::vector<Piece>& pieces() const {
+        return m_pieces;
+    }
+
+   private:
+    static constexpr size_t kNoLine = static_cast<size_t>(-1);
+
+    // Start of the given line, or kNoLine if the document
+    // has fewer lines. Only waits for the indexer to reach
+    // that line.
+    size_t findLine(size_t line) const;
+
+    // Returns the index of the piece containing offset and
+    // the offset within that piece. An offset equal to the
+    // document size maps to one past the last piece.
+    std::pair<size_t, size_t> locate(size_t offset) const;
+
+    // Counts the pieces left uncounted during loading once
+    // the indexer is done, so lookups stop searching them.
+    void countPieces();
+
+    size_t countNewlines(Source source, size_t start,
+                         size_t length) const {
+        return m_buffers.countNewlines(source, start, length);
+    }
+    size_t newlinesOf(const Piece& piece) const {
+        return piece.newlines != kUnknownNewlines
+                   ? piece.newlines
+                   : countNewlines(piece.source, piece.start,
+                                   piece.length);
+    }
+
+    std::vector<Piece> m_pieces;
+    size_t m_size = 0;
+    // Total newline count, resolved on first use while the
+    // original file is being indexed.
+    mutable size_t m_newlines = 0;
+    // Some piece still has kUnknownNewlines.
+    bool m_uncounted = false;
+};
@@ -0,0 +1,68 @@
+#include "RedrawScheduler.hpp"
+
+// std
+#include <algorithm>
+#include <cmath>
+
+void RedrawScheduler::animateUntil(double time) {
+    m_animationEnd = std::max(m_animationEnd, time);
+}
+
+void RedrawScheduler::restartBlink(double now) {
+    m_blinkStart = now;
+
+    if (!m_drawnCursorVisible) {
+        invalidate(kCursor);
+    }
+}
+
+void RedrawScheduler::setBlinking(bool blinking,
+                                  double now) {
+    m_blinking = blinking;
+    restartBlink(now);
+}
+
+bool RedrawScheduler::cursorVisible(double now) const {
+    double elapsed = now - m_blinkStart;
+
+    if (!m_blinking || elapsed < 0.0 ||
+        elapsed >= m_blinkDuration) {
+        return true;
+    }
+
+    // Shown for the first half of every period.
+    return std::fmod(elapsed, 2 * m_blinkPeriod) <
+           m_blinkPeriod;
+}
+
+bool RedrawScheduler::needsFrame(double now) const {
+    return m_dirty != 0 || animating() ||
+           cursorVisible(now) != m_drawnCursorVisible;
+}
+
+double RedrawScheduler::timeout(double now) const {
+    if (needsFrame(now)) {
+        return 0.0;
+    }
+
+    double elapsed = now - m_blinkStart;
+
+    if (!m_blinking || elapsed < 0.0 ||
+        elapsed >= m_blinkDuration) {
+        return kForever;
+    }
+
+    double toggle =
+        m_blinkPeriod - std::fmod(elapsed, m_blinkPeriod);
+
+    // The last toggle may fall after blinking stopped, the
+    // cursor is due to show at the stop either way.
+    return std::min(toggle, m_blinkDuration - elapsed);
+}
+
+void RedrawScheduler::frameDrawn(double now) {
+    m_dirty = 0;
+    m_lastFrame = now;
+    m_drawnCursorVisible = cursorVisible(now);
+    m_frames++;
+}
@@ -0,0 +1,90 @@
+#pragma once
+
+// std
+#include <cstdint>
+#include <limits>
+
+// Decides when the editor has to draw a frame and how long
+// the main loop may sleep in between.
+//
+// Anything that changes what is on screen marks the
+// scheduler dirty with a reason. Time driven changes are
+// known in advance: the cursor blinks on a fixed period and
+// animations ask for frames until they end. When nothing is
+// dirty the loop blocks for events, waking up only for the
+// next blink, so an idle editor costs two frames a second
+// and none at all once the cursor stops blinking.
+//
+// Times are in seconds on any monotonic clock.
+class RedrawScheduler {
+   public:
+    enum Reason : uint32_t {
+        kText = 1 << 0,
+        kCursor = 1 << 1,
+        kScroll = 1 << 2,
+        kResize = 1 << 3,
+        kExpose = 1 << 4,
+        kZoom = 1 << 5,
+    };
+
+    static constexpr double kForever =
+        std::numeric_limits<double>::infinity();
+    static constexpr double kBlinkPeriod = 0.5;
+    // Like most desktops the cursor stops blinking, shown,
+    // after a while without input.
+    static constexpr double kBlinkDuration = 10.0;
+
+    explicit RedrawScheduler(
+        double blinkPeriod = kBlinkPeriod,
+        double blinkDuration = kBlinkDuration)
+        : m_blinkPeriod(blinkPeriod),
+          m_blinkDuration(blinkDuration) {
+    }
+
+    void invalidate(uint32_t reasons) {
+        m_dirty |= reasons;
+    }
+    uint32_t dirty() const {
+        return m_dirty;
+    }
+
+    // Keeps frames coming until time, and one more after
+    // it so the final state of the animation is drawn.
+    void animateUntil(double time);
+
+    // Shows the cursor and starts blinking again, for when
+    // it moved or text was typed.
+    void restartBlink(double now);
+    // Blinking is off while the window is not focused.
+    void setBlinking(bool blinking, double now);
+    bool cursorVisible(double now) const;
+
+    bool needsFrame(double now) const;
+    // How long the loop can wait for events before a frame
+    // is due on its own: zero if one is due now, kForever
+    // if only input can make one due.
+    double timeout(double now) const;
+
+    void frameDrawn(double now);
+
+    uint64_t frameCount() const {
+        return m_frames;
+    }
+
+   private:
+    bool animating() const {
+        return m_lastFrame < m_animationEnd;
+    }
+
+    double m_blinkPeriod;
+    double m_blinkDuration;
+
+    // Nothing has been drawn yet.
+    uint32_t m_dirty = kExpose;
+    bool m_blinking = true;
+    double m_blinkStart = 0.0;
+    bool m_drawnCursorVisible = true;
+    double m_animationEnd = -kForever;
+    double m_lastFrame = -kForever;
+    uint64_t m_frames = 0;
+};
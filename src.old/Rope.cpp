@@ -0,0 +1,760 @@
+#include "Rope.hpp"
+
+#include "Utf8.hpp"
+
+// std
+#include <algorithm>
+#include <cassert>
+#include <iterator>
+#include <utility>
+
+struct Rope::Node {
+    bool leaf = true;
+    Summary summary;
+    std::vector<Span> spans;
+    std::vector<NodePtr> children;
+
+    size_t entries() const {
+        return leaf ? spans.size() : children.size();
+    }
+
+    void recompute() {
+        summary = Summary{};
+
+        if (leaf) {
+            for (const auto& span : spans) {
+                summary += span.summary;
+            }
+        } else {
+            for (const auto& child : children) {
+                summary += child->summary;
+            }
+        }
+    }
+};
+
+Rope::Rope() : m_root(std::make_unique<Node>()) {
+}
+
+Rope::~Rope() = default;
+
+void Rope::load(FileBuffer original) {
+    clear();
+
+    m_buffers.load(std::move(original));
+
+    // Span summaries need newline counts, so unlike the
+    // piece table the rope follows the background indexer
+    // and is only ready once the whole file is indexed.
+    std::vector<Span> spans;
+    appendSpans(TextSource::Original, 0,
+                m_buffers.original().size(), spans);
+
+    if (spans.empty()) {
+        return;
+    }
+
+    // Bulk load bottom up, packing every node full.
+    std::vector<NodePtr> level;
+
+    for (size_t i = 0; i < spans.size(); i += kMaxEntries) {
+        auto leaf = std::make_unique<Node>();
+        size_t end = std::min(spans.size(), i + kMaxEntries);
+
+        leaf->spans.assign(spans.begin() + i,
+                           spans.begin() + end);
+        leaf->recompute();
+        level.push_back(std::move(leaf));
+    }
+
+    while (level.size() > 1) {
+        std::vector<NodePtr> parents;
+
+        for (size_t i = 0; i < level.size();
+             i += kMaxEntries) {
+            auto parent = std::make_unique<Node>();
+            size_t end = std::min(level.size(), i + kMaxEntries);
+
+            parent->leaf = false;
+            parent->children.insert(
+                parent->children.end(),
+                std::make_move_iterator(level.begin() + i),
+                std::make_move_iterator(level.begin() + end));
+            parent->recompute();
+            parents.push_back(std::move(parent));
+        }
+
+        level = std::move(parents);
+    }
+
+    m_root = std::move(level.front());
+}
+
+void Rope::clear() {
+    m_buffers.clear();
+    m_root = std::make_unique<Node>();
+}
+
+size_t Rope::size() const {
+    return m_root->summary.bytes;
+}
+
+size_t Rope::lineCount() const {
+    return m_root->summary.newlines + 1;
+}
+
+size_t Rope::lineStart(size_t line) const {
+    if (line == 0) {
+        return 0;
+    }
+
+    if (line >= lineCount()) {
+        return size();
+    }
+
+    // Find the line-th newline, counting from one.
+    size_t remaining = line;
+    size_t offset = 0;
+    const Node* node = m_root.get();
+
+    while (!node->leaf) {
+        for (const auto& child : node->children) {
+            if (remaining <= child->summary.newlines) {
+                node = child.get();
+                break;
+            }
+
+            remaining -= child->summary.newlines;
+            offset += child->summary.bytes;
+        }
+    }
+
+    for (const auto& span : node->spans) {
+        if (remaining <= span.summary.newlines) {
+            size_t newline = m_buffers.nthNewline(
+                span.source, span.start, remaining - 1);
+            return offset + (newline - span.start) + 1;
+        }
+
+        remaining -= span.summary.newlines;
+        offset += span.summary.bytes;
+    }
+
+    assert(false && "rope summaries are inconsistent");
+    return size();
+}
+
+size_t Rope::lineOf(size_t offset) const {
+    if (offset >= size()) {
+        return m_root->summary.newlines;
+    }
+
+    size_t line = 0;
+    const Node* node = m_root.get();
+
+    while (!node->leaf) {
+        for (const auto& child : node->children) {
+            if (offset < child->summary.bytes) {
+                node = child.get();
+                break;
+            }
+
+            offset -= child->summary.bytes;
+            line += child->summary.newlines;
+        }
+    }
+
+    for (const auto& span : node->spans) {
+        if (offset < span.summary.bytes) {
+            return line + m_buffers.countNewlines(
+                              span.source, span.start, offset);
+        }
+
+        offset -= span.summary.bytes;
+        line += span.summary.newlines;
+    }
+
+    return line;
+}
+
+TextPosition Rope::positionOf(size_t offset) const {
+    offset = std::min(offset, size());
+
+    TextPosition position;
+    position.line = lineOf(offset);
+    position.column =
+        codepointsBefore(offset) -
+        codepointsBefore(lineStart(position.line));
+
+    return position;
+}
+
+size_t Rope::offsetOf(TextPosition position) const {
+    if (position.line >= lineCount()) {
+        return size();
+    }
+
+    size_t start = lineStart(position.line);
+    size_t end = start + lineLength(position.line);
+    size_t first = codepointsBefore(start);
+
+    return std::min(
+        offsetOfCodepoint(first + position.column), end);
+}
+
+char Rope::at(size_t offset) const {
+    assert(offset < size() && "offset out of range");
+
+    const Node* node = m_root.get();
+
+    while (!node->leaf) {
+        for (const auto& child : node->children) {
+            if (offset < child->summary.bytes) {
+                node = child.get();
+                break;
+            }
+
+            offset -= child->summary.bytes;
+        }
+    }
+
+    for (const auto& span : node->spans) {
+        if (offset < span.summary.bytes) {
+            return m_buffers.data(span.source)[span.start +
+                                               offset];
+        }
+
+        offset -= span.summary.bytes;
+    }
+
+    return '\0';
+}
+
+void Rope::forEachChunk(size_t offset, size_t length,
+                        const ChunkFn& fn) const {
+    if (offset >= size()) {
+        return;
+    }
+
+    length = std::min(length, size() - offset);
+
+    // Walk the tree in order, skipping whole subtrees that
+    // end before offset.
+    struct Walker {
+        const TextBuffers& buffers;
+        const ChunkFn& fn;
+        size_t skip;
+        size_t remaining;
+
+        void visit(const Node& node) {
+            if (node.leaf) {
+                for (const auto& span : node.spans) {
+                    if (remaining == 0) {
+                        return;
+                    }
+
+                    size_t bytes = span.summary.bytes;
+
+                    if (skip >= bytes) {
+                        skip -= bytes;
+                        continue;
+                    }
+
+                    size_t take =
+                        std::min(remaining, bytes - skip);
+                    fn(buffers.data(span.source) +
+                           span.start + skip,
+                       take);
+
+                    remaining -= take;
+                    skip = 0;
+                }
+
+                return;
+            }
+
+            for (const auto& child : node.children) {
+                if (remaining == 0) {
+                    return;
+                }
+
+                if (skip >= child->summary.bytes) {
+                    skip -= child->summary.bytes;
+                    continue;
+                }
+
+                visit(*child);
+            }
+        }
+    };
+
+    Walker walker{m_buffers, fn, offset, length};
+    walker.visit(*m_root);
+}
+
+void Rope::insert(size_t offset, std::string_view text) {
+    assert(offset <= size() && "offset out of range");
+
+    if (text.empty()) {
+        return;
+    }
+
+    size_t start = m_buffers.append(text);
+
+    std::vector<Span> spans;
+    appendSpans(TextSource::Add, start, text.size(), spans);
+
+    growRoot(insertInto(*m_root, offset, spans));
+}
+
+void Rope::insertSpans(size_t offset,
+                       const std::vector<TextSpan>& spans) {
+    assert(offset <= size() && "offset out of range");
+
+    std::vector<Span> added;
+
+    for (const auto& span : spans) {
+        appendSpans(span.source, span.start, span.length,
+                    added);
+    }
+
+    if (added.empty()) {
+        return;
+    }
+
+    growRoot(insertInto(*m_root, offset, added));
+}
+
+void Rope::erase(size_t offset, size_t length) {
+    if (offset >= size() || length == 0) {
+        return;
+    }
+
+    length = std::min(length, size() - offset);
+
+    growRoot(eraseFrom(*m_root, offset, length));
+    shrinkRoot();
+}
+
+size_t Rope::memoryUsage() const {
+    struct Counter {
+        size_t bytes = 0;
+
+        void visit(const Node& node) {
+            bytes += sizeof(Node) +
+                     node.spans.capacity() * sizeof(Span) +
+                     node.children.capacity() *
+                         sizeof(NodePtr);
+
+            for (const auto& child : node.children) {
+                visit(*child);
+            }
+        }
+    };
+
+    Counter counter;
+    counter.visit(*m_root);
+
+    return m_buffers.memoryUsage() + counter.bytes;
+}
+
+size_t Rope::height() const {
+    size_t height = 1;
+
+    for (const Node* node = m_root.get(); !node->leaf;
+         node = node->children.front().get()) {
+        height++;
+    }
+
+    return height;
+}
+
+Rope::Summary Rope::summarize(TextSource source,
+                              size_t start,
+                              size_t length) const {
+    Summary summary;
+    summary.bytes = length;
+    summary.newlines =
+        m_buffers.countNewlines(source, start, length);
+    summary.codepoints = utf8::countCodepoints(
+        m_buffers.data(source) + start, length);
+
+    return summary;
+}
+
+void Rope::appendSpans(TextSource source, size_t start,
+                       size_t length,
+                       std::vector<Span>& out) const {
+    while (length > 0) {
+        size_t take = std::min(length, kMaxSpan);
+
+        out.push_back(
+            {source, start, summarize(source, start, take)});
+
+        start += take;
+        length -= take;
+    }
+}
+
+std::vector<Rope::NodePtr> Rope::insertInto(
+    Node& node, size_t offset, std::vector<Span>& spans) {
+    if (!node.leaf) {
+        // At a boundary prefer the left subtree, so typing
+        // at the end of a span can extend it.
+        size_t index = 0;
+
+        while (index + 1 < node.children.size() &&
+               offset > node.children[index]->summary.bytes) {
+            offset -= node.children[index]->summary.bytes;
+            index++;
+        }
+
+        auto siblings =
+            insertInto(*node.children[index], offset, spans);
+
+        node.children.insert(
+            node.children.begin() + index + 1,
+            std::make_move_iterator(siblings.begin()),
+            std::make_move_iterator(siblings.end()));
+        node.recompute();
+
+        return splitOverflow(node);
+    }
+
+    size_t index = 0;
+
+    while (index < node.spans.size() &&
+           offset > node.spans[index].summary.bytes) {
+        offset -= node.spans[index].summary.bytes;
+        index++;
+    }
+
+    if (index == node.spans.size()) {
+        node.spans.insert(node.spans.end(), spans.begin(),
+                          spans.end());
+    } else if (offset == 0) {
+        node.spans.insert(node.spans.begin() + index,
+                          spans.begin(), spans.end());
+    } else {
+        Span& span = node.spans[index];
+        size_t bytes = span.summary.bytes;
+        const Span& added = spans.front();
+
+        if (offset == bytes && spans.size() == 1 &&
+            span.source == added.source &&
+            span.start + bytes == added.start &&
+            bytes + added.summary.bytes <= kMaxSpan) {
+            // Typing: grow the span the previous keystroke
+            // created.
+            span.summary += added.summary;
+        } else if (offset == bytes) {
+            node.spans.insert(node.spans.begin() + index + 1,
+                              spans.begin(), spans.end());
+        } else {
+            Span right{span.source, span.start + offset,
+                       summarize(span.source,
+                                 span.start + offset,
+                                 bytes - offset)};
+
+            span.summary =
+                summarize(span.source, span.start, offset);
+
+            spans.push_back(right);
+            node.spans.insert(node.spans.begin() + index + 1,
+                              spans.begin(), spans.end());
+        }
+    }
+
+    node.recompute();
+
+    return splitOverflow(node);
+}
+
+std::vector<Rope::NodePtr> Rope::eraseFrom(Node& node,
+                                           size_t offset,
+                                           size_t length) {
+    size_t end = offset + length;
+    size_t position = 0;
+
+    if (node.leaf) {
+        std::vector<Span> kept;
+        kept.reserve(node.spans.size() + 1);
+
+        for (const auto& span : node.spans) {
+            size_t bytes = span.summary.bytes;
+            size_t spanEnd = position + bytes;
+
+            if (spanEnd <= offset || position >= end) {
+                kept.push_back(span);
+            } else {
+                if (position < offset) {
+                    size_t head = offset - position;
+                    kept.push_back(
+                        {span.source, span.start,
+                         summarize(span.source, span.start,
+                                   head)});
+                }
+
+                if (spanEnd > end) {
+                    size_t skip = end - position;
+                    kept.push_back(
+                        {span.source, span.start + skip,
+                         summarize(span.source,
+                                   span.start + skip,
+                                   bytes - skip)});
+                }
+            }
+
+            position = spanEnd;
+        }
+
+        node.spans = std::move(kept);
+        node.recompute();
+
+        return splitOverflow(node);
+    }
+
+    for (size_t i = 0; i < node.children.size(); i++) {
+        Node& child = *node.children[i];
+        size_t bytes = child.summary.bytes;
+        size_t childEnd = position + bytes;
+
+        if (childEnd > offset && position < end) {
+            size_t from = std::max(offset, position);
+            size_t to = std::min(end, childEnd);
+
+            auto siblings = eraseFrom(child, from - position,
+                                      to - from);
+
+            node.children.insert(
+                node.children.begin() + i + 1,
+                std::make_move_iterator(siblings.begin()),
+                std::make_move_iterator(siblings.end()));
+            i += siblings.size();
+        }
+
+        position = childEnd;
+    }
+
+    fixUnderflow(node);
+    node.recompute();
+
+    return splitOverflow(node);
+}
+
+void Rope::fixUnderflow(Node& node) {
+    auto& children = node.children;
+
+    children.erase(
+        std::remove_if(children.begin(), children.end(),
+                       [](const NodePtr& child) {
+                           return child->entries() == 0;
+                       }),
+        children.end());
+
+    size_t i = 0;
+
+    while (i < children.size() && children.size() > 1) {
+        if (children[i]->entries() >= kMinEntries) {
+            i++;
+            continue;
+        }
+
+        // Merge with a neighbour, splitting the result
+        // evenly again if it ended up too big.
+        size_t left = i + 1 < children.size() ? i : i - 1;
+        Node& a = *children[left];
+        Node& b = *children[left + 1];
+
+        if (a.leaf) {
+            a.spans.insert(a.spans.end(), b.spans.begin(),
+                           b.spans.end());
+            b.spans.clear();
+        } else {
+            a.children.insert(
+                a.children.end(),
+                std::make_move_iterator(b.children.begin()),
+                std::make_move_iterator(b.children.end()));
+            b.children.clear();
+        }
+
+        if (a.entries() <= kMaxEntries) {
+            a.recompute();
+            children.erase(children.begin() + left + 1);
+            i = left;
+            continue;
+        }
+
+        size_t half = a.entries() / 2;
+
+        if (a.leaf) {
+            b.spans.assign(a.spans.begin() + half,
+                           a.spans.end());
+            a.spans.resize(half);
+        } else {
+            b.children.assign(
+                std::make_move_iterator(a.children.begin() +
+                                        half),
+                std::make_move_iterator(a.children.end()));
+            a.children.resize(half);
+        }
+
+        a.recompute();
+        b.recompute();
+        i = left + 2;
+    }
+}
+
+std::vector<Rope::NodePtr> Rope::splitOverflow(Node& node) {
+    std::vector<NodePtr> siblings;
+
+    if (node.entries() <= kMaxEntries) {
+        return siblings;
+    }
+
+    // Cut the node into as few pieces as fit, of near
+    // equal size so none drops below kMinEntries. The first
+    // one stays in place.
+    size_t total = node.entries();
+    size_t pieces = (total + kMaxEntries - 1) / kMaxEntries;
+    size_t first = total / pieces + (total % pieces > 0);
+    size_t begin = first;
+
+    for (size_t piece = 1; piece < pieces; piece++) {
+        auto sibling = std::make_unique<Node>();
+        size_t end =
+            begin + total / pieces + (piece < total % pieces);
+
+        sibling->leaf = node.leaf;
+
+        if (node.leaf) {
+            sibling->spans.assign(node.spans.begin() + begin,
+                                  node.spans.begin() + end);
+        } else {
+            sibling->children.assign(
+                std::make_move_iterator(node.children.begin() +
+                                        begin),
+                std::make_move_iterator(node.children.begin() +
+                                        end));
+        }
+
+        sibling->recompute();
+        siblings.push_back(std::move(sibling));
+        begin = end;
+    }
+
+    if (node.leaf) {
+        node.spans.resize(first);
+    } else {
+        node.children.resize(first);
+    }
+
+    node.recompute();
+
+    return siblings;
+}
+
+void Rope::growRoot(std::vector<NodePtr> siblings) {
+    while (!siblings.empty()) {
+        auto root = std::make_unique<Node>();
+
+        root->leaf = false;
+        root->children.push_back(std::move(m_root));
+        root->children.insert(
+            root->children.end(),
+            std::make_move_iterator(siblings.begin()),
+            std::make_move_iterator(siblings.end()));
+        root->recompute();
+
+        m_root = std::move(root);
+        siblings = splitOverflow(*m_root);
+    }
+}
+
+void Rope::shrinkRoot() {
+    while (!m_root->leaf && m_root->children.size() == 1) {
+        m_root = std::move(m_root->children.front());
+    }
+
+    if (!m_root->leaf && m_root->children.empty()) {
+        m_root = std::make_unique<Node>();
+    }
+}
+
+size_t Rope::codepointsBefore(size_t offset) const {
+    if (offset >= size()) {
+        return m_root->summary.codepoints;
+    }
+
+    size_t codepoints = 0;
+    const Node* node = m_root.get();
+
+    while (!node->leaf) {
+        for (const auto& child : node->children) {
+            if (offset < child->summary.bytes) {
+                node = child.get();
+                break;
+            }
+
+            offset -= child->summary.bytes;
+            codepoints += child->summary.codepoints;
+        }
+    }
+
+    for (const auto& span : node->spans) {
+        if (offset < span.summary.bytes) {
+            return codepoints +
+                   utf8::countCodepoints(
+                       m_buffers.data(span.source) +
+                           span.start,
+                       offset);
+        }
+
+        offset -= span.summary.bytes;
+        codepoints += span.summary.codepoints;
+    }
+
+    return codepoints;
+}
+
+size_t Rope::offsetOfCodepoint(size_t codepoint) const {
+    if (codepoint >= m_root->summary.codepoints) {
+        return size();
+    }
+
+    // Find the span holding the codepoint-th lead byte,
+    // counting from zero.
+    size_t offset = 0;
+    const Node* node = m_root.get();
+
+    while (!node->leaf) {
+        for (const auto& child : node->children) {
+            if (codepoint < child->summary.codepoints) {
+                node = child.get();
+                break;
+            }
+
+            codepoint -= child->summary.codepoints;
+            offset += child->summary.bytes;
+        }
+    }
+
+    for (const auto& span : node->spans) {
+        if (codepoint < span.summary.codepoints) {
+            auto data = reinterpret_cast<const unsigned char*>(
+                m_buffers.data(span.source) + span.start);
+
+            for (size_t i = 0; i < span.summary.bytes; i++) {
+                if ((data[i] & 0xC0) != 0x80 &&
+                    codepoint-- == 0) {
+                    return offset + i;
+                }
+            }
+        }
+
+        codepoint -= span.summary.codepoints;
+        offset += span.summary.bytes;
+    }
+
+    return size();
+}
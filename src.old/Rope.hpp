@@ -0,0 +1,100 @@
+#pragma once
+
+#include "TextStorage.hpp"
+
+// std
+#include <cstddef>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+// B-tree rope text storage. Leaves hold spans of the same
+// immutable buffers the piece table uses, and every node
+// caches the summary (bytes, newlines, codepoints) of its
+// subtree, so offset, line and column lookups and edits
+// all descend a single root-to-leaf path.
+class Rope : public TextStorage {
+   public:
+    struct Summary {
+        size_t bytes = 0;
+        size_t newlines = 0;
+        size_t codepoints = 0;
+
+        Summary& operator+=(const Summary& other) {
+            bytes += other.bytes;
+            newlines += other.newlines;
+            codepoints += other.codepoints;
+            return *this;
+        }
+    };
+
+    struct Span {
+        TextSource source;
+        size_t start;
+        Summary summary;
+    };
+
+    Rope();
+    ~Rope() override;
+
+    Rope(const Rope&) = delete;
+    Rope& operator=(const Rope&) = delete;
+
+    void load(FileBuffer original) override;
+    void clear() override;
+
+    size_t size() const override;
+    size_t lineCount() const override;
+    size_t lineStart(size_t line) const override;
+    size_t lineOf(size_t offset) const override;
+
+    TextPosition positionOf(size_t offset) const override;
+    size_t offsetOf(TextPosition position) const override;
+
+    char at(size_t offset) const override;
+    void forEachChunk(size_t offset, size_t length,
+                      const ChunkFn& fn) const override;
+
+    void insert(size_t offset,
+                std::string_view text) override;
+    void insertSpans(
+        size_t offset,
+        const std::vector<TextSpan>& spans) override;
+    void erase(size_t offset, size_t length) override;
+
+    size_t memoryUsage() const override;
+
+    size_t height() const;
+
+   private:
+    struct Node;
+    using NodePtr = std::unique_ptr<Node>;
+
+    static constexpr size_t kMaxEntries = 16;
+    static constexpr size_t kMinEntries = kMaxEntries / 4;
+    // Upper bound on the bytes of a span, which bounds the
+    // scan needed to split one or to find a column in it.
+    static constexpr size_t kMaxSpan = 8 * 1024;
+
+    Summary summarize(TextSource source, size_t start,
+                      size_t length) const;
+    void appendSpans(TextSource source, size_t start,
+                     size_t length,
+                     std::vector<Span>& out) const;
+
+    std::vector<NodePtr> insertInto(
+        Node& node, size_t offset,
+        std::vector<Span>& spans);
+    std::vector<NodePtr> eraseFrom(Node& node,
+                                   size_t offset,
+                                   size_t length);
+    void fixUnderflow(Node& node);
+    std::vector<NodePtr> splitOverflow(Node& node);
+    void growRoot(std::vector<NodePtr> siblings);
+    void shrinkRoot();
+
+    size_t codepointsBefore(size_t offset) const;
+    size_t offsetOfCodepoint(size_t codepoint) const;
+
+    NodePtr m_root;
+};
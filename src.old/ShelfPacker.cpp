@@ -0,0 +1,57 @@
+#include "ShelfPacker.hpp"
+
+namespace ve {
+
+ShelfPacker::ShelfPacker(uint32_t width, uint32_t height)
+    : areaWidth{width}, areaHeight{height} {
+}
+
+bool ShelfPacker::pack(uint32_t width, uint32_t height,
+                       uint32_t &x, uint32_t &y) {
+    if (width > areaWidth || height > areaHeight) {
+        return false;
+    }
+
+    Shelf *best = nullptr;
+
+    for (auto &shelf : shelves) {
+        if (shelf.height < height ||
+            areaWidth - shelf.used < width) {
+            continue;
+        }
+
+        if (best == nullptr ||
+            shelf.height < best->height) {
+            best = &shelf;
+        }
+    }
+
+    // Only put small rectangles on a much taller shelf if
+    // there is no room left for a shelf of their own.
+    bool wasteful = best != nullptr &&
+                    best->height > height + height / 2;
+
+    if ((best == nullptr || wasteful) &&
+        areaHeight - top >= height) {
+        shelves.push_back({top, height, 0});
+        top += height;
+        best = &shelves.back();
+    }
+
+    if (best == nullptr) {
+        return false;
+    }
+
+    x = best->used;
+    y = best->y;
+    best->used += width;
+
+    return true;
+}
+
+void ShelfPacker::clear() {
+    shelves.clear();
+    top = 0;
+}
+
+}  // namespace ve
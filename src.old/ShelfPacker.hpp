@@ -0,0 +1,45 @@
+#pragma once
+
+// std
+#include <cstdint>
+#include <vector>
+
+namespace ve {
+
+// Packs rectangles into a fixed size area as rows
+// ("shelves") stacked from the top. A rectangle goes on the
+// shelf that wastes the least height, or opens a new shelf
+// below the last one. Glyphs of one font are all about the
+// same height, so very little space is lost.
+class ShelfPacker {
+   public:
+    ShelfPacker(uint32_t width, uint32_t height);
+
+    // Finds room for a width x height rectangle and stores
+    // its top left corner. Returns false if the area is
+    // full.
+    bool pack(uint32_t width, uint32_t height, uint32_t &x,
+              uint32_t &y);
+    void clear();
+
+    uint32_t width() const {
+        return areaWidth;
+    }
+    uint32_t height() const {
+        return areaHeight;
+    }
+
+   private:
+    struct Shelf {
+        uint32_t y;
+        uint32_t height;
+        uint32_t used;
+    };
+
+    uint32_t areaWidth;
+    uint32_t areaHeight;
+    uint32_t top = 0;
+    std::vector<Shelf> shelves;
+};
+
+}  // namespace ve
@@ -0,0 +1,152 @@
+#include "TextStorage.hpp"
+
+#include "Utf8.hpp"
+
+// std
+#include <algorithm>
+#include <cassert>
+#include <utility>
+
+void TextBuffers::load(FileBuffer original) {
+    clear();
+
+    m_original = std::move(original);
+    // Validated by the indexer, so opening a file never
+    // waits for its UTF-8 to be checked either.
+    m_originalLines.buildAsync(
+        m_original.data(), m_original.size(),
+        LineIndex::Kernel::Auto, true);
+}
+
+void TextBuffers::clear() {
+    m_originalLines.clear();
+    m_addLines.clear();
+    m_original.close();
+    m_add.clear();
+}
+
+size_t TextBuffers::append(std::string_view text) {
+    size_t start = m_add.size();
+
+    m_add.append(text.data(), text.size());
+    m_addLines.append(text.data(), start, text.size());
+
+    return start;
+}
+
+size_t TextBuffers::nthNewline(TextSource source,
+                               size_t start,
+                               size_t n) const {
+    uint64_t newline = lines(source).findNewline(start, n);
+
+    assert(newline != LineIndex::npos &&
+           "span has fewer newlines than requested");
+
+    return static_cast<size_t>(newline);
+}
+
+uint64_t TextBuffers::findNewline(TextSource source,
+                                  size_t start, size_t length,
+                                  size_t n) const {
+    return lines(source).findNewline(start, n,
+                                     start + length);
+}
+
+TextSpan TextBuffers::spanOf(const char* data,
+                             size_t length) const {
+    const char* original = m_original.data();
+
+    if (original != nullptr && data >= original &&
+        data < original + m_original.size()) {
+        return {TextSource::Original,
+                static_cast<size_t>(data - original), length};
+    }
+
+    assert(data >= m_add.data() &&
+           data < m_add.data() + m_add.size() &&
+           "bytes don't belong to the buffers");
+
+    return {TextSource::Add,
+            static_cast<size_t>(data - m_add.data()), length};
+}
+
+size_t TextStorage::lineLength(size_t line) const {
+    size_t start = lineStart(line);
+
+    if (!hasLine(line + 1)) {
+        return size() - start;
+    }
+
+    return lineStart(line + 1) - 1 - start;
+}
+
+TextPosition TextStorage::positionOf(size_t offset) const {
+    offset = std::min(offset, size());
+
+    TextPosition position;
+    position.line = lineOf(offset);
+
+    size_t start = lineStart(position.line);
+    forEachChunk(start, offset - start,
+                 [&position](const char* data, size_t size) {
+                     position.column +=
+                         utf8::countCodepoints(data, size);
+                 });
+
+    return position;
+}
+
+size_t TextStorage::offsetOf(TextPosition position) const {
+    if (!hasLine(position.line)) {
+        return size();
+    }
+
+    size_t start = lineStart(position.line);
+    size_t length = lineLength(position.line);
+    size_t offset = start;
+    size_t column = 0;
+    bool found = false;
+
+    // Walk the line until the requested codepoint starts,
+    // columns past the end of the line clamp to its end.
+    forEachChunk(
+        start, length,
+        [&](const char* data, size_t size) {
+            for (size_t i = 0; i < size && !found; i++) {
+                bool lead =
+                    (static_cast<unsigned char>(data[i]) &
+                     0xC0) != 0x80;
+
+                if (lead && column++ == position.column) {
+                    found = true;
+                } else {
+                    offset++;
+                }
+            }
+        });
+
+    return std::min(offset, start + length);
+}
+
+std::string TextStorage::line(size_t line) const {
+    std::string out;
+    copy(lineStart(line), lineLength(line), out);
+    return out;
+}
+
+void TextStorage::copy(size_t offset, size_t length,
+                       std::string& out) const {
+    out.reserve(out.size() + length);
+    forEachChunk(offset, length,
+                 [&out](const char* data, size_t size) {
+                     out.append(data, size);
+                 });
+}
+
+void TextStorage::spans(size_t offset, size_t length,
+                        std::vector<TextSpan>& out) const {
+    forEachChunk(offset, length,
+                 [this, &out](const char* data, size_t size) {
+                     out.push_back(m_buffers.spanOf(data, size));
+                 });
+}
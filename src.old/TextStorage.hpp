@@ -0,0 +1,180 @@
+#pragma once
+
+#include "FileBuffer.hpp"
+#include "LineIndex.hpp"
+
+// std
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Where the bytes referenced by a piece or span live.
+enum class TextSource : uint8_t {
+    Original,
+    Add,
+};
+
+// A run of bytes in one of the buffers.
+struct TextSpan {
+    TextSource source;
+    size_t start;
+    size_t length;
+};
+
+// The two immutable byte buffers shared by the storage
+// backends: the original file and the append-only buffer of
+// inserted text, each with its own newline index. Bytes are
+// only ever appended, so (source, start, length) triples
+// stay valid for the lifetime of the document.
+//
+// The original file is indexed in the background, queries
+// on it block until the part they touch has been indexed.
+class TextBuffers {
+   public:
+    void load(FileBuffer original);
+    void clear();
+
+    void cancelIndexing() {
+        m_originalLines.cancel();
+    }
+
+    // Appends text to the add buffer and returns where it
+    // starts.
+    size_t append(std::string_view text);
+
+    const char* data(TextSource source) const {
+        return source == TextSource::Original
+                   ? m_original.data()
+                   : m_add.data();
+    }
+    const LineIndex& lines(TextSource source) const {
+        return source == TextSource::Original
+                   ? m_originalLines
+                   : m_addLines;
+    }
+    const FileBuffer& original() const {
+        return m_original;
+    }
+    // Maps bytes handed out through data() back to the
+    // buffer they live in.
+    TextSpan spanOf(const char* data, size_t length) const;
+
+    size_t countNewlines(TextSource source, size_t start,
+                         size_t length) const {
+        return lines(source).countNewlines(start,
+                                           start + length);
+    }
+    // Position of the n-th newline at or after start.
+    size_t nthNewline(TextSource source, size_t start,
+                      size_t n) const;
+    // Same as nthNewline, but returns LineIndex::npos if
+    // there is no such newline before start + length.
+    uint64_t findNewline(TextSource source, size_t start,
+                         size_t length, size_t n) const;
+
+    size_t memoryUsage() const {
+        return m_add.capacity() +
+               m_originalLines.memoryUsage() +
+               m_addLines.memoryUsage();
+    }
+
+   private:
+    // Declared first so the indexer is stopped before the
+    // original buffer goes away.
+    FileBuffer m_original;
+    std::string m_add;
+
+    LineIndex m_originalLines;
+    LineIndex m_addLines;
+};
+
+// Line and column of a byte offset, the column counted in
+// codepoints.
+struct TextPosition {
+    size_t line = 0;
+    size_t column = 0;
+};
+
+// Interface of the document storage engines behind FileView.
+class TextStorage {
+   public:
+    using ChunkFn =
+        std::function<void(const char* data, size_t size)>;
+
+    virtual ~TextStorage() = default;
+
+    virtual void load(FileBuffer original) = 0;
+    virtual void clear() = 0;
+
+    virtual size_t size() const = 0;
+    // A document always has at least one (possibly empty)
+    // line, line k starts right after the k-th newline.
+    virtual size_t lineCount() const = 0;
+    virtual size_t lineStart(size_t line) const = 0;
+    virtual size_t lineOf(size_t offset) const = 0;
+    virtual size_t lineLength(size_t line) const;
+    // Unlike comparing against lineCount, this doesn't need
+    // the whole document to be indexed.
+    virtual bool hasLine(size_t line) const {
+        return line < lineCount();
+    }
+
+    virtual TextPosition positionOf(size_t offset) const;
+    virtual size_t offsetOf(TextPosition position) const;
+
+    virtual char at(size_t offset) const = 0;
+    virtual void forEachChunk(size_t offset, size_t length,
+                              const ChunkFn& fn) const = 0;
+
+    virtual void insert(size_t offset,
+                        std::string_view text) = 0;
+    // Inserts text that already lives in the buffers, as
+    // returned by spans, without copying it.
+    virtual void insertSpans(
+        size_t offset, const std::vector<TextSpan>& spans) = 0;
+    virtual void erase(size_t offset, size_t length) = 0;
+
+    // Heap bytes used on top of the mapped original file.
+    virtual size_t memoryUsage() const = 0;
+
+    std::string line(size_t line) const;
+    void copy(size_t offset, size_t length,
+              std::string& out) const;
+    // Appends the buffer spans making up the range to out.
+    void spans(size_t offset, size_t length,
+               std::vector<TextSpan>& out) const;
+    // Appends text to the add buffer without placing it in
+    // the document, insertSpans does that.
+    TextSpan stash(std::string_view text) {
+        return {TextSource::Add, m_buffers.append(text),
+                text.size()};
+    }
+
+    // Fraction of the original file whose newlines are
+    // indexed, lines beyond it become available as the
+    // background indexer gets to them.
+    double indexingProgress() const {
+        return m_buffers.lines(TextSource::Original)
+            .progress();
+    }
+    void cancelIndexing() {
+        m_buffers.cancelIndexing();
+    }
+    // Whether the original file is well formed UTF-8, as
+    // far as it is indexed. Only final once
+    // indexingProgress() reaches 1.
+    bool validUtf8() const {
+        return m_buffers.lines(TextSource::Original)
+            .validUtf8();
+    }
+
+    const TextBuffers& buffers() const {
+        return m_buffers;
+    }
+
+   protected:
+    TextBuffers m_buffers;
+};
@@ -0,0 +1,223 @@
+#include "UndoHistory.hpp"
+
+// std
+#include <algorithm>
+#include <cassert>
+#include <utility>
+
+UndoHistory::UndoHistory(size_t memoryLimit)
+    : m_memoryLimit(memoryLimit) {
+}
+
+void UndoHistory::insert(TextStorage& text, size_t offset,
+                         std::string_view inserted) {
+    if (inserted.empty()) {
+        return;
+    }
+
+    // Insert through the add buffer so the span is known
+    // without looking it up again.
+    std::vector<TextSpan> spans{text.stash(inserted)};
+    text.insertSpans(offset, spans);
+    dropRedo();
+
+    Edit* last = openEdit(Edit::Kind::Insert);
+
+    if (last != nullptr &&
+        offset == last->offset + last->length) {
+        Group& group = m_undo.back();
+        size_t before = cost(group);
+
+        appendSpans(last->spans, spans);
+        last->length += inserted.size();
+        resize(group, before);
+    } else {
+        std::vector<TextSpan> merged;
+        appendSpans(merged, spans);
+        push({Edit::Kind::Insert, offset, inserted.size(),
+              std::move(merged)});
+    }
+
+    // Every line typed is its own undo step.
+    if (inserted.back() == '\n') {
+        m_open = false;
+    }
+
+    evict();
+}
+
+void UndoHistory::erase(TextStorage& text, size_t offset,
+                        size_t length) {
+    if (offset >= text.size() || length == 0) {
+        return;
+    }
+
+    length = std::min(length, text.size() - offset);
+
+    std::vector<TextSpan> spans;
+    text.spans(offset, length, spans);
+
+    text.erase(offset, length);
+    dropRedo();
+
+    Edit* last = openEdit(Edit::Kind::Erase);
+
+    if (last != nullptr && (offset + length == last->offset ||
+                            offset == last->offset)) {
+        Group& group = m_undo.back();
+        size_t before = cost(group);
+
+        if (offset == last->offset) {
+            // Delete: the range continues after the last one.
+            appendSpans(last->spans, spans);
+        } else {
+            // Backspace: the range ends where the last began.
+            appendSpans(spans, last->spans);
+            last->spans = std::move(spans);
+            last->offset = offset;
+        }
+
+        last->length += length;
+        resize(group, before);
+    } else {
+        std::vector<TextSpan> merged;
+        appendSpans(merged, spans);
+        push({Edit::Kind::Erase, offset, length,
+              std::move(merged)});
+    }
+
+    evict();
+}
+
+size_t UndoHistory::undo(TextStorage& text) {
+    assert(canUndo() && "nothing to undo");
+
+    Group group = std::move(m_undo.back());
+    m_undo.pop_back();
+    m_open = false;
+
+    size_t cursor = 0;
+
+    for (auto edit = group.edits.rbegin();
+         edit != group.edits.rend(); ++edit) {
+        cursor = apply(text, *edit, true);
+    }
+
+    m_redo.push_back(std::move(group));
+    return cursor;
+}
+
+size_t UndoHistory::redo(TextStorage& text) {
+    assert(canRedo() && "nothing to redo");
+
+    Group group = std::move(m_redo.back());
+    m_redo.pop_back();
+    m_open = false;
+
+    size_t cursor = 0;
+
+    for (const auto& edit : group.edits) {
+        cursor = apply(text, edit, false);
+    }
+
+    m_undo.push_back(std::move(group));
+    return cursor;
+}
+
+void UndoHistory::clear() {
+    m_undo.clear();
+    m_redo.clear();
+    m_open = false;
+    m_memory = 0;
+}
+
+void UndoHistory::setMemoryLimit(size_t bytes) {
+    m_memoryLimit = bytes;
+    evict();
+}
+
+UndoHistory::Edit* UndoHistory::openEdit(Edit::Kind kind) {
+    if (!m_open || m_undo.empty()) {
+        return nullptr;
+    }
+
+    Edit& last = m_undo.back().edits.back();
+    return last.kind == kind ? &last : nullptr;
+}
+
+void UndoHistory::push(Edit edit) {
+    Group group;
+    group.edits.push_back(std::move(edit));
+
+    m_memory += cost(group);
+    m_undo.push_back(std::move(group));
+    m_open = true;
+}
+
+void UndoHistory::resize(Group& group, size_t before) {
+    m_memory = m_memory - before + cost(group);
+}
+
+void UndoHistory::dropRedo() {
+    for (const auto& group : m_redo) {
+        m_memory -= cost(group);
+    }
+
+    m_redo.clear();
+}
+
+void UndoHistory::evict() {
+    while (m_memory > m_memoryLimit && !m_undo.empty()) {
+        m_memory -= cost(m_undo.front());
+        m_undo.pop_front();
+    }
+
+    if (m_undo.empty()) {
+        m_open = false;
+    }
+}
+
+size_t UndoHistory::apply(TextStorage& text, const Edit& edit,
+                          bool reverse) {
+    bool inserting =
+        (edit.kind == Edit::Kind::Insert) != reverse;
+
+    if (inserting) {
+        text.insertSpans(edit.offset, edit.spans);
+        return edit.offset + edit.length;
+    }
+
+    text.erase(edit.offset, edit.length);
+    return edit.offset;
+}
+
+size_t UndoHistory::cost(const Group& group) {
+    size_t bytes =
+        sizeof(Group) + group.edits.capacity() * sizeof(Edit);
+
+    for (const auto& edit : group.edits) {
+        bytes += edit.spans.capacity() * sizeof(TextSpan);
+    }
+
+    return bytes;
+}
+
+void UndoHistory::appendSpans(
+    std::vector<TextSpan>& spans,
+    const std::vector<TextSpan>& more) {
+    for (const auto& span : more) {
+        if (!spans.empty()) {
+            TextSpan& last = spans.back();
+
+            // Storage engines may cut a run of one buffer
+            // into several pieces, glue them back together.
+            if (last.source == span.source &&
+                last.start + last.length == span.start) {
+                last.length += span.length;
+                continue;
+            }
+        }
+
+        spans.push_back(span);
+    }
+}
@@ -0,0 +1,108 @@
+#pragma once
+
+#include "TextStorage.hpp"
+
+// std
+#include <cstddef>
+#include <deque>
+#include <string_view>
+#include <vector>
+
+// Undo/redo history of a TextStorage. Edits go through the
+// history, which records them as spans of the immutable
+// buffers: inserted text already lives in the add buffer
+// and erased text stays in whichever buffer it came from,
+// so no revision ever copies document bytes.
+//
+// Consecutive edits that continue each other (typing,
+// repeated backspace or delete) are coalesced into a single
+// group until breakGroup is called. Once the history uses
+// more than its memory limit the oldest groups are dropped.
+class UndoHistory {
+   public:
+    static constexpr size_t kDefaultMemoryLimit =
+        64 * 1024 * 1024;
+
+    explicit UndoHistory(
+        size_t memoryLimit = kDefaultMemoryLimit);
+
+    void insert(TextStorage& text, size_t offset,
+                std::string_view inserted);
+    void erase(TextStorage& text, size_t offset,
+               size_t length);
+
+    // Makes the next edit start a new group, e.g. after the
+    // cursor was moved.
+    void breakGroup() {
+        m_open = false;
+    }
+
+    bool canUndo() const {
+        return !m_undo.empty();
+    }
+    bool canRedo() const {
+        return !m_redo.empty();
+    }
+
+    // Reverts the last group and returns where the cursor
+    // goes: the start of removed text or the end of
+    // restored text.
+    size_t undo(TextStorage& text);
+    // Reapplies the last undone group and returns where the
+    // cursor goes: the end of inserted text or the start of
+    // erased text.
+    size_t redo(TextStorage& text);
+
+    void clear();
+
+    size_t memoryLimit() const {
+        return m_memoryLimit;
+    }
+    void setMemoryLimit(size_t bytes);
+
+    size_t memoryUsage() const {
+        return m_memory;
+    }
+    size_t undoCount() const {
+        return m_undo.size();
+    }
+
+   private:
+    struct Edit {
+        enum class Kind {
+            Insert,
+            Erase,
+        };
+
+        Kind kind;
+        size_t offset;
+        size_t length;
+        std::vector<TextSpan> spans;
+    };
+
+    struct Group {
+        std::vector<Edit> edits;
+    };
+
+    // Returns the last edit if it is still open and of the
+    // given kind, nullptr otherwise.
+    Edit* openEdit(Edit::Kind kind);
+    void push(Edit edit);
+    void resize(Group& group, size_t before);
+    void dropRedo();
+    void evict();
+
+    static size_t apply(TextStorage& text, const Edit& edit,
+                        bool reverse);
+
+    static size_t cost(const Group& group);
+    static void appendSpans(std::vector<TextSpan>& spans,
+                            const std::vector<TextSpan>& more);
+
+    std::deque<Group> m_undo;
+    std::vector<Group> m_redo;
+    bool m_open = false;
+
+    size_t m_memoryLimit;
+    size_t m_memory = 0;
+};
@@ -0,0 +1,286 @@
+#include "Utf8.hpp"
+
+#if defined(__x86_64__) || defined(__i386__)
+#define UTF8_X86 1
+#include <immintrin.h>
+#endif
+
+// std
+#include <algorithm>
+#include <iterator>
+
+namespace utf8 {
+
+namespace {
+
+struct Range {
+    char32_t first;
+    char32_t last;
+};
+
+// Combining marks and other codepoints that never start a
+// grapheme cluster of their own.
+constexpr Range kExtenders[] = {
+    {0x0300, 0x036F},   {0x0483, 0x0489},
+    {0x0591, 0x05BD},   {0x05BF, 0x05BF},
+    {0x05C1, 0x05C2},   {0x05C4, 0x05C5},
+    {0x0610, 0x061A},   {0x064B, 0x065F},
+    {0x0670, 0x0670},   {0x06D6, 0x06DC},
+    {0x06DF, 0x06E4},   {0x0900, 0x0903},
+    {0x093A, 0x094F},   {0x0E31, 0x0E31},
+    {0x0E34, 0x0E3A},   {0x0E47, 0x0E4E},
+    {0x1AB0, 0x1AFF},   {0x1DC0, 0x1DFF},
+    {0x200C, 0x200D},   {0x20D0, 0x20FF},
+    {0xFE00, 0xFE0F},   {0xFE20, 0xFE2F},
+    {0x1F3FB, 0x1F3FF}, {0xE0020, 0xE007F},
+    {0xE0100, 0xE01EF},
+};
+
+// Wide East Asian ranges and emoji presentation blocks.
+constexpr Range kWide[] = {
+    {0x1100, 0x115F},   {0x2E80, 0x303E},
+    {0x3041, 0x33FF},   {0x3400, 0x4DBF},
+    {0x4E00, 0x9FFF},   {0xA000, 0xA4CF},
+    {0xAC00, 0xD7A3},   {0xF900, 0xFAFF},
+    {0xFE30, 0xFE4F},   {0xFF00, 0xFF60},
+    {0xFFE0, 0xFFE6},   {0x1F1E6, 0x1F1FF},
+    {0x1F300, 0x1F64F}, {0x1F680, 0x1F6FF},
+    {0x1F900, 0x1F9FF}, {0x20000, 0x2FFFD},
+    {0x30000, 0x3FFFD},
+};
+
+template <size_t N>
+bool contains(const Range (&ranges)[N], char32_t codepoint) {
+    auto found = std::upper_bound(
+        std::begin(ranges), std::end(ranges), codepoint,
+        [](char32_t value, const Range& range) {
+            return value < range.first;
+        });
+
+    return found != std::begin(ranges) &&
+           codepoint <= std::prev(found)->last;
+}
+
+size_t countCodepointsScalar(const unsigned char* data,
+                             size_t size) {
+    size_t count = 0;
+
+    for (size_t i = 0; i < size; i++) {
+        count += (data[i] & 0xC0) != 0x80;
+    }
+
+    return count;
+}
+
+}  // namespace
+
+size_t countCodepoints(const char* data, size_t size) {
+    auto bytes = reinterpret_cast<const unsigned char*>(data);
+    size_t count = 0;
+    size_t i = 0;
+
+#ifdef UTF8_X86
+    // Continuation bytes are exactly the bytes that are
+    // below -64 as signed chars.
+    const __m128i threshold = _mm_set1_epi8(-64);
+
+    for (; i + 16 <= size; i += 16) {
+        __m128i block = _mm_loadu_si128(
+            reinterpret_cast<const __m128i*>(bytes + i));
+        int continuation = _mm_movemask_epi8(
+            _mm_cmplt_epi8(block, threshold));
+
+        count += 16 - __builtin_popcount(continuation);
+    }
+#endif
+
+    return count + countCodepointsScalar(bytes + i, size - i);
+}
+
+size_t asciiPrefix(const char* data, size_t size) {
+    auto bytes = reinterpret_cast<const unsigned char*>(data);
+    size_t i = 0;
+
+#ifdef UTF8_X86
+    for (; i + 16 <= size; i += 16) {
+        int high = _mm_movemask_epi8(_mm_loadu_si128(
+            reinterpret_cast<const __m128i*>(bytes + i)));
+
+        if (high != 0) {
+            return i + __builtin_ctz(high);
+        }
+    }
+#endif
+
+    while (i < size && bytes[i] < 0x80) {
+        i++;
+    }
+
+    return i;
+}
+
+bool validate(const char* data, size_t size) {
+    size_t i = 0;
+
+    // Text is mostly ASCII, so skip it in vector sized
+    // blocks and only decode the sequences in between.
+    while (i < size) {
+        i += asciiPrefix(data + i, size - i);
+
+        if (i == size) {
+            break;
+        }
+
+        size_t length;
+
+        if (decode(data + i, size - i, length) ==
+                kReplacement &&
+            length == 1) {
+            // A literal U+FFFD is three bytes long.
+            return false;
+        }
+
+        i += length;
+    }
+
+    return true;
+}
+
+size_t sequenceBoundary(const char* data, size_t size,
+                        size_t position) {
+    auto bytes = reinterpret_cast<const unsigned char*>(data);
+    size_t continuations = 0;
+
+    while (continuations < 3 && continuations < position &&
+           (bytes[position - continuations - 1] & 0xC0) ==
+               0x80) {
+        continuations++;
+    }
+
+    if (continuations == position) {
+        return position;
+    }
+
+    size_t lead = position - continuations - 1;
+    size_t length = 1;
+
+    if ((bytes[lead] & 0xE0) == 0xC0) {
+        length = 2;
+    } else if ((bytes[lead] & 0xF0) == 0xE0) {
+        length = 3;
+    } else if ((bytes[lead] & 0xF8) == 0xF0) {
+        length = 4;
+    }
+
+    return std::min(std::max(lead + length, position),
+                    size);
+}
+
+char32_t decode(const char* data, size_t size,
+                size_t& length) {
+    auto bytes = reinterpret_cast<const unsigned char*>(data);
+    unsigned char lead = bytes[0];
+
+    length = 1;
+
+    if (lead < 0x80) {
+        return lead;
+    }
+
+    size_t expected;
+    char32_t codepoint;
+    char32_t minimum;
+
+    if ((lead & 0xE0) == 0xC0) {
+        expected = 2;
+        codepoint = lead & 0x1F;
+        minimum = 0x80;
+    } else if ((lead & 0xF0) == 0xE0) {
+        expected = 3;
+        codepoint = lead & 0x0F;
+        minimum = 0x800;
+    } else if ((lead & 0xF8) == 0xF0) {
+        expected = 4;
+        codepoint = lead & 0x07;
+        minimum = 0x10000;
+    } else {
+        return kReplacement;
+    }
+
+    if (size < expected) {
+        return kReplacement;
+    }
+
+    for (size_t i = 1; i < expected; i++) {
+        if ((bytes[i] & 0xC0) != 0x80) {
+            return kReplacement;
+        }
+
+        codepoint = (codepoint << 6) | (bytes[i] & 0x3F);
+    }
+
+    if (codepoint < minimum || codepoint > 0x10FFFF ||
+        (codepoint >= 0xD800 && codepoint <= 0xDFFF)) {
+        return kReplacement;
+    }
+
+    length = expected;
+    return codepoint;
+}
+
+size_t encode(char32_t codepoint, char* out) {
+    if ((codepoint >= 0xD800 && codepoint <= 0xDFFF) ||
+        codepoint > 0x10FFFF) {
+        codepoint = kReplacement;
+    }
+
+    if (codepoint < 0x80) {
+        out[0] = static_cast<char>(codepoint);
+        return 1;
+    }
+
+    if (codepoint < 0x800) {
+        out[0] = static_cast<char>(0xC0 | (codepoint >> 6));
+        out[1] = static_cast<char>(0x80 | (codepoint & 0x3F));
+        return 2;
+    }
+
+    if (codepoint < 0x10000) {
+        out[0] = static_cast<char>(0xE0 | (codepoint >> 12));
+        out[1] = static_cast<char>(
+            0x80 | ((codepoint >> 6) & 0x3F));
+        out[2] = static_cast<char>(0x80 | (codepoint & 0x3F));
+        return 3;
+    }
+
+    out[0] = static_cast<char>(0xF0 | (codepoint >> 18));
+    out[1] =
+        static_cast<char>(0x80 | ((codepoint >> 12) & 0x3F));
+    out[2] =
+        static_cast<char>(0x80 | ((codepoint >> 6) & 0x3F));
+    out[3] = static_cast<char>(0x80 | (codepoint & 0x3F));
+    return 4;
+}
+
+int columnWidth(char32_t codepoint) {
+    if (codepoint < 0x300) {
+        return 1;
+    }
+
+    if (extendsGrapheme(codepoint)) {
+        return 0;
+    }
+
+    return contains(kWide, codepoint) ? 2 : 1;
+}
+
+bool extendsGrapheme(char32_t codepoint) {
+    return codepoint >= 0x300 &&
+           contains(kExtenders, codepoint);
+}
+
+bool isRegionalIndicator(char32_t codepoint) {
+    return codepoint >= 0x1F1E6 && codepoint <= 0x1F1FF;
+}
+
+}  // namespace utf8
@@ -0,0 +1,55 @@
+#pragma once
+
+// std
+#include <cstddef>
+
+namespace utf8 {
+
+// Decoded in place of malformed sequences.
+constexpr char32_t kReplacement = 0xFFFD;
+
+// Number of codepoints in data, i.e. the number of bytes
+// that are not continuation bytes. Malformed sequences are
+// counted per lead byte, which keeps the count additive
+// over arbitrary splits of a buffer.
+size_t countCodepoints(const char* data, size_t size);
+
+// Length of the longest prefix of data that is plain ASCII.
+size_t asciiPrefix(const char* data, size_t size);
+
+// Whether data is well formed UTF-8: no stray continuation
+// bytes, truncated or overlong sequences, surrogates or
+// codepoints past U+10FFFF.
+bool validate(const char* data, size_t size);
+
+// Where the sequence that covers position ends, if it
+// starts before position, or else position itself. Cutting
+// a buffer at these boundaries lets it be validated in
+// parts: every part is valid exactly when the whole is.
+size_t sequenceBoundary(const char* data, size_t size,
+                        size_t position);
+
+// Decodes the codepoint starting at data and stores its
+// length in bytes. A malformed sequence decodes as
+// kReplacement with a length of one byte.
+char32_t decode(const char* data, size_t size,
+                size_t& length);
+
+// Writes the encoding of codepoint to out, which must have
+// room for four bytes, and returns its length. Surrogates
+// and codepoints past U+10FFFF encode as kReplacement.
+size_t encode(char32_t codepoint, char* out);
+
+// Columns the codepoint takes up on screen: 0 for combining
+// marks and other extenders, 2 for wide East Asian
+// characters and emoji, 1 for everything else.
+int columnWidth(char32_t codepoint);
+
+// Whether the codepoint extends the grapheme cluster before
+// it (combining marks, variation selectors, emoji
+// modifiers, zero width joiner).
+bool extendsGrapheme(char32_t codepoint);
+
+bool isRegionalIndicator(char32_t codepoint);
+
+}  // namespace utf8
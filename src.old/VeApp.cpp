@@ -1,5 +1,6 @@
 #include "VeApp.hpp"
 
+#include "Utf8.hpp"
 #include "VePipeline.hpp"
 
 // vulkan
@@ -14,12 +15,90 @@
 #include <stdint.h>
 
 // std
+#include <algorithm>
 #include <array>
+#include <cmath>
+#include <cstdlib>
 #include <memory>
 #include <stdexcept>
+#include <string_view>
 
 namespace ve {
 
+namespace {
+
+PresentProfile profileFromEnvironment() {
+    const char* name = getenv("EDITOR_PRESENT");
+
+    if (name == nullptr) {
+        return PresentProfile::VSync;
+    }
+
+    std::string_view profile{name};
+
+    if (profile == "low-latency") {
+        return PresentProfile::LowLatency;
+    }
+    if (profile == "immediate") {
+        return PresentProfile::Immediate;
+    }
+    if (profile == "relaxed") {
+        return PresentProfile::Relaxed;
+    }
+
+    return PresentProfile::VSync;
+}
+
+GlyphMode glyphModeFromEnvironment() {
+    const char* name = getenv("EDITOR_GLYPHS");
+
+    if (name != nullptr &&
+        std::string_view{name} == "sdf") {
+        return GlyphMode::Distance;
+    }
+
+    return GlyphMode::Coverage;
+}
+
+const char* presentModeName(VkPresentModeKHR mode) {
+    switch (mode) {
+        case VK_PRESENT_MODE_IMMEDIATE_KHR:
+            return "Immediate";
+        case VK_PRESENT_MODE_MAILBOX_KHR:
+            return "Mailbox";
+        case VK_PRESENT_MODE_FIFO_KHR:
+            return "Fifo";
+        case VK_PRESENT_MODE_FIFO_RELAXED_KHR:
+            return "Fifo Relaxed";
+        default:
+            return "Unknown";
+    }
+}
+
+// Viewport and scissor aren't inherited by secondary
+// command buffers, every region sets its own.
+void setViewport(VkCommandBuffer commandBuffer,
+                 VkExtent2D extent) {
+    VkViewport viewport{};
+    viewport.x = 0.0f;
+    viewport.y = 0.0f;
+    viewport.width = static_cast<float>(extent.width);
+    viewport.height = static_cast<float>(extent.height);
+    viewport.minDepth = 0.0f;
+    viewport.maxDepth = 1.0f;
+    vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+
+    VkRect2D scissor{{0, 0}, extent};
+    vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+}
+
+uint64_t hashCombine(uint64_t seed, uint64_t value) {
+    return seed ^ (value + 0x9e3779b97f4a7c15 +
+                   (seed << 6) + (seed >> 2));
+}
+
+}  // namespace
+
 struct SimplePushConstantData {
     glm::mat2 transform{1.0f};
     glm::vec2 offset;
@@ -98,16 +177,35 @@ std::vector<VeModel::Vertex> serpinskiTriangle(
         n, std::vector<Triangle>{triangle});
 }
 
-VeApp::VeApp() {
+VeApp::VeApp(const std::string& fileName) {
+    if (!fileName.empty() &&
+        fileView.openFile(fileName) == -1) {
+        throw std::runtime_error("failed to open file: " +
+                                 fileName);
+    }
+
     std::cout
         << "Maximum Push constant size: "
         << veDevice.properties.limits.maxPushConstantsSize
         << std::endl;
 
+    presentProfile = profileFromEnvironment();
+    glyphMode = glyphModeFromEnvironment();
+
     loadModels();
+    loadFont();
     createPipelineLayout();
     recreateSwapChain();
-    createCommandBuffers();
+
+    VeMemoryAllocator::Stats memoryStats =
+        veDevice.memoryAllocator().stats();
+    std::cout << "Device memory: " << memoryStats.usedBytes
+              << " bytes used of "
+              << memoryStats.reservedBytes
+              << " reserved in "
+              << memoryStats.blockCount << " blocks and "
+              << memoryStats.dedicatedCount
+              << " dedicated allocations" << std::endl;
 }
 
 VeApp::~VeApp() {
@@ -116,14 +214,316 @@ VeApp::~VeApp() {
 }
 
 void VeApp::run() {
+    redrawScheduler.restartBlink(glfwGetTime());
+
     while (!veWindow.shouldClose()) {
-        veWindow.pollEvents();
-        drawFrame();
+        // Sleeps until there is input or the next blink of
+        // the cursor, and only polls while animating.
+        veWindow.waitEvents(
+            redrawScheduler.timeout(glfwGetTime()));
+
+        double now = glfwGetTime();
+        processInput(now);
+
+        if (veWindow.wasWindowResized()) {
+            redrawScheduler.invalidate(
+                RedrawScheduler::kResize);
+        }
+
+        if (veWindow.wasWindowDamaged()) {
+            veWindow.resetWindowDamagedFlag();
+            redrawScheduler.invalidate(
+                RedrawScheduler::kExpose);
+        }
+
+        if (redrawScheduler.needsFrame(now) &&
+            drawFrame(now)) {
+            redrawScheduler.frameDrawn(now);
+
+            if (redrawScheduler.frameCount() == 1) {
+                logStartupTime();
+            }
+
+            if (redrawScheduler.frameCount() %
+                    GPU_REPORT_INTERVAL ==
+                0) {
+                logFrameStats();
+            }
+
+            uint64_t presses = keyLatency.count();
+            keyLatency.end(glfwGetTime());
+
+            if (keyLatency.count() != presses &&
+                keyLatency.count() %
+                        LATENCY_REPORT_INTERVAL ==
+                    0) {
+                logLatency();
+            }
+        }
     }
 
+    logLatency();
+    logFrameStats();
+
     vkDeviceWaitIdle(veDevice.device());
 }
 
+void VeApp::logStartupTime() {
+    auto elapsed =
+        std::chrono::duration_cast<
+            std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - startTime)
+            .count();
+    size_t cacheSize =
+        veDevice.pipelineCache().loadedSize();
+
+    // Run once with the cache file deleted and once with it
+    // in place to compare cold and warm starts.
+    std::cout << "First frame after " << elapsed / 1000.0
+              << " ms, pipeline cache "
+              << (cacheSize > 0 ? "warm (" : "cold (")
+              << cacheSize << " bytes loaded)" << std::endl;
+}
+
+void VeApp::logLatency() {
+    if (keyLatency.count() == 0) {
+        return;
+    }
+
+    std::cout << "Key to present, "
+              << presentProfileName(presentProfile)
+              << ": min " << keyLatency.min() * 1000.0
+              << " ms, avg " << keyLatency.mean() * 1000.0
+              << " ms, p99 "
+              << keyLatency.percentile(0.99) * 1000.0
+              << " ms over " << keyLatency.count()
+              << " presses" << std::endl;
+}
+
+void VeApp::logFrameStats() {
+    // With distance fields zooming adds nothing here.
+    std::cout << "Glyphs uploaded "
+              << veGlyphAtlas->uploadCount() << std::endl;
+
+    std::cout << "Regions recorded "
+              << regionRecorder.recordedCount()
+              << ", reused " << regionRecorder.reusedCount()
+              << std::endl;
+
+    // Stays put after startup, frames only reset pools.
+    VeFrameContext::Stats frameStats = frameContext.stats();
+    std::cout << "Frame command pools: "
+              << frameStats.poolsCreated << " created, "
+              << frameStats.buffersAllocated
+              << " buffers allocated, "
+              << frameStats.poolResets << " resets"
+              << std::endl;
+
+    std::cout << "GPU frames measured "
+              << gpuProfiler.framesMeasured() << std::endl;
+
+    for (const auto& zone : gpuProfiler.stats()) {
+        std::cout << "GPU " << zone.name << ": min "
+                  << zone.min << " ms, avg " << zone.avg
+                  << " ms, p99 " << zone.p99 << " ms over "
+                  << zone.count << " frames" << std::endl;
+    }
+}
+
+void VeApp::processInput(double now) {
+    for (const auto& event : veWindow.takeInputEvents()) {
+        switch (event.type) {
+            case InputEvent::Type::Key:
+                handleKey(event, now);
+                break;
+
+            case InputEvent::Type::Char: {
+                char encoded[4];
+                size_t length =
+                    utf8::encode(event.codepoint, encoded);
+
+                fileView.insertText({encoded, length});
+                redrawScheduler.invalidate(
+                    RedrawScheduler::kText);
+                redrawScheduler.restartBlink(now);
+                followCursor(now);
+                break;
+            }
+
+            case InputEvent::Type::Scroll:
+                if ((event.mods & GLFW_MOD_CONTROL) &&
+                    glyphMode == GlyphMode::Distance) {
+                    zoom(event.scroll, now);
+                    break;
+                }
+
+                scrollTo(scrollTarget -
+                             event.scroll * SCROLL_LINES,
+                         now);
+                break;
+
+            case InputEvent::Type::Focus:
+                redrawScheduler.setBlinking(event.focused,
+                                            now);
+                break;
+        }
+
+        bool typed = event.type == InputEvent::Type::Key ||
+                     event.type == InputEvent::Type::Char;
+
+        if (typed && redrawScheduler.dirty() != 0) {
+            keyLatency.begin(event.time);
+        }
+    }
+}
+
+void VeApp::handleKey(const InputEvent& event,
+                      double now) {
+    bool control = event.mods & GLFW_MOD_CONTROL;
+    uint32_t reasons = RedrawScheduler::kCursor;
+
+    switch (event.key) {
+        case GLFW_KEY_F2:
+            // Every profile is measured on its own.
+            logLatency();
+            keyLatency.clear();
+            presentProfile = static_cast<PresentProfile>(
+                (static_cast<int>(presentProfile) + 1) % 4);
+            std::cout << "Present profile: "
+                      << presentProfileName(presentProfile)
+                      << std::endl;
+            recreateSwapChain();
+            redrawScheduler.invalidate(
+                RedrawScheduler::kExpose);
+            return;
+        case GLFW_KEY_LEFT:
+            fileView.cursorLeft();
+            break;
+        case GLFW_KEY_RIGHT:
+            fileView.cursorRight();
+            break;
+        case GLFW_KEY_UP:
+            fileView.cursorUp();
+            break;
+        case GLFW_KEY_DOWN:
+            fileView.cursorDown();
+            break;
+        case GLFW_KEY_PAGE_UP:
+        case GLFW_KEY_PAGE_DOWN: {
+            double page = static_cast<double>(
+                std::max<size_t>(visibleLines(), 2) - 1);
+            double direction =
+                event.key == GLFW_KEY_PAGE_UP ? -1.0 : 1.0;
+            scrollTo(scrollTarget + direction * page, now);
+            return;
+        }
+        case GLFW_KEY_ENTER:
+            fileView.insertText("\n");
+            reasons = RedrawScheduler::kText;
+            break;
+        case GLFW_KEY_BACKSPACE:
+            fileView.deleteBackward();
+            reasons = RedrawScheduler::kText;
+            break;
+        case GLFW_KEY_DELETE:
+            fileView.deleteForward();
+            reasons = RedrawScheduler::kText;
+            break;
+        case GLFW_KEY_S:
+            if (control) {
+                fileView.saveFile();
+            }
+            return;
+        case GLFW_KEY_Z:
+            if (!control || !fileView.undo()) {
+                return;
+            }
+            reasons = RedrawScheduler::kText;
+            break;
+        case GLFW_KEY_Y:
+            if (!control || !fileView.redo()) {
+                return;
+            }
+            reasons = RedrawScheduler::kText;
+            break;
+        default:
+            return;
+    }
+
+    redrawScheduler.invalidate(reasons);
+    redrawScheduler.restartBlink(now);
+    followCursor(now);
+}
+
+void VeApp::scrollTo(double line, double now) {
+    double last = static_cast<double>(
+        std::max<size_t>(fileView.lineCount(), 1) - 1);
+
+    line = std::min(std::max(line, 0.0), last);
+
+    if (line == scrollTarget) {
+        return;
+    }
+
+    scrollFrom = scrollPosition(now);
+    scrollTarget = line;
+    scrollStart = now;
+    redrawScheduler.invalidate(RedrawScheduler::kScroll);
+    redrawScheduler.animateUntil(now + SCROLL_DURATION);
+}
+
+double VeApp::scrollPosition(double now) const {
+    double t = (now - scrollStart) / SCROLL_DURATION;
+
+    if (t >= 1.0) {
+        return scrollTarget;
+    }
+
+    // Ease out, fast at first and settling gently.
+    double eased = 1.0 - (1.0 - t) * (1.0 - t);
+    return scrollFrom + (scrollTarget - scrollFrom) * eased;
+}
+
+void VeApp::followCursor(double now) {
+    double cursor = static_cast<double>(fileView.cursorY());
+    double lines = static_cast<double>(visibleLines());
+
+    if (cursor < scrollTarget) {
+        scrollTo(cursor, now);
+    } else if (cursor >= scrollTarget + lines) {
+        scrollTo(cursor - lines + 1.0, now);
+    }
+}
+
+size_t VeApp::visibleLines() const {
+    return std::max<size_t>(
+        static_cast<size_t>(veSwapChain->height() /
+                            lineHeight()),
+        1);
+}
+
+void VeApp::zoom(double steps, double now) {
+    double size = fontSize * std::pow(ZOOM_STEP, steps);
+    size = std::min(std::max(size, MIN_FONT_SIZE),
+                    MAX_FONT_SIZE);
+
+    if (size == fontSize) {
+        return;
+    }
+
+    // Only the scale changes, the atlas keeps every glyph.
+    fontSize = size;
+    veTextRenderer->setScale(static_cast<float>(
+        fontSize / veFont->pixelHeight()));
+    redrawScheduler.invalidate(RedrawScheduler::kZoom);
+    followCursor(now);
+}
+
+float VeApp::lineHeight() const {
+    return static_cast<float>(veFont->lineHeight()) *
+           veTextRenderer->scale();
+}
+
 void VeApp::loadModels() {
     // Triangle triangle{
     //     {{0.0f, -0.5f}},
@@ -140,7 +540,40 @@ void VeApp::loadModels() {
         {{-0.5f, 0.5f}, {0.0f, 0.0f, 1.0f}},
     };
 
-    veModel = std::make_unique<VeModel>(veDevice, vertices);
+    veModel = std::make_unique<VeModel>(
+        veDevice, veUploadManager, vertices);
+}
+
+void VeApp::loadFont() {
+    veFont = std::make_unique<VeFont>(
+        VeFont::defaultPath(),
+        glyphMode == GlyphMode::Distance ? SDF_FONT_SIZE
+                                         : FONT_SIZE,
+        glyphMode);
+    veGlyphAtlas = std::make_unique<VeGlyphAtlas>(
+        veDevice, veUploadManager, *veFont);
+
+    // Most of what an editor shows is printable ASCII, get
+    // it uploaded before the first frame.
+    for (char32_t c = ' '; c <= '~'; c++) {
+        veGlyphAtlas->glyph(c);
+    }
+
+    veUploadManager.submit();
+
+    veTextRenderer = std::make_unique<VeTextRenderer>(
+        veDevice, *veGlyphAtlas);
+    frameData = std::make_unique<VeRingBuffer>(
+        veDevice, FRAME_DATA_SIZE,
+        VK_BUFFER_USAGE_VERTEX_BUFFER_BIT);
+
+    std::array<glm::vec4, VeTextRenderer::PALETTE_SIZE>
+        palette;
+    palette.fill({0.85f, 0.85f, 0.85f, 1.0f});
+    palette[CURSOR_COLOR] = {1.0f, 0.75f, 0.3f, 1.0f};
+    veTextRenderer->setPalette(palette);
+    veTextRenderer->setScale(static_cast<float>(
+        fontSize / veFont->pixelHeight()));
 }
 
 void VeApp::createPipelineLayout() {
@@ -187,32 +620,11 @@ void VeApp::createPipeline() {
     vePipeline = std::make_unique<VePipeline>(
         veDevice, "res/shaders/simple.vert.spv",
         "res/shaders/simple.frag.spv", pipelineConfig);
-}
 
-void VeApp::createCommandBuffers() {
-    commandBuffers.resize(veSwapChain->imageCount());
-    VkCommandBufferAllocateInfo allocInfo{};
-    allocInfo.sType =
-        VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-    allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-    allocInfo.commandPool = veDevice.getCommandPool();
-    allocInfo.commandBufferCount =
-        static_cast<uint32_t>(commandBuffers.size());
-
-    if (vkAllocateCommandBuffers(
-            veDevice.device(), &allocInfo,
-            commandBuffers.data()) != VK_SUCCESS) {
-        throw std::runtime_error(
-            "failed to allocate command buffers");
-    }
-}
-
-void VeApp::freeCommandBuffers() {
-    vkFreeCommandBuffers(
-        veDevice.device(), veDevice.getCommandPool(),
-        static_cast<uint32_t>(commandBuffers.size()),
-        commandBuffers.data());
-    commandBuffers.clear();
+    veTextRenderer->createPipeline(
+        veSwapChain->getRenderPass());
+    // The regions bind the old pipelines.
+    regionRecorder.invalidate();
 }
 
 void VeApp::recreateSwapChain() {
@@ -225,38 +637,192 @@ void VeApp::recreateSwapChain() {
 
     vkDeviceWaitIdle(veDevice.device());
     if (veSwapChain == nullptr) {
-        veSwapChain =
-            std::make_unique<VeSwapChain>(veDevice, extent);
+        veSwapChain = std::make_unique<VeSwapChain>(
+            veDevice, extent, presentProfile);
+        std::cout << "Present mode: "
+                  << presentModeName(
+                         veSwapChain->getPresentMode())
+                  << std::endl;
     } else {
+        std::shared_ptr<VeSwapChain> oldSwapChain =
+            std::move(veSwapChain);
         veSwapChain = std::make_unique<VeSwapChain>(
-            veDevice, extent, std::move(veSwapChain));
-        if (veSwapChain->imageCount() !=
-            commandBuffers.size()) {
-            freeCommandBuffers();
-            createCommandBuffers();
+            veDevice, extent, oldSwapChain, presentProfile);
+
+        if (veSwapChain->getPresentMode() !=
+            oldSwapChain->getPresentMode()) {
+            std::cout << "Present mode: "
+                      << presentModeName(
+                             veSwapChain->getPresentMode())
+                      << std::endl;
         }
-    }
 
-    // TODO: if render passes are compatible no need to
-    // recreate pipeline.
+        // A pipeline can be used with any render pass
+        // compatible with the one it was created for. The
+        // swap chain's render passes only differ in their
+        // attachment formats, samples are always 1, and
+        // viewport and scissor are dynamic, so a resize
+        // keeps the pipelines.
+        if (vePipeline != nullptr &&
+            oldSwapChain->compareSwapFormats(*veSwapChain)) {
+            return;
+        }
+    }
 
     createPipeline();
 }
 
-void VeApp::recordCommandBuffer(uint32_t imageIndex) {
-    static int frame = 0;
-    frame = (frame + 1) % 100;
+void VeApp::layoutText(double now) {
+    float width = static_cast<float>(
+        veSwapChain->getSwapChainExtent().width);
+    float height = static_cast<float>(
+        veSwapChain->getSwapChainExtent().height);
+    float lineHeight = this->lineHeight();
+    float ascender =
+        static_cast<float>(veFont->ascender()) *
+        veTextRenderer->scale();
+
+    // Glyphs looked up before the atlas ran full and was
+    // emptied are gone, lay out again from scratch.
+    for (int attempt = 0; attempt < 2; attempt++) {
+        uint32_t generation = veGlyphAtlas->generation();
+        veTextRenderer->clear();
+
+        double scroll = scrollPosition(now);
+        size_t first = static_cast<size_t>(scroll);
+        float y = ascender -
+                  static_cast<float>(scroll - first) *
+                      lineHeight;
+
+        for (size_t line = first;
+             line < fileView.lineCount() &&
+             y - ascender < height;
+             line++) {
+            std::string text = fileView.line(line);
+
+            if (line != fileView.cursorY()) {
+                veTextRenderer->addText(0.0f, y, text,
+                                        TEXT_COLOR, width);
+                y += lineHeight;
+                continue;
+            }
+
+            std::string_view view{text};
+            size_t split =
+                std::min<size_t>(fileView.cursorX(),
+                                 view.size());
+            float x = veTextRenderer->addText(
+                0.0f, y, view.substr(0, split), TEXT_COLOR,
+                width);
+
+            if (redrawScheduler.cursorVisible(now)) {
+                veTextRenderer->addText(x, y, CURSOR_GLYPH,
+                                        CURSOR_COLOR,
+                                        width);
+            }
+
+            veTextRenderer->addText(x, y, view.substr(split),
+                                    TEXT_COLOR, width);
+            y += lineHeight;
+        }
+
+        if (veGlyphAtlas->generation() == generation) {
+            break;
+        }
+    }
+}
+
+void VeApp::recordRegions() {
+    VkExtent2D extent = veSwapChain->getSwapChainExtent();
+    uint64_t extentKey =
+        uint64_t{extent.width} << 32 | extent.height;
+    uint32_t frameIndex = static_cast<uint32_t>(
+        veSwapChain->getCurrentFrame());
+
+    regionRecorder.beginFrame(frameIndex,
+                              veSwapChain->getRenderPass());
+
+    // The zones are written into the region's buffer, so
+    // a reused buffer is still timed. Each frame slot has
+    // its own buffers and queries.
+
+    // Only changes with the window size.
+    regionRecorder.record(
+        SCENE_REGION, extentKey,
+        [this, extent,
+         frameIndex](VkCommandBuffer commandBuffer) {
+            VeGpuProfiler::Scope zone{
+                gpuProfiler, commandBuffer, frameIndex,
+                regionZones[SCENE_REGION]};
+            setViewport(commandBuffer, extent);
+            vePipeline->bind(commandBuffer);
+            veModel->bind(commandBuffer);
+
+            SimplePushConstantData pushConstantData{};
+            pushConstantData.offset = {0.0f, 0.0f};
+            pushConstantData.color = {0.0f, 0.0f, 0.0f};
+
+            vkCmdPushConstants(
+                commandBuffer, pipelineLayout,
+                VK_SHADER_STAGE_VERTEX_BIT |
+                    VK_SHADER_STAGE_FRAGMENT_BIT,
+                0, sizeof(SimplePushConstantData),
+                &pushConstantData);
+
+            veModel->draw(commandBuffer);
+        });
+
+    // A reused buffer draws the instances it wrote into
+    // this frame's region of frameData the last time. They
+    // are still there as long as the ring hasn't grown,
+    // nothing else writes to it.
+    uint64_t textKey = hashCombine(
+        hashCombine(veTextRenderer->contentHash(),
+                    extentKey),
+        frameData->generation());
+
+    regionRecorder.record(
+        TEXT_REGION, textKey,
+        [this, extent,
+         frameIndex](VkCommandBuffer commandBuffer) {
+            VeGpuProfiler::Scope zone{
+                gpuProfiler, commandBuffer, frameIndex,
+                regionZones[TEXT_REGION]};
+            setViewport(commandBuffer, extent);
+            // All visible text in a single instanced draw.
+            veTextRenderer->render(commandBuffer,
+                                   *frameData, extent);
+        });
+}
+
+VkCommandBuffer VeApp::recordCommandBuffer(
+    uint32_t imageIndex) {
+    // The workers record the regions while this thread
+    // records the primary buffer around them.
+    recordRegions();
+
+    VkCommandBuffer commandBuffer = frameContext.beginFrame(
+        static_cast<uint32_t>(
+            veSwapChain->getCurrentFrame()));
 
     VkCommandBufferBeginInfo beginInfo{};
     beginInfo.sType =
         VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
 
-    if (vkBeginCommandBuffer(commandBuffers[imageIndex],
+    if (vkBeginCommandBuffer(commandBuffer,
                              &beginInfo) != VK_SUCCESS) {
         throw std::runtime_error(
             "failed to start recording command buffer");
     }
 
+    // Before the render pass, resets can't go inside one.
+    gpuProfiler.beginFrame(
+        commandBuffer,
+        static_cast<uint32_t>(
+            veSwapChain->getCurrentFrame()));
+    uint32_t passZone = gpuProfiler.beginZone(
+        commandBuffer, "main pass");
+
     VkRenderPassBeginInfo renderPassInfo{};
     renderPassInfo.sType =
         VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
@@ -275,63 +841,40 @@ void VeApp::recordCommandBuffer(uint32_t imageIndex) {
         static_cast<uint32_t>(clearValues.size());
     renderPassInfo.pClearValues = clearValues.data();
 
-    vkCmdBeginRenderPass(commandBuffers[imageIndex],
-                         &renderPassInfo,
-                         VK_SUBPASS_CONTENTS_INLINE);
+    vkCmdBeginRenderPass(
+        commandBuffer, &renderPassInfo,
+        VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
 
-    VkViewport viewport{};
-    viewport.x = 0.0f;
-    viewport.y = 0.0f;
-    viewport.width = static_cast<float>(
-        veSwapChain->getSwapChainExtent().width);
-    viewport.height = static_cast<float>(
-        veSwapChain->getSwapChainExtent().height);
-    viewport.minDepth = 0.0f;
-    viewport.maxDepth = 1.0f;
-    vkCmdSetViewport(commandBuffers[imageIndex], 0, 1,
-                     &viewport);
-
-    VkRect2D scissor{{0, 0},
-                     veSwapChain->getSwapChainExtent()};
-    vkCmdSetScissor(commandBuffers[imageIndex], 0, 1,
-                    &scissor);
-
-    vePipeline->bind(commandBuffers[imageIndex]);
-    veModel->bind(commandBuffers[imageIndex]);
-
-    for (int i = 0; i < 4; i++) {
-        SimplePushConstantData pushConstantData{};
-        pushConstantData.offset = {-0.4f + frame * 0.02,
-                                   -0.4f + i * 0.25f};
-        pushConstantData.color = {0.0f, 0.0f, 0.1f * i};
-
-        vkCmdPushConstants(
-            commandBuffers[imageIndex], pipelineLayout,
-            VK_SHADER_STAGE_VERTEX_BIT |
-                VK_SHADER_STAGE_FRAGMENT_BIT,
-            0, sizeof(SimplePushConstantData),
-            &pushConstantData);
-
-        veModel->draw(commandBuffers[imageIndex]);
+    const auto& regions = regionRecorder.endFrame();
+
+    if (!regions.empty()) {
+        vkCmdExecuteCommands(
+            commandBuffer,
+            static_cast<uint32_t>(regions.size()),
+            regions.data());
     }
 
-    vkCmdEndRenderPass(commandBuffers[imageIndex]);
+    vkCmdEndRenderPass(commandBuffer);
+    gpuProfiler.endZone(commandBuffer,
+                        passZone);
 
-    if (vkEndCommandBuffer(commandBuffers[imageIndex]) !=
+    if (vkEndCommandBuffer(commandBuffer) !=
         VK_SUCCESS) {
         throw std::runtime_error(
             "failed to record command buffer");
     }
+
+    return commandBuffer;
 }
 
-void VeApp::drawFrame() {
+bool VeApp::drawFrame(double now) {
     uint32_t imageIndex;
     auto result =
         veSwapChain->acquireNextImage(&imageIndex);
 
     if (result == VK_ERROR_OUT_OF_DATE_KHR) {
         recreateSwapChain();
-        return;
+        return false;
     }
 
     if (result != VK_SUCCESS &&
@@ -340,22 +883,35 @@ void VeApp::drawFrame() {
             "failed to acquire swap chain image");
     }
 
-    recordCommandBuffer(imageIndex);
+    // The swap chain waited for the fence of this frame
+    // slot, so its region of the ring is free again.
+    frameData->beginFrame(static_cast<uint32_t>(
+        veSwapChain->getCurrentFrame()));
+    layoutText(now);
+    // Only uploads anything if glyphs were seen for the
+    // first time since the last frame. The frame waits on
+    // the GPU for the batch, see frameSync below.
+    veUploadManager.submit();
+    VkCommandBuffer commandBuffer =
+        recordCommandBuffer(imageIndex);
 
     if (result == VK_ERROR_OUT_OF_DATE_KHR ||
         result == VK_SUBOPTIMAL_KHR ||
         veWindow.wasWindowResized()) {
         veWindow.resetWindowResizedFlag();
         recreateSwapChain();
-        return;
+        return false;
     }
 
     if (veSwapChain->submitCommandBuffers(
-            &commandBuffers[imageIndex], &imageIndex) !=
-        VK_SUCCESS) {
+            &commandBuffer, &imageIndex,
+            veUploadManager.frameSync()) != VK_SUCCESS) {
         throw std::runtime_error(
             "failed to submit command buffer");
     }
+
+    gpuProfiler.endFrame();
+    return true;
 }
 
 }  // namespace ve
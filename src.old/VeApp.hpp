@@ -2,13 +2,27 @@
 
 #include <vulkan/vulkan_core.h>
 
+#include "FileView.hpp"
+#include "LatencyProbe.hpp"
+#include "RedrawScheduler.hpp"
+#include "VeFont.hpp"
+#include "VeFrameContext.hpp"
+#include "VeGpuProfiler.hpp"
+#include "VeGlyphAtlas.hpp"
 #include "VeModel.hpp"
 #include "VePipeline.hpp"
+#include "VeRegionRecorder.hpp"
+#include "VeRingBuffer.hpp"
 #include "VeSwapChain.hpp"
+#include "VeTextRenderer.hpp"
+#include "VeUploadManager.hpp"
 #include "VeWindow.hpp"
 
 // std
+#include <array>
+#include <chrono>
 #include <memory>
+#include <string>
 #include <vector>
 
 namespace ve {
@@ -17,8 +31,50 @@ class VeApp {
    public:
     static constexpr unsigned int WIDTH = 800;
     static constexpr unsigned int HEIGHT = 600;
+    static constexpr uint32_t FONT_SIZE = 18;
+    // Size distance field glyphs are rasterized at, they
+    // are scaled to the zoomed size when drawn.
+    static constexpr uint32_t SDF_FONT_SIZE = 32;
+    // Font size factor per notch of ctrl+scroll, and its
+    // limits in pixels.
+    static constexpr double ZOOM_STEP = 1.1;
+    static constexpr double MIN_FONT_SIZE = 6.0;
+    static constexpr double MAX_FONT_SIZE = 144.0;
+    // Lines per notch of the mouse wheel.
+    static constexpr double SCROLL_LINES = 3.0;
+    // Seconds a scroll takes to settle.
+    static constexpr double SCROLL_DURATION = 0.12;
+    // Per frame in flight, holds 64k glyph instances
+    // before it has to grow.
+    static constexpr VkDeviceSize FRAME_DATA_SIZE = 1 << 20;
 
-    VeApp();
+    // Palette entries of the text renderer.
+    static constexpr uint32_t TEXT_COLOR = 0;
+    static constexpr uint32_t CURSOR_COLOR = 1;
+    // U+258F LEFT ONE EIGHTH BLOCK.
+    static constexpr const char* CURSOR_GLYPH =
+        "\xE2\x96\x8F";
+
+    // Key press to present latency is logged every this
+    // many presses.
+    static constexpr uint64_t LATENCY_REPORT_INTERVAL = 100;
+    // GPU zone times and command buffer counts are
+    // logged every this many frames.
+    static constexpr uint64_t GPU_REPORT_INTERVAL = 600;
+
+    // Regions of the window, each recorded into its own
+    // secondary command buffer.
+    static constexpr uint32_t SCENE_REGION = 0;
+    static constexpr uint32_t TEXT_REGION = 1;
+    static constexpr uint32_t REGION_COUNT = 2;
+
+    // Shows fileName, or an empty buffer if it is empty.
+    // $EDITOR_PRESENT picks the presentation profile:
+    // vsync (the default), low-latency, immediate or
+    // relaxed. F2 cycles through them.
+    // $EDITOR_GLYPHS=sdf draws text from distance fields,
+    // which ctrl+scroll zooms without rasterizing again.
+    explicit VeApp(const std::string& fileName = {});
     ~VeApp();
 
     VeApp(const VeApp&) = delete;
@@ -28,21 +84,75 @@ class VeApp {
 
    private:
     void loadModels();
+    void loadFont();
     void createPipelineLayout();
     void createPipeline();
-    void createCommandBuffers();
-    void freeCommandBuffers();
-    void drawFrame();
+    // Returns false if no image was presented, e.g.
+    // because the swap chain had to be recreated.
+    bool drawFrame(double now);
     void recreateSwapChain();
-    void recordCommandBuffer(uint32_t imageIndex);
+    // Records the frame into the current frame's primary
+    // buffer and returns it.
+    VkCommandBuffer recordCommandBuffer(
+        uint32_t imageIndex);
+    void recordRegions();
+    void layoutText(double now);
 
+    void logStartupTime();
+    void logLatency();
+    void logFrameStats();
+    void processInput(double now);
+    void handleKey(const InputEvent& event, double now);
+    void scrollTo(double line, double now);
+    double scrollPosition(double now) const;
+    // Scrolls just far enough to show the cursor.
+    void followCursor(double now);
+    size_t visibleLines() const;
+    void zoom(double steps, double now);
+    // Of the zoomed font, in pixels.
+    float lineHeight() const;
+
+    // Startup is timed from here to the first presented
+    // frame.
+    std::chrono::steady_clock::time_point startTime{
+        std::chrono::steady_clock::now()};
     VeWindow veWindow{WIDTH, HEIGHT, "Hallo Vulcano!"};
     VeDevice veDevice{veWindow};
+    // Declared before everything it uploads to, so it is
+    // destroyed after them.
+    VeUploadManager veUploadManager{veDevice};
+    VeGpuProfiler gpuProfiler{veDevice};
+    // Reserved, timed inside each region's buffer.
+    std::array<uint32_t, REGION_COUNT> regionZones{
+        gpuProfiler.reserveZone("scene region"),
+        gpuProfiler.reserveZone("text region")};
+    VeRegionRecorder regionRecorder{veDevice, REGION_COUNT};
+    VeFrameContext frameContext{veDevice};
+    PresentProfile presentProfile = PresentProfile::VSync;
+    GlyphMode glyphMode = GlyphMode::Coverage;
+    // In pixels, only changes with distance fields.
+    double fontSize = FONT_SIZE;
     std::unique_ptr<VeSwapChain> veSwapChain;
     std::unique_ptr<VePipeline> vePipeline;
     VkPipelineLayout pipelineLayout;
-    std::vector<VkCommandBuffer> commandBuffers;
     std::unique_ptr<VeModel> veModel;
+    std::unique_ptr<VeFont> veFont;
+    std::unique_ptr<VeGlyphAtlas> veGlyphAtlas;
+    std::unique_ptr<VeTextRenderer> veTextRenderer;
+    // Instance and vertex data written every frame.
+    std::unique_ptr<VeRingBuffer> frameData;
+    FileView fileView;
+
+    RedrawScheduler redrawScheduler;
+    // Scrolling eases from scrollFrom to scrollTarget,
+    // both in lines.
+    double scrollFrom = 0.0;
+    double scrollTarget = 0.0;
+    double scrollStart = 0.0;
+
+    // From the first key press or typed character a frame
+    // shows to the frame being handed to present.
+    LatencyProbe keyLatency;
 };
 
 }  // namespace ve
@@ -52,16 +52,31 @@ void DestroyDebugUtilsMessengerEXT(
 }
 
 // class member functions
-VeDevice::VeDevice(VeWindow &window) : window{window} {
+VeDevice::VeDevice(VeWindow &window) : window{&window} {
+    init();
+}
+
+VeDevice::VeDevice() {
+    init();
+}
+
+void VeDevice::init() {
     createInstance();
     setupDebugMessenger();
     createSurface();
     pickPhysicalDevice();
     createLogicalDevice();
     createCommandPool();
+
+    allocator = std::make_unique<VeMemoryAllocator>(
+        device_, physicalDevice);
+    pipelineCache_ = std::make_unique<VePipelineCache>(
+        device_, properties, VePipelineCache::defaultPath());
 }
 
 VeDevice::~VeDevice() {
+    pipelineCache_.reset();
+    allocator.reset();
     vkDestroyCommandPool(device_, commandPool, nullptr);
     vkDestroyDevice(device_, nullptr);
 
@@ -88,7 +103,16 @@ void VeDevice::createInstance() {
     appInfo.applicationVersion = VK_MAKE_VERSION(1, 0, 0);
     appInfo.pEngineName = "No Engine";
     appInfo.engineVersion = VK_MAKE_VERSION(1, 0, 0);
-    appInfo.apiVersion = VK_API_VERSION_1_0;
+    // 1.2 for timeline semaphores. A 1.0 loader, the one
+    // without vkEnumerateInstanceVersion, fails on
+    // anything newer.
+    instanceVersion = VK_API_VERSION_1_0;
+    if (vkGetInstanceProcAddr(
+            nullptr, "vkEnumerateInstanceVersion") !=
+        nullptr) {
+        instanceVersion = VK_API_VERSION_1_2;
+    }
+    appInfo.apiVersion = instanceVersion;
 
     VkInstanceCreateInfo createInfo = {};
     createInfo.sType =
@@ -98,10 +122,10 @@ void VeDevice::createInstance() {
     auto extensions = getRequiredExtensions();
     createInfo.enabledExtensionCount =
         static_cast<uint32_t>(extensions.size());
-    std::cout << "Avaliable (For instance) extension:"
+    log() << "Avaliable (For instance) extension:"
               << std::endl;
     for (const auto &extension : extensions) {
-        std::cout << "  " << extension << std::endl;
+        log() << "  " << extension << std::endl;
     }
     createInfo.ppEnabledExtensionNames = extensions.data();
 
@@ -144,7 +168,7 @@ void VeDevice::pickPhysicalDevice() {
         throw std::runtime_error(
             "failed to find GPUs with Vulkan support!");
     }
-    std::cout << "Device count: " << deviceCount
+    log() << "Device count: " << deviceCount
               << std::endl;
     std::vector<VkPhysicalDevice> devices(deviceCount);
     vkEnumeratePhysicalDevices(instance, &deviceCount,
@@ -164,8 +188,14 @@ void VeDevice::pickPhysicalDevice() {
 
     vkGetPhysicalDeviceProperties(physicalDevice,
                                   &properties);
-    std::cout << "physical device: "
+    log() << "physical device: "
               << properties.deviceName << std::endl;
+
+    timelineSemaphores_ =
+        supportsTimelineSemaphores(physicalDevice);
+    log() << "timeline semaphores: "
+          << (timelineSemaphores_ ? "yes" : "no")
+          << std::endl;
 }
 
 void VeDevice::createLogicalDevice() {
@@ -176,6 +206,10 @@ void VeDevice::createLogicalDevice() {
     std::set<uint32_t> uniqueQueueFamilies = {
         indices.graphicsFamily, indices.presentFamily};
 
+    if (indices.transferFamilyHasValue) {
+        uniqueQueueFamilies.insert(indices.transferFamily);
+    }
+
     float queuePriority = 1.0f;
     for (uint32_t queueFamily : uniqueQueueFamilies) {
         VkDeviceQueueCreateInfo queueCreateInfo = {};
@@ -190,23 +224,34 @@ void VeDevice::createLogicalDevice() {
     VkPhysicalDeviceFeatures deviceFeatures = {};
     deviceFeatures.samplerAnisotropy = VK_TRUE;
 
+    // Uploads hand out timeline values as tickets where
+    // the device has them.
+    VkPhysicalDeviceTimelineSemaphoreFeatures
+        timelineFeatures{};
+    timelineFeatures.sType =
+        VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES;
+    timelineFeatures.timelineSemaphore = VK_TRUE;
+
     VkDeviceCreateInfo createInfo = {};
     createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+    if (timelineSemaphores_) {
+        createInfo.pNext = &timelineFeatures;
+    }
 
     createInfo.queueCreateInfoCount =
         static_cast<uint32_t>(queueCreateInfos.size());
     createInfo.pQueueCreateInfos = queueCreateInfos.data();
 
     createInfo.pEnabledFeatures = &deviceFeatures;
+    auto extensions = getRequiredDeviceExtensions();
     createInfo.enabledExtensionCount =
-        static_cast<uint32_t>(deviceExtensions.size());
-    std::cout << "Avaliable (For device) extension:"
+        static_cast<uint32_t>(extensions.size());
+    log() << "Avaliable (For device) extension:"
               << std::endl;
-    for (const auto &extension : deviceExtensions) {
-        std::cout << "  " << extension << std::endl;
+    for (const auto &extension : extensions) {
+        log() << "  " << extension << std::endl;
     }
-    createInfo.ppEnabledExtensionNames =
-        deviceExtensions.data();
+    createInfo.ppEnabledExtensionNames = extensions.data();
 
     // might not really be necessary anymore because device
     // specific validation layers have been deprecated
@@ -229,6 +274,17 @@ void VeDevice::createLogicalDevice() {
                      &graphicsQueue_);
     vkGetDeviceQueue(device_, indices.presentFamily, 0,
                      &presentQueue_);
+
+    if (indices.transferFamilyHasValue) {
+        vkGetDeviceQueue(device_, indices.transferFamily, 0,
+                         &transferQueue_);
+    } else {
+        transferQueue_ = graphicsQueue_;
+    }
+}
+
+std::ostream &VeDevice::log() const {
+    return headless() ? std::cerr : std::cout;
 }
 
 void VeDevice::createCommandPool() {
@@ -252,7 +308,9 @@ void VeDevice::createCommandPool() {
 }
 
 void VeDevice::createSurface() {
-    window.createWindowSurface(instance, &surface_);
+    if (window != nullptr) {
+        window->createWindowSurface(instance, &surface_);
+    }
 }
 
 bool VeDevice::isDeviceSuitable(VkPhysicalDevice device) {
@@ -261,8 +319,8 @@ bool VeDevice::isDeviceSuitable(VkPhysicalDevice device) {
     bool extensionsSupported =
         checkDeviceExtensionSupport(device);
 
-    bool swapChainAdequate = false;
-    if (extensionsSupported) {
+    bool swapChainAdequate = headless();
+    if (extensionsSupported && !headless()) {
         SwapChainSupportDetails swapChainSupport =
             querySwapChainSupport(device);
         swapChainAdequate =
@@ -278,6 +336,34 @@ bool VeDevice::isDeviceSuitable(VkPhysicalDevice device) {
            supportedFeatures.samplerAnisotropy;
 }
 
+bool VeDevice::supportsTimelineSemaphores(
+    VkPhysicalDevice device) {
+    VkPhysicalDeviceProperties deviceProperties;
+    vkGetPhysicalDeviceProperties(device,
+                                  &deviceProperties);
+
+    // Core in 1.2, the version the instance asks for
+    // where the loader has it.
+    if (instanceVersion < VK_API_VERSION_1_2 ||
+        deviceProperties.apiVersion < VK_API_VERSION_1_2) {
+        return false;
+    }
+
+    VkPhysicalDeviceTimelineSemaphoreFeatures
+        timelineFeatures{};
+    timelineFeatures.sType =
+        VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES;
+
+    VkPhysicalDeviceFeatures2 supportedFeatures{};
+    supportedFeatures.sType =
+        VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+    supportedFeatures.pNext = &timelineFeatures;
+    vkGetPhysicalDeviceFeatures2(device,
+                                 &supportedFeatures);
+
+    return timelineFeatures.timelineSemaphore;
+}
+
 void VeDevice::populateDebugMessengerCreateInfo(
     VkDebugUtilsMessengerCreateInfoEXT &createInfo) {
     createInfo = {};
@@ -339,14 +425,18 @@ bool VeDevice::checkValidationLayerSupport() {
 
 std::vector<const char *>
 VeDevice::getRequiredExtensions() {
-    uint32_t glfwExtensionCount = 0;
-    const char **glfwExtensions;
-    glfwExtensions = glfwGetRequiredInstanceExtensions(
-        &glfwExtensionCount);
+    std::vector<const char *> extensions;
 
-    std::vector<const char *> extensions(
-        glfwExtensions,
-        glfwExtensions + glfwExtensionCount);
+    // GLFW is never initialised without a window.
+    if (window != nullptr) {
+        uint32_t glfwExtensionCount = 0;
+        const char **glfwExtensions;
+        glfwExtensions = glfwGetRequiredInstanceExtensions(
+            &glfwExtensionCount);
+        extensions.assign(
+            glfwExtensions,
+            glfwExtensions + glfwExtensionCount);
+    }
 
     if (enableValidationLayers) {
         extensions.push_back(
@@ -362,6 +452,21 @@ VeDevice::getRequiredExtensions() {
     return extensions;
 }
 
+std::vector<const char *>
+VeDevice::getRequiredDeviceExtensions() {
+    std::vector<const char *> extensions;
+
+    for (const char *extension : deviceExtensions) {
+        if (!headless() ||
+            strcmp(extension,
+                   VK_KHR_SWAPCHAIN_EXTENSION_NAME) != 0) {
+            extensions.push_back(extension);
+        }
+    }
+
+    return extensions;
+}
+
 void VeDevice::hasGflwRequiredInstanceExtensions() {
     uint32_t extensionCount = 0;
     vkEnumerateInstanceExtensionProperties(
@@ -371,18 +476,18 @@ void VeDevice::hasGflwRequiredInstanceExtensions() {
     vkEnumerateInstanceExtensionProperties(
         nullptr, &extensionCount, extensions.data());
 
-    std::cout << "available extensions:" << std::endl;
+    log() << "available extensions:" << std::endl;
     std::unordered_set<std::string> available;
     for (const auto &extension : extensions) {
-        std::cout << "\t" << extension.extensionName
+        log() << "\t" << extension.extensionName
                   << std::endl;
         available.insert(extension.extensionName);
     }
 
-    std::cout << "required extensions:" << std::endl;
+    log() << "required extensions:" << std::endl;
     auto requiredExtensions = getRequiredExtensions();
     for (const auto &required : requiredExtensions) {
-        std::cout << "\t" << required << std::endl;
+        log() << "\t" << required << std::endl;
         if (available.find(required) == available.end()) {
             throw std::runtime_error(
                 "Missing required glfw extension");
@@ -402,13 +507,14 @@ bool VeDevice::checkDeviceExtensionSupport(
         device, nullptr, &extensionCount,
         availableExtensions.data());
 
+    auto required = getRequiredDeviceExtensions();
     std::set<std::string> requiredExtensions(
-        deviceExtensions.begin(), deviceExtensions.end());
+        required.begin(), required.end());
 
-    std::cout << "Avaliable extensions: " << std::endl;
+    log() << "Avaliable extensions: " << std::endl;
 
     for (const auto &extension : availableExtensions) {
-        std::cout << "  " << extension.extensionName
+        log() << "  " << extension.extensionName
                   << std::endl;
         requiredExtensions.erase(extension.extensionName);
     }
@@ -438,8 +544,13 @@ QueueFamilyIndices VeDevice::findQueueFamilies(
             indices.graphicsFamilyHasValue = true;
         }
         VkBool32 presentSupport = false;
-        vkGetPhysicalDeviceSurfaceSupportKHR(
-            device, i, surface_, &presentSupport);
+        if (surface_ != VK_NULL_HANDLE) {
+            vkGetPhysicalDeviceSurfaceSupportKHR(
+                device, i, surface_, &presentSupport);
+        } else {
+            // Nothing is presented, any family does.
+            presentSupport = VK_TRUE;
+        }
         if (queueFamily.queueCount > 0 && presentSupport) {
             indices.presentFamily = i;
             indices.presentFamilyHasValue = true;
@@ -451,6 +562,26 @@ QueueFamilyIndices VeDevice::findQueueFamilies(
         i++;
     }
 
+    for (uint32_t j = 0; j < queueFamilyCount; j++) {
+        VkQueueFlags flags = queueFamilies[j].queueFlags;
+        // The glyph atlas copies rectangles at any offset
+        // and size, which a coarser granularity forbids.
+        VkExtent3D granularity =
+            queueFamilies[j].minImageTransferGranularity;
+
+        if (queueFamilies[j].queueCount > 0 &&
+            (flags & VK_QUEUE_TRANSFER_BIT) &&
+            !(flags & (VK_QUEUE_GRAPHICS_BIT |
+                       VK_QUEUE_COMPUTE_BIT)) &&
+            granularity.width == 1 &&
+            granularity.height == 1 &&
+            granularity.depth == 1) {
+            indices.transferFamily = j;
+            indices.transferFamilyHasValue = true;
+            break;
+        }
+    }
+
     return indices;
 }
 
@@ -527,13 +658,21 @@ uint32_t VeDevice::findMemoryType(
 void VeDevice::createBuffer(
     VkDeviceSize size, VkBufferUsageFlags usage,
     VkMemoryPropertyFlags properties, VkBuffer &buffer,
-    VkDeviceMemory &bufferMemory) {
+    VeAllocation &bufferMemory) {
     VkBufferCreateInfo bufferInfo{};
     bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
     bufferInfo.size = size;
     bufferInfo.usage = usage;
     bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
 
+    createBufferWithInfo(bufferInfo, properties, buffer,
+                         bufferMemory);
+}
+
+void VeDevice::createBufferWithInfo(
+    const VkBufferCreateInfo &bufferInfo,
+    VkMemoryPropertyFlags properties, VkBuffer &buffer,
+    VeAllocation &bufferMemory) {
     if (vkCreateBuffer(device_, &bufferInfo, nullptr,
                        &buffer) != VK_SUCCESS) {
         throw std::runtime_error(
@@ -544,109 +683,17 @@ void VeDevice::createBuffer(
     vkGetBufferMemoryRequirements(device_, buffer,
                                   &memRequirements);
 
-    VkMemoryAllocateInfo allocInfo{};
-    allocInfo.sType =
-        VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-    allocInfo.allocationSize = memRequirements.size;
-    allocInfo.memoryTypeIndex = findMemoryType(
-        memRequirements.memoryTypeBits, properties);
-
-    if (vkAllocateMemory(device_, &allocInfo, nullptr,
-                         &bufferMemory) != VK_SUCCESS) {
-        throw std::runtime_error(
-            "failed to allocate vertex buffer memory!");
-    }
+    bufferMemory = allocator->allocate(memRequirements,
+                                       properties, true);
 
-    vkBindBufferMemory(device_, buffer, bufferMemory, 0);
-}
-
-VkCommandBuffer VeDevice::beginSingleTimeCommands() {
-    VkCommandBufferAllocateInfo allocInfo{};
-    allocInfo.sType =
-        VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-    allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-    allocInfo.commandPool = commandPool;
-    allocInfo.commandBufferCount = 1;
-
-    VkCommandBuffer commandBuffer;
-    vkAllocateCommandBuffers(device_, &allocInfo,
-                             &commandBuffer);
-
-    VkCommandBufferBeginInfo beginInfo{};
-    beginInfo.sType =
-        VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-    beginInfo.flags =
-        VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
-
-    vkBeginCommandBuffer(commandBuffer, &beginInfo);
-    return commandBuffer;
-}
-
-void VeDevice::endSingleTimeCommands(
-    VkCommandBuffer commandBuffer) {
-    vkEndCommandBuffer(commandBuffer);
-
-    VkSubmitInfo submitInfo{};
-    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-    submitInfo.commandBufferCount = 1;
-    submitInfo.pCommandBuffers = &commandBuffer;
-
-    vkQueueSubmit(graphicsQueue_, 1, &submitInfo,
-                  VK_NULL_HANDLE);
-    vkQueueWaitIdle(graphicsQueue_);
-
-    vkFreeCommandBuffers(device_, commandPool, 1,
-                         &commandBuffer);
-}
-
-void VeDevice::copyBuffer(VkBuffer srcBuffer,
-                          VkBuffer dstBuffer,
-                          VkDeviceSize size) {
-    VkCommandBuffer commandBuffer =
-        beginSingleTimeCommands();
-
-    VkBufferCopy copyRegion{};
-    copyRegion.srcOffset = 0;  // Optional
-    copyRegion.dstOffset = 0;  // Optional
-    copyRegion.size = size;
-    vkCmdCopyBuffer(commandBuffer, srcBuffer, dstBuffer, 1,
-                    &copyRegion);
-
-    endSingleTimeCommands(commandBuffer);
-}
-
-void VeDevice::copyBufferToImage(VkBuffer buffer,
-                                 VkImage image,
-                                 uint32_t width,
-                                 uint32_t height,
-                                 uint32_t layerCount) {
-    VkCommandBuffer commandBuffer =
-        beginSingleTimeCommands();
-
-    VkBufferImageCopy region{};
-    region.bufferOffset = 0;
-    region.bufferRowLength = 0;
-    region.bufferImageHeight = 0;
-
-    region.imageSubresource.aspectMask =
-        VK_IMAGE_ASPECT_COLOR_BIT;
-    region.imageSubresource.mipLevel = 0;
-    region.imageSubresource.baseArrayLayer = 0;
-    region.imageSubresource.layerCount = layerCount;
-
-    region.imageOffset = {0, 0, 0};
-    region.imageExtent = {width, height, 1};
-
-    vkCmdCopyBufferToImage(
-        commandBuffer, buffer, image,
-        VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
-    endSingleTimeCommands(commandBuffer);
+    vkBindBufferMemory(device_, buffer, bufferMemory.memory,
+                       bufferMemory.offset);
 }
 
 void VeDevice::createImageWithInfo(
     const VkImageCreateInfo &imageInfo,
     VkMemoryPropertyFlags properties, VkImage &image,
-    VkDeviceMemory &imageMemory) {
+    VeAllocation &imageMemory) {
     if (vkCreateImage(device_, &imageInfo, nullptr,
                       &image) != VK_SUCCESS) {
         throw std::runtime_error("failed to create image!");
@@ -656,21 +703,13 @@ void VeDevice::createImageWithInfo(
     vkGetImageMemoryRequirements(device_, image,
                                  &memRequirements);
 
-    VkMemoryAllocateInfo allocInfo{};
-    allocInfo.sType =
-        VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-    allocInfo.allocationSize = memRequirements.size;
-    allocInfo.memoryTypeIndex = findMemoryType(
-        memRequirements.memoryTypeBits, properties);
+    imageMemory = allocator->allocate(
+        memRequirements, properties,
+        imageInfo.tiling == VK_IMAGE_TILING_LINEAR);
 
-    if (vkAllocateMemory(device_, &allocInfo, nullptr,
-                         &imageMemory) != VK_SUCCESS) {
-        throw std::runtime_error(
-            "failed to allocate image memory!");
-    }
-
-    if (vkBindImageMemory(device_, image, imageMemory, 0) !=
-        VK_SUCCESS) {
+    if (vkBindImageMemory(
+            device_, image, imageMemory.memory,
+            imageMemory.offset) != VK_SUCCESS) {
         throw std::runtime_error(
             "failed to bind image memory!");
     }
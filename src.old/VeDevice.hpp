@@ -1,9 +1,13 @@
 #pragma once
 
 #include "VeDevice.hpp"
+#include "VeMemoryAllocator.hpp"
+#include "VePipelineCache.hpp"
 #include "VeWindow.hpp"
 
 // std lib headers
+#include <iosfwd>
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -18,8 +22,14 @@ struct SwapChainSupportDetails {
 struct QueueFamilyIndices {
     uint32_t graphicsFamily;
     uint32_t presentFamily;
+    // A family that can only transfer, usually a copy
+    // engine running beside graphics, and copy images at
+    // any texel. Optional, uploads use the graphics family
+    // otherwise.
+    uint32_t transferFamily;
     bool graphicsFamilyHasValue = false;
     bool presentFamilyHasValue = false;
+    bool transferFamilyHasValue = false;
     bool isComplete() {
         return graphicsFamilyHasValue &&
                presentFamilyHasValue;
@@ -35,6 +45,10 @@ class VeDevice {
 #endif
 
     VeDevice(VeWindow &window);
+    // Headless, without a surface or swap chain support,
+    // for rendering offscreen. Works on ICDs that can't
+    // present at all, like lavapipe.
+    VeDevice();
     ~VeDevice();
 
     // Not copyable or movable
@@ -49,15 +63,31 @@ class VeDevice {
     VkDevice device() {
         return device_;
     }
+    VkPhysicalDevice getPhysicalDevice() {
+        return physicalDevice;
+    }
     VkSurfaceKHR surface() {
         return surface_;
     }
+    bool headless() const {
+        return window == nullptr;
+    }
     VkQueue graphicsQueue() {
         return graphicsQueue_;
     }
     VkQueue presentQueue() {
         return presentQueue_;
     }
+    // Queue of the transfer family, the graphics queue if
+    // there is none.
+    VkQueue transferQueue() {
+        return transferQueue_;
+    }
+    // Whether timeline semaphores are enabled, Vulkan 1.2
+    // devices that have the feature.
+    bool timelineSemaphores() const {
+        return timelineSemaphores_;
+    }
 
     SwapChainSupportDetails getSwapChainSupport() {
         return querySwapChainSupport(physicalDevice);
@@ -73,29 +103,39 @@ class VeDevice {
         VkImageTiling tiling,
         VkFormatFeatureFlags features);
 
+    VeMemoryAllocator &memoryAllocator() {
+        return *allocator;
+    }
+    // Shared by every pipeline and kept on disk.
+    VePipelineCache &pipelineCache() {
+        return *pipelineCache_;
+    }
+
     // Buffer Helper Functions
     void createBuffer(VkDeviceSize size,
                       VkBufferUsageFlags usage,
                       VkMemoryPropertyFlags properties,
                       VkBuffer &buffer,
-                      VkDeviceMemory &bufferMemory);
-    VkCommandBuffer beginSingleTimeCommands();
-    void endSingleTimeCommands(
-        VkCommandBuffer commandBuffer);
-    void copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer,
-                    VkDeviceSize size);
-    void copyBufferToImage(VkBuffer buffer, VkImage image,
-                           uint32_t width, uint32_t height,
-                           uint32_t layerCount);
-
+                      VeAllocation &bufferMemory);
+    void createBufferWithInfo(
+        const VkBufferCreateInfo &bufferInfo,
+        VkMemoryPropertyFlags properties, VkBuffer &buffer,
+        VeAllocation &bufferMemory);
     void createImageWithInfo(
         const VkImageCreateInfo &imageInfo,
         VkMemoryPropertyFlags properties, VkImage &image,
-        VkDeviceMemory &imageMemory);
+        VeAllocation &imageMemory);
+    // Returns memory from createBuffer or
+    // createImageWithInfo, after the resource bound to it
+    // was destroyed.
+    void freeMemory(VeAllocation &memory) {
+        allocator->free(memory);
+    }
 
     VkPhysicalDeviceProperties properties;
 
    private:
+    void init();
     void createInstance();
     void setupDebugMessenger();
     void createSurface();
@@ -104,8 +144,14 @@ class VeDevice {
     void createCommandPool();
 
     // helper functions
+    // Where the setup is logged. Headless users like the
+    // benches keep stdout for their own output.
+    std::ostream &log() const;
     bool isDeviceSuitable(VkPhysicalDevice device);
+    bool supportsTimelineSemaphores(
+        VkPhysicalDevice device);
     std::vector<const char *> getRequiredExtensions();
+    std::vector<const char *> getRequiredDeviceExtensions();
     bool checkValidationLayerSupport();
     QueueFamilyIndices findQueueFamilies(
         VkPhysicalDevice device);
@@ -118,15 +164,22 @@ class VeDevice {
         VkPhysicalDevice device);
 
     VkInstance instance;
+    uint32_t instanceVersion;
     VkDebugUtilsMessengerEXT debugMessenger;
     VkPhysicalDevice physicalDevice = VK_NULL_HANDLE;
-    VeWindow &window;
+    // Null when headless.
+    VeWindow *window = nullptr;
     VkCommandPool commandPool;
 
     VkDevice device_;
-    VkSurfaceKHR surface_;
+    VkSurfaceKHR surface_ = VK_NULL_HANDLE;
     VkQueue graphicsQueue_;
     VkQueue presentQueue_;
+    VkQueue transferQueue_;
+    bool timelineSemaphores_ = false;
+
+    std::unique_ptr<VeMemoryAllocator> allocator;
+    std::unique_ptr<VePipelineCache> pipelineCache_;
 
     const std::vector<const char *> validationLayers = {
         "VK_LAYER_KHRONOS_validation"};
@@ -0,0 +1,165 @@
+#include "VeFont.hpp"
+
+// lib
+#include <ft2build.h>
+#include FT_FREETYPE_H
+#include FT_MODULE_H
+
+// c std
+#include <stdlib.h>
+#include <unistd.h>
+
+// std
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+
+namespace ve {
+
+VeFont::VeFont(const std::string &path,
+               uint32_t pixelHeight, GlyphMode mode)
+    : pixelHeight_{pixelHeight}, mode_{mode} {
+    if (FT_Init_FreeType(&library) != 0) {
+        throw std::runtime_error(
+            "failed to initialize FreeType");
+    }
+
+    if (mode == GlyphMode::Distance) {
+        // The default of 2 pixels falls apart as soon as
+        // the text is scaled up. "sdf" renders outlines,
+        // "bsdf" bitmaps.
+        FT_Int spread = SDF_SPREAD;
+
+        if (FT_Property_Set(library, "sdf", "spread",
+                            &spread) != 0 ||
+            FT_Property_Set(library, "bsdf", "spread",
+                            &spread) != 0) {
+            FT_Done_FreeType(library);
+            throw std::runtime_error(
+                "FreeType has no distance field support");
+        }
+    }
+
+    if (FT_New_Face(library, path.c_str(), 0, &face) != 0) {
+        FT_Done_FreeType(library);
+        throw std::runtime_error("failed to load font: " +
+                                 path);
+    }
+
+    if (FT_Set_Pixel_Sizes(face, 0, pixelHeight) != 0) {
+        FT_Done_Face(face);
+        FT_Done_FreeType(library);
+        throw std::runtime_error(
+            "failed to set font size: " + path);
+    }
+
+    // Metrics are in 26.6 fixed point.
+    lineHeight_ = static_cast<uint32_t>(
+        (face->size->metrics.height + 63) >> 6);
+    ascender_ = static_cast<uint32_t>(
+        (face->size->metrics.ascender + 63) >> 6);
+}
+
+VeFont::~VeFont() {
+    FT_Done_Face(face);
+    FT_Done_FreeType(library);
+}
+
+bool VeFont::rasterize(char32_t codepoint,
+                       GlyphBitmap &bitmap) const {
+    FT_UInt index = FT_Get_Char_Index(face, codepoint);
+    FT_GlyphSlot slot = face->glyph;
+
+    if (mode_ == GlyphMode::Coverage) {
+        if (FT_Load_Glyph(face, index, FT_LOAD_RENDER) !=
+            0) {
+            return false;
+        }
+    } else {
+        // Hinting snaps the outline to this size's pixel
+        // grid, which is wrong at every other size.
+        if (FT_Load_Glyph(face, index,
+                          FT_LOAD_NO_HINTING) != 0) {
+            return false;
+        }
+
+        // Blanks have nothing to measure distances to.
+        bool blank =
+            slot->format == FT_GLYPH_FORMAT_OUTLINE &&
+            slot->outline.n_contours == 0;
+
+        if (!blank && FT_Render_Glyph(
+                          slot, FT_RENDER_MODE_SDF) != 0) {
+            return false;
+        }
+    }
+
+    const FT_Bitmap &source = slot->bitmap;
+
+    if (source.pixel_mode != FT_PIXEL_MODE_GRAY &&
+        source.width > 0) {
+        return false;
+    }
+
+    bitmap.width = source.width;
+    bitmap.height = source.rows;
+    bitmap.left = slot->bitmap_left;
+    bitmap.top = -slot->bitmap_top;
+    bitmap.advance =
+        static_cast<float>(slot->advance.x) / 64.0f;
+    bitmap.pixels.resize(static_cast<size_t>(source.width) *
+                         source.rows);
+
+    if (bitmap.pixels.empty()) {
+        return true;
+    }
+
+    // FreeType rows may be padded or stored bottom up.
+    for (uint32_t row = 0; row < source.rows; row++) {
+        uint32_t stored = source.pitch >= 0
+                              ? row
+                              : source.rows - 1 - row;
+        const unsigned char *line =
+            source.buffer +
+            stored * static_cast<uint32_t>(
+                         std::abs(source.pitch));
+
+        std::memcpy(
+            bitmap.pixels.data() + row * source.width, line,
+            source.width);
+    }
+
+    return true;
+}
+
+std::string VeFont::defaultPath() {
+    if (const char *font = getenv("EDITOR_FONT")) {
+        return font;
+    }
+
+    const char *candidates[] = {
+#ifdef __APPLE__
+        "/System/Library/Fonts/Menlo.ttc",
+        "/System/Library/Fonts/Monaco.ttf",
+#endif
+        "/usr/share/fonts/truetype/dejavu/"
+        "DejaVuSansMono.ttf",
+        "/usr/share/fonts/TTF/DejaVuSansMono.ttf",
+        "/usr/share/fonts/dejavu/DejaVuSansMono.ttf",
+        "/usr/share/fonts/truetype/liberation/"
+        "LiberationMono-Regular.ttf",
+        "/usr/share/fonts/liberation-mono/"
+        "LiberationMono-Regular.ttf",
+    };
+
+    for (const char *candidate : candidates) {
+        if (access(candidate, R_OK) == 0) {
+            return candidate;
+        }
+    }
+
+    throw std::runtime_error(
+        "failed to find a monospace font, set EDITOR_FONT");
+}
+
+}  // namespace ve
@@ -0,0 +1,89 @@
+#pragma once
+
+// std
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Forward declared so FreeType stays out of the headers.
+typedef struct FT_LibraryRec_ *FT_Library;
+typedef struct FT_FaceRec_ *FT_Face;
+
+namespace ve {
+
+// Coverage bitmap of one glyph, one byte per pixel, rows
+// top to bottom without padding.
+struct GlyphBitmap {
+    uint32_t width = 0;
+    uint32_t height = 0;
+    // Offset of the bitmap's top left corner from the pen
+    // position on the baseline, y pointing down.
+    int32_t left = 0;
+    int32_t top = 0;
+    // Horizontal pen advance in pixels.
+    float advance = 0.0f;
+    std::vector<uint8_t> pixels;
+};
+
+// What the pixels of a GlyphBitmap hold.
+enum class GlyphMode {
+    // Coverage of the pixel, only good at the size it was
+    // rasterized at.
+    Coverage,
+    // Signed distance to the outline, 128 on it, larger
+    // inside and SDF_SPREAD pixels per 128 steps. Can be
+    // drawn at any size.
+    Distance,
+};
+
+// A font face rasterized on the CPU with FreeType at a
+// fixed pixel size.
+class VeFont {
+   public:
+    // Distance in pixels at which a distance field
+    // saturates, and the border it adds around glyphs.
+    static constexpr int SDF_SPREAD = 8;
+
+    VeFont(const std::string &path, uint32_t pixelHeight,
+           GlyphMode mode = GlyphMode::Coverage);
+    ~VeFont();
+
+    VeFont(const VeFont &) = delete;
+    VeFont &operator=(const VeFont &) = delete;
+
+    // Renders codepoint in the font's mode, or the font's
+    // missing glyph box if it has no glyph for it. Returns
+    // false if FreeType failed to render it at all.
+    bool rasterize(char32_t codepoint,
+                   GlyphBitmap &bitmap) const;
+
+    // Distance between baselines and from the top of a line
+    // to its baseline, in pixels.
+    uint32_t lineHeight() const {
+        return lineHeight_;
+    }
+    uint32_t ascender() const {
+        return ascender_;
+    }
+    uint32_t pixelHeight() const {
+        return pixelHeight_;
+    }
+    GlyphMode mode() const {
+        return mode_;
+    }
+
+    // Font file to use: $EDITOR_FONT if set, otherwise the
+    // first monospace font found in the usual places.
+    static std::string defaultPath();
+
+   private:
+    FT_Library library = nullptr;
+    FT_Face face = nullptr;
+
+    uint32_t pixelHeight_;
+    GlyphMode mode_;
+    uint32_t lineHeight_ = 0;
+    uint32_t ascender_ = 0;
+};
+
+}  // namespace ve
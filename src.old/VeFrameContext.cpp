@@ -0,0 +1,83 @@
+#include "VeFrameContext.hpp"
+
+#include <vulkan/vulkan_core.h>
+
+// std
+#include <cassert>
+#include <stdexcept>
+
+namespace ve {
+
+VeFrameContext::VeFrameContext(VeDevice &device,
+                               uint32_t frameCount)
+    : veDevice{device}, frames(frameCount) {
+    for (auto &frame : frames) {
+        createFrame(frame);
+    }
+}
+
+VeFrameContext::~VeFrameContext() {
+    for (auto &frame : frames) {
+        // Frees the buffer too.
+        vkDestroyCommandPool(veDevice.device(),
+                             frame.commandPool, nullptr);
+    }
+}
+
+VkCommandBuffer VeFrameContext::beginFrame(
+    uint32_t frameIndex) {
+    assert(frameIndex < frames.size() &&
+           "frame index outside of the frame context");
+
+    Frame &frame = frames[frameIndex];
+
+    // Without RELEASE_RESOURCES_BIT the pool keeps its
+    // memory for the next recording.
+    if (vkResetCommandPool(veDevice.device(),
+                           frame.commandPool,
+                           0) != VK_SUCCESS) {
+        throw std::runtime_error(
+            "failed to reset frame command pool");
+    }
+
+    stats_.poolResets++;
+    return frame.commandBuffer;
+}
+
+void VeFrameContext::createFrame(Frame &frame) {
+    VkCommandPoolCreateInfo poolInfo{};
+    poolInfo.sType =
+        VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    poolInfo.queueFamilyIndex =
+        veDevice.findPhysicalQueueFamilies().graphicsFamily;
+    // Buffers are only ever reset with the pool.
+    poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+
+    if (vkCreateCommandPool(veDevice.device(), &poolInfo,
+                            nullptr, &frame.commandPool) !=
+        VK_SUCCESS) {
+        throw std::runtime_error(
+            "failed to create frame command pool");
+    }
+
+    stats_.poolsCreated++;
+
+    VkCommandBufferAllocateInfo allocInfo{};
+    allocInfo.sType =
+        VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    allocInfo.commandPool = frame.commandPool;
+    allocInfo.commandBufferCount = 1;
+
+    if (vkAllocateCommandBuffers(veDevice.device(),
+                                 &allocInfo,
+                                 &frame.commandBuffer) !=
+        VK_SUCCESS) {
+        throw std::runtime_error(
+            "failed to allocate frame command buffer");
+    }
+
+    stats_.buffersAllocated++;
+}
+
+}  // namespace ve
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <vulkan/vulkan_core.h>
+
+#include "VeDevice.hpp"
+#include "VeSwapChain.hpp"
+
+// std
+#include <cstdint>
+#include <vector>
+
+namespace ve {
+
+// Command memory of the frames in flight.
+//
+// Every frame has a transient command pool of its own with
+// one primary buffer allocated up front. Starting a frame
+// resets the whole pool with vkResetCommandPool, which
+// hands its memory back to the pool instead of the driver,
+// so after construction frames make no allocation calls.
+class VeFrameContext {
+   public:
+    // Calls into the driver since construction.
+    struct Stats {
+        uint64_t poolsCreated;
+        uint64_t buffersAllocated;
+        uint64_t poolResets;
+    };
+
+    VeFrameContext(VeDevice &device,
+                   uint32_t frameCount =
+                       VeSwapChain::MAX_FRAMES_IN_FLIGHT);
+    ~VeFrameContext();
+
+    VeFrameContext(const VeFrameContext &) = delete;
+    VeFrameContext &operator=(const VeFrameContext &) =
+        delete;
+
+    // Resets the pool of frameIndex and returns its primary
+    // buffer, ready to begin. The fence of the frame must
+    // have been waited for.
+    VkCommandBuffer beginFrame(uint32_t frameIndex);
+
+    Stats stats() const {
+        return stats_;
+    }
+
+   private:
+    struct Frame {
+        VkCommandPool commandPool = VK_NULL_HANDLE;
+        VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+    };
+
+    void createFrame(Frame &frame);
+
+    VeDevice &veDevice;
+    std::vector<Frame> frames;
+    Stats stats_{};
+};
+
+}  // namespace ve
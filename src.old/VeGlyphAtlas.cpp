@@ -0,0 +1,196 @@
+#include "VeGlyphAtlas.hpp"
+
+#include <vulkan/vulkan_core.h>
+
+// std
+#include <cstring>
+#include <stdexcept>
+
+namespace ve {
+
+VeGlyphAtlas::VeGlyphAtlas(VeDevice &device,
+                           VeUploadManager &uploader,
+                           const VeFont &font)
+    : veDevice{device},
+      veUploadManager{uploader},
+      veFont{font} {
+    createImage();
+    createSampler();
+
+    // Start from a blank atlas, so the padding around
+    // glyphs and any unused space sample as empty.
+    void *pixels = veUploadManager.uploadImage(
+        image, {0, 0, 0}, {SIZE, SIZE, 1}, SIZE * SIZE,
+        imageLayout,
+        VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+    std::memset(pixels, 0, SIZE * SIZE);
+    imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+}
+
+VeGlyphAtlas::~VeGlyphAtlas() {
+    vkDestroySampler(veDevice.device(), sampler, nullptr);
+    vkDestroyImageView(veDevice.device(), imageView,
+                       nullptr);
+    vkDestroyImage(veDevice.device(), image, nullptr);
+    veDevice.freeMemory(imageMemory);
+}
+
+const VeGlyphAtlas::Glyph &VeGlyphAtlas::lookup(
+    char32_t codepoint) {
+    auto found = glyphs.find(codepoint);
+
+    if (found != glyphs.end()) {
+        return found->second;
+    }
+
+    // Adding may empty the atlas, so only store the glyph
+    // afterwards.
+    Glyph glyph = add(codepoint);
+
+    if (codepoint < ascii.size()) {
+        ascii[codepoint] = glyph;
+        asciiKnown[codepoint] = true;
+        return ascii[codepoint];
+    }
+
+    return glyphs.emplace(codepoint, glyph).first->second;
+}
+
+VeGlyphAtlas::Glyph VeGlyphAtlas::add(char32_t codepoint) {
+    GlyphBitmap bitmap;
+    Glyph glyph;
+
+    if (!veFont.rasterize(codepoint, bitmap)) {
+        return glyph;
+    }
+
+    glyph.left = static_cast<int16_t>(bitmap.left);
+    glyph.top = static_cast<int16_t>(bitmap.top);
+    glyph.advance = bitmap.advance;
+
+    // Blanks only advance the pen.
+    if (bitmap.width == 0 || bitmap.height == 0) {
+        return glyph;
+    }
+
+    uint32_t width = bitmap.width + 2 * PADDING;
+    uint32_t height = bitmap.height + 2 * PADDING;
+    uint32_t x;
+    uint32_t y;
+
+    if (!packer.pack(width, height, x, y)) {
+        reset();
+
+        if (!packer.pack(width, height, x, y)) {
+            return glyph;
+        }
+    }
+
+    auto *pixels =
+        static_cast<uint8_t *>(veUploadManager.uploadImage(
+            image,
+            {static_cast<int32_t>(x),
+             static_cast<int32_t>(y), 0},
+            {width, height, 1}, width * height, imageLayout,
+            VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL));
+    std::memset(pixels, 0, width * height);
+
+    for (uint32_t row = 0; row < bitmap.height; row++) {
+        std::memcpy(
+            pixels + (row + PADDING) * width + PADDING,
+            bitmap.pixels.data() + row * bitmap.width,
+            bitmap.width);
+    }
+
+    imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    uploadCount_++;
+
+    glyph.x = static_cast<uint16_t>(x + PADDING);
+    glyph.y = static_cast<uint16_t>(y + PADDING);
+    glyph.width = static_cast<uint16_t>(bitmap.width);
+    glyph.height = static_cast<uint16_t>(bitmap.height);
+
+    return glyph;
+}
+
+void VeGlyphAtlas::reset() {
+    // Glyphs already queued still get copied, but before
+    // the ones packed over them, so they are simply
+    // overwritten.
+    packer.clear();
+    asciiKnown.fill(false);
+    glyphs.clear();
+    generation_++;
+}
+
+void VeGlyphAtlas::createImage() {
+    VkImageCreateInfo imageInfo{};
+    imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+    imageInfo.imageType = VK_IMAGE_TYPE_2D;
+    imageInfo.format = VK_FORMAT_R8_UNORM;
+    imageInfo.extent = {SIZE, SIZE, 1};
+    imageInfo.mipLevels = 1;
+    imageInfo.arrayLayers = 1;
+    imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+    imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+    imageInfo.usage = VK_IMAGE_USAGE_TRANSFER_DST_BIT |
+                      VK_IMAGE_USAGE_SAMPLED_BIT;
+    // Written on the transfer queue.
+    veUploadManager.setSharing(imageInfo);
+    imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+    veDevice.createImageWithInfo(
+        imageInfo, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+        image, imageMemory);
+
+    VkImageViewCreateInfo viewInfo{};
+    viewInfo.sType =
+        VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+    viewInfo.image = image;
+    viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+    viewInfo.format = VK_FORMAT_R8_UNORM;
+    viewInfo.subresourceRange.aspectMask =
+        VK_IMAGE_ASPECT_COLOR_BIT;
+    viewInfo.subresourceRange.baseMipLevel = 0;
+    viewInfo.subresourceRange.levelCount = 1;
+    viewInfo.subresourceRange.baseArrayLayer = 0;
+    viewInfo.subresourceRange.layerCount = 1;
+
+    if (vkCreateImageView(veDevice.device(), &viewInfo,
+                          nullptr,
+                          &imageView) != VK_SUCCESS) {
+        throw std::runtime_error(
+            "failed to create glyph atlas image view");
+    }
+}
+
+void VeGlyphAtlas::createSampler() {
+    VkSamplerCreateInfo samplerInfo{};
+    samplerInfo.sType =
+        VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+    samplerInfo.magFilter = VK_FILTER_LINEAR;
+    samplerInfo.minFilter = VK_FILTER_LINEAR;
+    samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+    samplerInfo.addressModeU =
+        VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerInfo.addressModeV =
+        VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerInfo.addressModeW =
+        VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerInfo.anisotropyEnable = VK_FALSE;
+    samplerInfo.maxAnisotropy = 1.0f;
+    samplerInfo.borderColor =
+        VK_BORDER_COLOR_FLOAT_TRANSPARENT_BLACK;
+    samplerInfo.unnormalizedCoordinates = VK_FALSE;
+    samplerInfo.compareEnable = VK_FALSE;
+    samplerInfo.minLod = 0.0f;
+    samplerInfo.maxLod = 0.0f;
+
+    if (vkCreateSampler(veDevice.device(), &samplerInfo,
+                        nullptr, &sampler) != VK_SUCCESS) {
+        throw std::runtime_error(
+            "failed to create glyph atlas sampler");
+    }
+}
+
+}  // namespace ve
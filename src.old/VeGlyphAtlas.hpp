@@ -0,0 +1,118 @@
+#pragma once
+
+#include <vulkan/vulkan_core.h>
+
+#include "ShelfPacker.hpp"
+#include "VeDevice.hpp"
+#include "VeFont.hpp"
+#include "VeUploadManager.hpp"
+
+// std
+#include <array>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+namespace ve {
+
+// Single channel texture holding every glyph drawn so far,
+// as coverage or distance fields depending on the font's
+// GlyphMode.
+//
+// Glyphs are rasterized on the CPU the first time they are
+// asked for, packed into shelves of the atlas and queued
+// on the uploader, so all glyphs first seen in a frame go
+// up in that frame's upload batch. Once the visible text
+// has been seen a frame does no texture uploads at all.
+class VeGlyphAtlas {
+   public:
+    static constexpr uint32_t SIZE = 1024;
+
+    // Where a glyph sits in the atlas and how to place it.
+    struct Glyph {
+        // Top left corner and size in atlas pixels.
+        uint16_t x = 0;
+        uint16_t y = 0;
+        uint16_t width = 0;
+        uint16_t height = 0;
+        // Offset from the pen position, y pointing down.
+        int16_t left = 0;
+        int16_t top = 0;
+        float advance = 0.0f;
+    };
+
+    VeGlyphAtlas(VeDevice &device,
+                 VeUploadManager &uploader,
+                 const VeFont &font);
+    ~VeGlyphAtlas();
+
+    VeGlyphAtlas(const VeGlyphAtlas &) = delete;
+    VeGlyphAtlas &operator=(const VeGlyphAtlas &) = delete;
+
+    // Returns the glyph, queueing it for upload if it
+    // hasn't been seen before. The uploader's next batch
+    // must be submitted before recording commands that
+    // sample it.
+    const Glyph &glyph(char32_t codepoint) {
+        if (codepoint < ascii.size() &&
+            asciiKnown[codepoint]) {
+            return ascii[codepoint];
+        }
+
+        return lookup(codepoint);
+    }
+
+    // Incremented every time the atlas ran full and was
+    // emptied, which invalidates glyphs returned before.
+    uint32_t generation() const {
+        return generation_;
+    }
+    // Glyphs uploaded over the atlas' lifetime.
+    uint64_t uploadCount() const {
+        return uploadCount_;
+    }
+
+    VkDescriptorImageInfo descriptorInfo() const {
+        return {sampler, imageView,
+                VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL};
+    }
+    const VeFont &font() const {
+        return veFont;
+    }
+
+   private:
+    // Empty border around every glyph so linear filtering
+    // never picks up a neighbour.
+    static constexpr uint32_t PADDING = 1;
+
+    const Glyph &lookup(char32_t codepoint);
+    // Rasterizes and queues a glyph that is not in the
+    // atlas.
+    Glyph add(char32_t codepoint);
+    void reset();
+
+    void createImage();
+    void createSampler();
+
+    VeDevice &veDevice;
+    VeUploadManager &veUploadManager;
+    const VeFont &veFont;
+
+    VkImage image;
+    VeAllocation imageMemory;
+    VkImageView imageView;
+    VkSampler sampler;
+    // Layout the image is left in by the last queued
+    // upload.
+    VkImageLayout imageLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+    ShelfPacker packer{SIZE, SIZE};
+    std::array<Glyph, 128> ascii{};
+    std::array<bool, 128> asciiKnown{};
+    std::unordered_map<char32_t, Glyph> glyphs;
+
+    uint32_t generation_ = 0;
+    uint64_t uploadCount_ = 0;
+};
+
+}  // namespace ve
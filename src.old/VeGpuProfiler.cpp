@@ -0,0 +1,262 @@
+#include "VeGpuProfiler.hpp"
+
+#include <vulkan/vulkan_core.h>
+
+// std
+#include <cassert>
+#include <stdexcept>
+
+namespace ve {
+
+namespace {
+
+constexpr uint32_t kQueriesPerFrame =
+    VeGpuProfiler::MAX_ZONES * 2;
+
+}  // namespace
+
+VeGpuProfiler::VeGpuProfiler(VeDevice &device,
+                             uint32_t frameCount)
+    : veDevice{device}, frames(frameCount) {
+    createQueryPool();
+}
+
+VeGpuProfiler::~VeGpuProfiler() {
+    if (enabled()) {
+        vkDestroyQueryPool(veDevice.device(), queryPool,
+                           nullptr);
+    }
+}
+
+void VeGpuProfiler::beginFrame(
+    VkCommandBuffer commandBuffer, uint32_t frameIndex) {
+    if (!enabled()) {
+        return;
+    }
+
+    current = frameIndex;
+    started = true;
+    readResults(frameIndex);
+
+    Frame &frame = frames[frameIndex];
+    frame.zones.clear();
+    frame.queriesUsed =
+        static_cast<uint32_t>(reserved.size()) * 2;
+    frame.submitted = false;
+
+    vkCmdResetQueryPool(commandBuffer, queryPool,
+                        frameIndex * kQueriesPerFrame,
+                        kQueriesPerFrame);
+}
+
+uint32_t VeGpuProfiler::beginZone(
+    VkCommandBuffer commandBuffer,
+    const std::string &name) {
+    Frame &frame = frames[current];
+
+    if (!enabled() ||
+        frame.queriesUsed + 2 > kQueriesPerFrame) {
+        return NO_ZONE;
+    }
+
+    uint32_t query =
+        current * kQueriesPerFrame + frame.queriesUsed;
+    frame.queriesUsed += 2;
+    frame.zones.push_back(
+        {nameIndex(name), query, query + 1});
+
+    vkCmdWriteTimestamp(commandBuffer,
+                        VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+                        queryPool, query);
+
+    return static_cast<uint32_t>(frame.zones.size() - 1);
+}
+
+void VeGpuProfiler::endZone(VkCommandBuffer commandBuffer,
+                            uint32_t zone) {
+    if (zone == NO_ZONE) {
+        return;
+    }
+
+    vkCmdWriteTimestamp(
+        commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+        queryPool, frames[current].zones[zone].endQuery);
+}
+
+uint32_t VeGpuProfiler::reserveZone(
+    const std::string &name) {
+    // Would move the dynamic zones of recorded frames.
+    assert(!started);
+
+    if (!enabled() ||
+        (reserved.size() + 1) * 2 > kQueriesPerFrame) {
+        return NO_ZONE;
+    }
+
+    reserved.push_back(nameIndex(name));
+    return static_cast<uint32_t>(reserved.size() - 1);
+}
+
+void VeGpuProfiler::beginZone(VkCommandBuffer commandBuffer,
+                              uint32_t frameIndex,
+                              uint32_t zone) const {
+    if (zone == NO_ZONE) {
+        return;
+    }
+
+    vkCmdWriteTimestamp(
+        commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+        queryPool,
+        frameIndex * kQueriesPerFrame + zone * 2);
+}
+
+void VeGpuProfiler::endZone(VkCommandBuffer commandBuffer,
+                            uint32_t frameIndex,
+                            uint32_t zone) const {
+    if (zone == NO_ZONE) {
+        return;
+    }
+
+    vkCmdWriteTimestamp(
+        commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+        queryPool,
+        frameIndex * kQueriesPerFrame + zone * 2 + 1);
+}
+
+void VeGpuProfiler::endFrame() {
+    if (enabled()) {
+        frames[current].submitted = true;
+    }
+}
+
+std::vector<VeGpuProfiler::ZoneStats> VeGpuProfiler::stats()
+    const {
+    std::vector<ZoneStats> zoneStats;
+
+    for (size_t i = 0; i < names.size(); i++) {
+        const LatencyProbe &duration = durations[i];
+        zoneStats.push_back(
+            {names[i], duration.count(),
+             duration.min() * 1000.0,
+             duration.mean() * 1000.0,
+             duration.percentile(0.99) * 1000.0});
+    }
+
+    return zoneStats;
+}
+
+uint32_t VeGpuProfiler::nameIndex(
+    const std::string &name) {
+    auto found = nameIndices.find(name);
+
+    if (found == nameIndices.end()) {
+        found = nameIndices
+                    .emplace(name, static_cast<uint32_t>(
+                                       names.size()))
+                    .first;
+        names.push_back(name);
+        durations.emplace_back(FRAMES_KEPT);
+    }
+
+    return found->second;
+}
+
+void VeGpuProfiler::readResults(uint32_t frameIndex) {
+    Frame &frame = frames[frameIndex];
+
+    if (!frame.submitted || frame.queriesUsed == 0) {
+        return;
+    }
+
+    uint32_t firstQuery = frameIndex * kQueriesPerFrame;
+
+    // The frame's fence has signalled, so this doesn't
+    // wait. Every query comes with whether it was written,
+    // reserved zones of buffers that didn't run weren't,
+    // which makes the call return VK_NOT_READY.
+    VkResult result = vkGetQueryPoolResults(
+        veDevice.device(), queryPool, firstQuery,
+        frame.queriesUsed,
+        frame.queriesUsed * 2 * sizeof(uint64_t),
+        results.data(), 2 * sizeof(uint64_t),
+        VK_QUERY_RESULT_64_BIT |
+            VK_QUERY_RESULT_WITH_AVAILABILITY_BIT);
+
+    if (result != VK_SUCCESS && result != VK_NOT_READY) {
+        return;
+    }
+
+    for (uint32_t i = 0; i < reserved.size(); i++) {
+        record(reserved[i], i * 2, i * 2 + 1);
+    }
+
+    for (const auto &zone : frame.zones) {
+        record(zone.name, zone.beginQuery - firstQuery,
+               zone.endQuery - firstQuery);
+    }
+
+    framesRead++;
+}
+
+void VeGpuProfiler::record(uint32_t name,
+                           uint32_t beginQuery,
+                           uint32_t endQuery) {
+    // Pairs of timestamp and availability.
+    if (results[beginQuery * 2 + 1] == 0 ||
+        results[endQuery * 2 + 1] == 0) {
+        return;
+    }
+
+    uint64_t ticks = (results[endQuery * 2] -
+                      results[beginQuery * 2]) &
+                     timestampMask;
+
+    durations[name].record(static_cast<double>(ticks) *
+                           timestampPeriod * 1e-9);
+}
+
+void VeGpuProfiler::createQueryPool() {
+    uint32_t queueFamilyCount = 0;
+    vkGetPhysicalDeviceQueueFamilyProperties(
+        veDevice.getPhysicalDevice(), &queueFamilyCount,
+        nullptr);
+
+    std::vector<VkQueueFamilyProperties> queueFamilies(
+        queueFamilyCount);
+    vkGetPhysicalDeviceQueueFamilyProperties(
+        veDevice.getPhysicalDevice(), &queueFamilyCount,
+        queueFamilies.data());
+
+    uint32_t validBits =
+        queueFamilies[veDevice.findPhysicalQueueFamilies()
+                          .graphicsFamily]
+            .timestampValidBits;
+
+    if (validBits == 0) {
+        return;
+    }
+
+    timestampPeriod =
+        veDevice.properties.limits.timestampPeriod;
+    timestampMask = validBits >= 64
+                        ? ~uint64_t{0}
+                        : (uint64_t{1} << validBits) - 1;
+    results.resize(kQueriesPerFrame * 2);
+
+    VkQueryPoolCreateInfo queryPoolInfo{};
+    queryPoolInfo.sType =
+        VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+    queryPoolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+    queryPoolInfo.queryCount =
+        static_cast<uint32_t>(frames.size()) *
+        kQueriesPerFrame;
+
+    if (vkCreateQueryPool(veDevice.device(), &queryPoolInfo,
+                          nullptr,
+                          &queryPool) != VK_SUCCESS) {
+        throw std::runtime_error(
+            "failed to create timestamp query pool");
+    }
+}
+
+}  // namespace ve
@@ -0,0 +1,182 @@
+#pragma once
+
+#include <vulkan/vulkan_core.h>
+
+#include "LatencyProbe.hpp"
+#include "VeDevice.hpp"
+#include "VeSwapChain.hpp"
+
+// std
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace ve {
+
+// Times GPU work with timestamp queries.
+//
+// Every frame in flight has its own range of the query
+// pool. Zones are opened and closed around commands while
+// recording, each writing a timestamp when the GPU gets to
+// it. A frame's results are read when its slot comes
+// around again, after the swap chain waited for the slot's
+// fence, so reading never stalls and results arrive one
+// frame in flight late. Durations are kept per zone name
+// over the last FRAMES_KEPT frames.
+//
+// Command buffers that are recorded once and executed in
+// many frames, like the regions of VeRegionRecorder, use
+// reserved zones instead. Those have the same queries in
+// every frame's range, so reusing a buffer keeps timing
+// it. A reserved zone whose buffer didn't run in a frame
+// is left out of that frame.
+//
+// Does nothing if the graphics queue has no timestamps.
+class VeGpuProfiler {
+   public:
+    static constexpr uint32_t MAX_ZONES = 32;
+    static constexpr size_t FRAMES_KEPT = 256;
+    static constexpr uint32_t NO_ZONE = UINT32_MAX;
+
+    // In milliseconds.
+    struct ZoneStats {
+        std::string name;
+        uint64_t count;
+        double min;
+        double avg;
+        double p99;
+    };
+
+    // Opens a zone for the lifetime of the scope.
+    class Scope {
+       public:
+        Scope(VeGpuProfiler &profiler,
+              VkCommandBuffer commandBuffer,
+              const std::string &name)
+            : profiler{profiler},
+              commandBuffer{commandBuffer},
+              zone{profiler.beginZone(commandBuffer,
+                                      name)} {
+        }
+        // A reserved zone, in the frame frameIndex.
+        Scope(VeGpuProfiler &profiler,
+              VkCommandBuffer commandBuffer,
+              uint32_t frameIndex, uint32_t zone)
+            : profiler{profiler},
+              commandBuffer{commandBuffer},
+              frameIndex{frameIndex},
+              zone{zone} {
+            profiler.beginZone(commandBuffer, frameIndex,
+                               zone);
+        }
+        ~Scope() {
+            if (frameIndex == NO_FRAME) {
+                profiler.endZone(commandBuffer, zone);
+            } else {
+                profiler.endZone(commandBuffer, frameIndex,
+                                 zone);
+            }
+        }
+
+        Scope(const Scope &) = delete;
+        Scope &operator=(const Scope &) = delete;
+
+       private:
+        static constexpr uint32_t NO_FRAME = UINT32_MAX;
+
+        VeGpuProfiler &profiler;
+        VkCommandBuffer commandBuffer;
+        uint32_t frameIndex = NO_FRAME;
+        uint32_t zone;
+    };
+
+    explicit VeGpuProfiler(
+        VeDevice &device,
+        uint32_t frameCount =
+            VeSwapChain::MAX_FRAMES_IN_FLIGHT);
+    ~VeGpuProfiler();
+
+    VeGpuProfiler(const VeGpuProfiler &) = delete;
+    VeGpuProfiler &operator=(const VeGpuProfiler &) =
+        delete;
+
+    bool enabled() const {
+        return queryPool != VK_NULL_HANDLE;
+    }
+
+    // Collects the results of the frame that last used
+    // frameIndex and resets its queries. Must be recorded
+    // outside of a render pass, before any zone.
+    void beginFrame(VkCommandBuffer commandBuffer,
+                    uint32_t frameIndex);
+    // Returns NO_ZONE once the frame's queries ran out.
+    uint32_t beginZone(VkCommandBuffer commandBuffer,
+                       const std::string &name);
+    void endZone(VkCommandBuffer commandBuffer,
+                 uint32_t zone);
+    // Reserves a zone with the same queries in every frame.
+    // Only before the first frame. Returns NO_ZONE once the
+    // queries ran out.
+    uint32_t reserveZone(const std::string &name);
+    // Writes a reserved zone's timestamps for the frame
+    // frameIndex. Only records into commandBuffer, so any
+    // thread may call them.
+    void beginZone(VkCommandBuffer commandBuffer,
+                   uint32_t frameIndex,
+                   uint32_t zone) const;
+    void endZone(VkCommandBuffer commandBuffer,
+                 uint32_t frameIndex, uint32_t zone) const;
+    // Called once the frame was submitted. A frame that
+    // was recorded but never submitted, e.g. because the
+    // swap chain had to be recreated, is not read.
+    void endFrame();
+
+    // Frames whose results have been read.
+    uint64_t framesMeasured() const {
+        return framesRead;
+    }
+    // Per zone name, in order of first use.
+    std::vector<ZoneStats> stats() const;
+
+   private:
+    struct Zone {
+        uint32_t name;
+        uint32_t beginQuery;
+        uint32_t endQuery;
+    };
+
+    struct Frame {
+        std::vector<Zone> zones;
+        uint32_t queriesUsed = 0;
+        bool submitted = false;
+    };
+
+    uint32_t nameIndex(const std::string &name);
+    void readResults(uint32_t frameIndex);
+    void record(uint32_t name, uint32_t beginQuery,
+                uint32_t endQuery);
+    void createQueryPool();
+
+    VeDevice &veDevice;
+    VkQueryPool queryPool = VK_NULL_HANDLE;
+    // Nanoseconds per tick.
+    double timestampPeriod = 0.0;
+    uint64_t timestampMask = 0;
+
+    std::vector<Frame> frames;
+    // Frame being recorded.
+    uint32_t current = 0;
+    bool started = false;
+    // Name of every reserved zone. Zone i has the queries
+    // 2i and 2i + 1 of every frame.
+    std::vector<uint32_t> reserved;
+
+    std::unordered_map<std::string, uint32_t> nameIndices;
+    std::vector<std::string> names;
+    std::vector<LatencyProbe> durations;
+    std::vector<uint64_t> results;
+    uint64_t framesRead = 0;
+};
+
+}  // namespace ve
@@ -0,0 +1,236 @@
+#include "VeHeadlessRenderer.hpp"
+
+#include <vulkan/vulkan_core.h>
+
+// lib
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+
+// std
+#include <algorithm>
+#include <array>
+#include <cstdio>
+#include <limits>
+#include <stdexcept>
+
+namespace ve {
+
+VeHeadlessRenderer::VeHeadlessRenderer(VkExtent2D extent)
+    : extent_{extent} {
+    // Same warm up as VeApp::loadFont.
+    for (char32_t c = ' '; c <= '~'; c++) {
+        veGlyphAtlas.glyph(c);
+    }
+
+    veUploadManager.submit();
+
+    std::array<glm::vec4, VeTextRenderer::PALETTE_SIZE>
+        palette;
+    palette.fill({0.85f, 0.85f, 0.85f, 1.0f});
+    veTextRenderer.setPalette(palette);
+    veTextRenderer.createPipeline(target.getRenderPass());
+
+    VkFenceCreateInfo fenceInfo{};
+    fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+
+    if (vkCreateFence(veDevice.device(), &fenceInfo,
+                      nullptr, &frameFence) != VK_SUCCESS) {
+        throw std::runtime_error(
+            "failed to create headless frame fence");
+    }
+}
+
+VeHeadlessRenderer::~VeHeadlessRenderer() {
+    vkDeviceWaitIdle(veDevice.device());
+    vkDestroyFence(veDevice.device(), frameFence, nullptr);
+}
+
+size_t VeHeadlessRenderer::visibleLines() const {
+    return std::max<size_t>(
+        extent_.height / veFont.lineHeight(), 1);
+}
+
+size_t VeHeadlessRenderer::render(
+    const std::vector<std::string> &lines, bool readback) {
+    // The previous render waited for its fence, so the
+    // ring and the command pool are free.
+    frameData.beginFrame(0);
+    layoutText(lines);
+    veUploadManager.submit();
+
+    VkCommandBuffer commandBuffer =
+        frameContext.beginFrame(0);
+    recordFrame(commandBuffer, readback);
+    submit(commandBuffer);
+
+    return veTextRenderer.instanceCount();
+}
+
+void VeHeadlessRenderer::layoutText(
+    const std::vector<std::string> &lines) {
+    float width = static_cast<float>(extent_.width);
+    float height = static_cast<float>(extent_.height);
+    float lineHeight =
+        static_cast<float>(veFont.lineHeight());
+    float ascender = static_cast<float>(veFont.ascender());
+
+    // See VeApp::layoutText.
+    for (int attempt = 0; attempt < 2; attempt++) {
+        uint32_t generation = veGlyphAtlas.generation();
+        veTextRenderer.clear();
+
+        float y = ascender;
+
+        for (size_t line = 0;
+             line < lines.size() && y - ascender < height;
+             line++) {
+            veTextRenderer.addText(0.0f, y, lines[line], 0,
+                                   width);
+            y += lineHeight;
+        }
+
+        if (veGlyphAtlas.generation() == generation) {
+            break;
+        }
+    }
+}
+
+void VeHeadlessRenderer::recordFrame(
+    VkCommandBuffer commandBuffer, bool readback) {
+    VkCommandBufferBeginInfo beginInfo{};
+    beginInfo.sType =
+        VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags =
+        VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+    if (vkBeginCommandBuffer(commandBuffer, &beginInfo) !=
+        VK_SUCCESS) {
+        throw std::runtime_error(
+            "failed to start recording command buffer");
+    }
+
+    VkRenderPassBeginInfo renderPassInfo{};
+    renderPassInfo.sType =
+        VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+    renderPassInfo.renderPass = target.getRenderPass();
+    renderPassInfo.framebuffer = target.getFrameBuffer();
+    renderPassInfo.renderArea.offset = {0, 0};
+    renderPassInfo.renderArea.extent = extent_;
+
+    // VeApp's background.
+    std::array<VkClearValue, 2> clearValues{};
+    clearValues[0].color = {0.1f, 0.1f, 0.1f, 1.0f};
+    clearValues[1].depthStencil = {1.0f, 0};
+    renderPassInfo.clearValueCount =
+        static_cast<uint32_t>(clearValues.size());
+    renderPassInfo.pClearValues = clearValues.data();
+
+    vkCmdBeginRenderPass(commandBuffer, &renderPassInfo,
+                         VK_SUBPASS_CONTENTS_INLINE);
+
+    VkViewport viewport{};
+    viewport.x = 0.0f;
+    viewport.y = 0.0f;
+    viewport.width = static_cast<float>(extent_.width);
+    viewport.height = static_cast<float>(extent_.height);
+    viewport.minDepth = 0.0f;
+    viewport.maxDepth = 1.0f;
+    vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+
+    VkRect2D scissor{{0, 0}, extent_};
+    vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+
+    veTextRenderer.render(commandBuffer, frameData,
+                          extent_);
+
+    vkCmdEndRenderPass(commandBuffer);
+
+    if (readback) {
+        target.recordReadback(commandBuffer);
+    }
+
+    if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS) {
+        throw std::runtime_error(
+            "failed to record command buffer");
+    }
+}
+
+void VeHeadlessRenderer::submit(
+    VkCommandBuffer commandBuffer) {
+    // Waits for the glyphs uploaded for this frame, like
+    // VeSwapChain::submitCommandBuffers.
+    FrameSync sync = veUploadManager.frameSync();
+
+    uint32_t waitCount =
+        sync.waitSemaphore != VK_NULL_HANDLE ? 1 : 0;
+    uint32_t signalCount =
+        sync.signalSemaphore != VK_NULL_HANDLE ? 1 : 0;
+
+    VkTimelineSemaphoreSubmitInfo timelineInfo{};
+    timelineInfo.sType =
+        VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+    timelineInfo.waitSemaphoreValueCount = waitCount;
+    timelineInfo.pWaitSemaphoreValues = &sync.waitValue;
+    timelineInfo.signalSemaphoreValueCount = signalCount;
+    timelineInfo.pSignalSemaphoreValues = &sync.signalValue;
+
+    VkSubmitInfo submitInfo{};
+    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    // Without timeline semaphores the frame has none.
+    if (waitCount + signalCount > 0) {
+        submitInfo.pNext = &timelineInfo;
+    }
+    submitInfo.waitSemaphoreCount = waitCount;
+    submitInfo.pWaitSemaphores = &sync.waitSemaphore;
+    submitInfo.pWaitDstStageMask = &sync.waitStages;
+    submitInfo.commandBufferCount = 1;
+    submitInfo.pCommandBuffers = &commandBuffer;
+    submitInfo.signalSemaphoreCount = signalCount;
+    submitInfo.pSignalSemaphores = &sync.signalSemaphore;
+
+    if (vkQueueSubmit(veDevice.graphicsQueue(), 1,
+                      &submitInfo,
+                      frameFence) != VK_SUCCESS) {
+        throw std::runtime_error(
+            "failed to submit headless frame");
+    }
+
+    vkWaitForFences(veDevice.device(), 1, &frameFence,
+                    VK_TRUE,
+                    std::numeric_limits<uint64_t>::max());
+    vkResetFences(veDevice.device(), 1, &frameFence);
+}
+
+void VeHeadlessRenderer::savePpm(
+    const std::string &path) const {
+    FILE *file = fopen(path.c_str(), "wb");
+
+    if (file == nullptr) {
+        throw std::runtime_error("failed to open " + path);
+    }
+
+    fprintf(file, "P6\n%u %u\n255\n", extent_.width,
+            extent_.height);
+
+    // PPM has no alpha, it is always 1 anyway.
+    const uint8_t *pixel = pixels();
+    size_t count = size_t{extent_.width} * extent_.height;
+    std::vector<uint8_t> rgb(count * 3);
+
+    for (size_t i = 0; i < count; i++) {
+        rgb[i * 3 + 0] = pixel[i * 4 + 0];
+        rgb[i * 3 + 1] = pixel[i * 4 + 1];
+        rgb[i * 3 + 2] = pixel[i * 4 + 2];
+    }
+
+    bool written =
+        fwrite(rgb.data(), 1, rgb.size(), file) ==
+        rgb.size();
+
+    if (fclose(file) != 0 || !written) {
+        throw std::runtime_error("failed to write " + path);
+    }
+}
+
+}  // namespace ve
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <vulkan/vulkan_core.h>
+
+#include "VeDevice.hpp"
+#include "VeFont.hpp"
+#include "VeFrameContext.hpp"
+#include "VeGlyphAtlas.hpp"
+#include "VeOffscreenTarget.hpp"
+#include "VeRingBuffer.hpp"
+#include "VeTextRenderer.hpp"
+#include "VeUploadManager.hpp"
+
+// std
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace ve {
+
+// Draws text into a VeOffscreenTarget on a headless
+// device, for benchmarks and golden image tests that have
+// no window or display, e.g. on lavapipe in CI.
+//
+// Text is laid out and drawn like VeApp does, with the same
+// font size and palette, but there is only ever one frame
+// and every render waits for the GPU to finish it.
+class VeHeadlessRenderer {
+   public:
+    static constexpr uint32_t FONT_SIZE = 18;
+    static constexpr VkDeviceSize FRAME_DATA_SIZE = 1 << 20;
+
+    // The font is VeFont::defaultPath(), set $EDITOR_FONT
+    // to get the same pixels on every machine.
+    explicit VeHeadlessRenderer(VkExtent2D extent);
+    ~VeHeadlessRenderer();
+
+    VeHeadlessRenderer(const VeHeadlessRenderer &) = delete;
+    VeHeadlessRenderer &operator=(
+        const VeHeadlessRenderer &) = delete;
+
+    // Lines that fit on the target.
+    size_t visibleLines() const;
+
+    // Draws lines from the top left corner and waits for
+    // the frame. Without readback pixels() keeps the
+    // previous image. Returns the number of glyphs drawn.
+    size_t render(const std::vector<std::string> &lines,
+                  bool readback = true);
+
+    VkExtent2D extent() const {
+        return extent_;
+    }
+    // See VeOffscreenTarget::pixels.
+    const uint8_t *pixels() const {
+        return target.pixels();
+    }
+
+    // Writes the last readback as a binary PPM, throws if
+    // the file can't be written.
+    void savePpm(const std::string &path) const;
+
+   private:
+    void layoutText(const std::vector<std::string> &lines);
+    void recordFrame(VkCommandBuffer commandBuffer,
+                     bool readback);
+    void submit(VkCommandBuffer commandBuffer);
+
+    VkExtent2D extent_;
+    VeDevice veDevice;
+    // Declared before everything it uploads to, so it is
+    // destroyed after them.
+    VeUploadManager veUploadManager{veDevice};
+    VeFrameContext frameContext{veDevice, 1};
+    VeOffscreenTarget target{veDevice, extent_};
+    VeFont veFont{VeFont::defaultPath(), FONT_SIZE};
+    VeGlyphAtlas veGlyphAtlas{veDevice, veUploadManager,
+                              veFont};
+    VeTextRenderer veTextRenderer{veDevice, veGlyphAtlas};
+    VeRingBuffer frameData{
+        veDevice, FRAME_DATA_SIZE,
+        VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, 1};
+    VkFence frameFence;
+};
+
+}  // namespace ve
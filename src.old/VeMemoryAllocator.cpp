@@ -0,0 +1,458 @@
+#include "VeMemoryAllocator.hpp"
+
+#include <vulkan/vulkan_core.h>
+
+// std
+#include <algorithm>
+#include <map>
+#include <stdexcept>
+#include <utility>
+
+namespace ve {
+
+struct VeMemoryBlock {
+    VkDeviceMemory memory = VK_NULL_HANDLE;
+    VkDeviceSize size = 0;
+    uint8_t *mapped = nullptr;
+    uint32_t pool = 0;
+    // Holds a single allocation and is freed with it.
+    bool dedicated = false;
+    VkDeviceSize used = 0;
+
+    // Free ranges, offset to size and size to offset.
+    // Neighbouring free ranges are always merged.
+    std::map<VkDeviceSize, VkDeviceSize> freeByOffset;
+    std::multimap<VkDeviceSize, VkDeviceSize> freeBySize;
+    // Allocations, offset to size and alignment, walked by
+    // defragment.
+    std::map<VkDeviceSize,
+             std::pair<VkDeviceSize, VkDeviceSize>>
+        live;
+};
+
+namespace {
+
+void insertFree(VeMemoryBlock &block, VkDeviceSize offset,
+                VkDeviceSize size) {
+    block.freeByOffset.emplace(offset, size);
+    block.freeBySize.emplace(size, offset);
+}
+
+void eraseFree(VeMemoryBlock &block, VkDeviceSize offset,
+               VkDeviceSize size) {
+    block.freeByOffset.erase(offset);
+
+    auto range = block.freeBySize.equal_range(size);
+
+    for (auto it = range.first; it != range.second; ++it) {
+        if (it->second == offset) {
+            block.freeBySize.erase(it);
+            break;
+        }
+    }
+}
+
+// Returns a range to the block, merging it with the free
+// ranges right before and after it.
+void releaseRange(VeMemoryBlock &block, VkDeviceSize offset,
+                  VkDeviceSize size) {
+    auto next = block.freeByOffset.lower_bound(offset);
+
+    if (next != block.freeByOffset.end() &&
+        next->first == offset + size) {
+        VkDeviceSize nextSize = next->second;
+        eraseFree(block, next->first, nextSize);
+        size += nextSize;
+        next = block.freeByOffset.lower_bound(offset);
+    }
+
+    if (next != block.freeByOffset.begin()) {
+        auto previous = std::prev(next);
+
+        if (previous->first + previous->second == offset) {
+            VkDeviceSize previousOffset = previous->first;
+            VkDeviceSize previousSize = previous->second;
+            eraseFree(block, previousOffset, previousSize);
+            offset = previousOffset;
+            size += previousSize;
+        }
+    }
+
+    insertFree(block, offset, size);
+}
+
+// Takes the smallest free range that fits size bytes at
+// the given alignment, putting what is left on either side
+// back.
+bool takeRange(VeMemoryBlock &block, VkDeviceSize size,
+               VkDeviceSize alignment,
+               VkDeviceSize &offset) {
+    for (auto it = block.freeBySize.lower_bound(size);
+         it != block.freeBySize.end(); ++it) {
+        VkDeviceSize rangeOffset = it->second;
+        VkDeviceSize rangeEnd = rangeOffset + it->first;
+        VkDeviceSize aligned =
+            (rangeOffset + alignment - 1) / alignment *
+            alignment;
+
+        if (aligned + size > rangeEnd) {
+            continue;
+        }
+
+        eraseFree(block, rangeOffset, it->first);
+
+        if (aligned > rangeOffset) {
+            insertFree(block, rangeOffset,
+                       aligned - rangeOffset);
+        }
+
+        if (aligned + size < rangeEnd) {
+            insertFree(block, aligned + size,
+                       rangeEnd - aligned - size);
+        }
+
+        offset = aligned;
+        return true;
+    }
+
+    return false;
+}
+
+}  // namespace
+
+VeMemoryAllocator::VeMemoryAllocator(
+    VkDevice device, VkPhysicalDevice physicalDevice)
+    : device{device} {
+    vkGetPhysicalDeviceMemoryProperties(physicalDevice,
+                                        &memoryProperties);
+
+    pools.resize(memoryProperties.memoryTypeCount * 2);
+
+    for (uint32_t i = 0;
+         i < memoryProperties.memoryTypeCount; i++) {
+        // Small heaps, like the 256 MiB device local and
+        // host visible one of many GPUs, get smaller
+        // blocks so one block can't take most of it.
+        VkDeviceSize heapSize =
+            memoryProperties
+                .memoryHeaps[memoryProperties.memoryTypes[i]
+                                 .heapIndex]
+                .size;
+        VkDeviceSize blockSize =
+            std::min(BLOCK_SIZE, heapSize / 8);
+
+        for (uint32_t tiling = 0; tiling < 2; tiling++) {
+            pools[i * 2 + tiling].memoryType = i;
+            pools[i * 2 + tiling].blockSize = blockSize;
+        }
+    }
+}
+
+VeMemoryAllocator::~VeMemoryAllocator() {
+    for (auto &pool : pools) {
+        while (!pool.blocks.empty()) {
+            destroyBlock(pool, pool.blocks.back().get());
+        }
+    }
+}
+
+VeAllocation VeMemoryAllocator::allocate(
+    const VkMemoryRequirements &requirements,
+    VkMemoryPropertyFlags properties, bool linear) {
+    uint32_t memoryType = findMemoryType(
+        requirements.memoryTypeBits, properties);
+    Pool &pool = pools[memoryType * 2 + (linear ? 0 : 1)];
+    VeAllocation allocation;
+
+    if (requirements.size > pool.blockSize / 2) {
+        VeMemoryBlock &block =
+            createBlock(pool, requirements.size, true);
+
+        block.used = requirements.size;
+        block.live[0] = {requirements.size,
+                         requirements.alignment};
+        pool.stats.usedBytes += requirements.size;
+        pool.stats.allocationCount++;
+
+        allocation.memory = block.memory;
+        allocation.size = requirements.size;
+        allocation.mapped = block.mapped;
+        allocation.memoryType = memoryType;
+        allocation.block = &block;
+        return allocation;
+    }
+
+    if (!allocateFromBlocks(pool, requirements.size,
+                            requirements.alignment, nullptr,
+                            allocation)) {
+        createBlock(pool, pool.blockSize, false);
+
+        if (!allocateFromBlocks(pool, requirements.size,
+                                requirements.alignment,
+                                nullptr, allocation)) {
+            throw std::runtime_error(
+                "failed to allocate from new memory block");
+        }
+    }
+
+    return allocation;
+}
+
+void VeMemoryAllocator::free(VeAllocation &allocation) {
+    VeMemoryBlock *block = allocation.block;
+
+    if (block == nullptr) {
+        return;
+    }
+
+    Pool &pool = pools[block->pool];
+    VkDeviceSize offset = allocation.offset;
+    VkDeviceSize size = allocation.size;
+    allocation = {};
+
+    block->live.erase(offset);
+    block->used -= size;
+    pool.stats.usedBytes -= size;
+    pool.stats.allocationCount--;
+
+    if (block->dedicated) {
+        destroyBlock(pool, block);
+        return;
+    }
+
+    releaseRange(*block, offset, size);
+
+    // Keep one empty block per pool around, so a resource
+    // that is repeatedly created and destroyed doesn't
+    // allocate device memory every time.
+    if (block->used == 0 &&
+        std::any_of(pool.blocks.begin(), pool.blocks.end(),
+                    [&](const auto &other) {
+                        return other.get() != block &&
+                               !other->dedicated;
+                    })) {
+        destroyBlock(pool, block);
+    }
+}
+
+VkDeviceSize VeMemoryAllocator::defragment(
+    const MoveFunction &move, VkDeviceSize maxBytes) {
+    VkDeviceSize moved = 0;
+
+    for (auto &pool : pools) {
+        VeMemoryBlock *source = nullptr;
+        uint32_t blockCount = 0;
+
+        for (auto &block : pool.blocks) {
+            if (block->dedicated) {
+                continue;
+            }
+
+            blockCount++;
+
+            if (source == nullptr ||
+                block->used < source->used) {
+                source = block.get();
+            }
+        }
+
+        if (blockCount < 2) {
+            continue;
+        }
+
+        // Freeing the last allocation of source destroys
+        // it, so don't walk its map.
+        std::vector<std::pair<
+            VkDeviceSize,
+            std::pair<VkDeviceSize, VkDeviceSize>>>
+            live(source->live.begin(), source->live.end());
+
+        for (const auto &[offset, range] : live) {
+            const auto &[size, alignment] = range;
+
+            if (moved + size > maxBytes) {
+                return moved;
+            }
+
+            VeAllocation from;
+            from.memory = source->memory;
+            from.offset = offset;
+            from.size = size;
+            from.mapped = source->mapped != nullptr
+                              ? source->mapped + offset
+                              : nullptr;
+            from.memoryType = pool.memoryType;
+            from.block = source;
+
+            VeAllocation to;
+
+            if (!allocateFromBlocks(pool, size, alignment,
+                                    source, to)) {
+                break;
+            }
+
+            if (!move(from, to)) {
+                free(to);
+                break;
+            }
+
+            free(from);
+            moved += size;
+        }
+    }
+
+    return moved;
+}
+
+VeMemoryAllocator::Stats VeMemoryAllocator::stats() const {
+    Stats total;
+
+    for (const auto &pool : pools) {
+        total.usedBytes += pool.stats.usedBytes;
+        total.reservedBytes += pool.stats.reservedBytes;
+        total.allocationCount += pool.stats.allocationCount;
+        total.blockCount += pool.stats.blockCount;
+        total.dedicatedCount += pool.stats.dedicatedCount;
+    }
+
+    return total;
+}
+
+VeMemoryAllocator::Stats VeMemoryAllocator::stats(
+    uint32_t memoryType) const {
+    Stats total = pools[memoryType * 2].stats;
+    const Stats &optimal = pools[memoryType * 2 + 1].stats;
+
+    total.usedBytes += optimal.usedBytes;
+    total.reservedBytes += optimal.reservedBytes;
+    total.allocationCount += optimal.allocationCount;
+    total.blockCount += optimal.blockCount;
+    total.dedicatedCount += optimal.dedicatedCount;
+
+    return total;
+}
+
+uint32_t VeMemoryAllocator::findMemoryType(
+    uint32_t typeFilter,
+    VkMemoryPropertyFlags properties) const {
+    for (uint32_t i = 0;
+         i < memoryProperties.memoryTypeCount; i++) {
+        if ((typeFilter & (1 << i)) &&
+            (memoryProperties.memoryTypes[i].propertyFlags &
+             properties) == properties) {
+            return i;
+        }
+    }
+
+    throw std::runtime_error(
+        "failed to find suitable memory type!");
+}
+
+bool VeMemoryAllocator::allocateFromBlocks(
+    Pool &pool, VkDeviceSize size, VkDeviceSize alignment,
+    const VeMemoryBlock *exclude,
+    VeAllocation &allocation) {
+    for (auto &block : pool.blocks) {
+        VkDeviceSize offset;
+
+        if (block->dedicated || block.get() == exclude ||
+            block->size - block->used < size ||
+            !takeRange(*block, size, alignment, offset)) {
+            continue;
+        }
+
+        block->used += size;
+        block->live[offset] = {size, alignment};
+        pool.stats.usedBytes += size;
+        pool.stats.allocationCount++;
+
+        allocation.memory = block->memory;
+        allocation.offset = offset;
+        allocation.size = size;
+        allocation.mapped = block->mapped != nullptr
+                                ? block->mapped + offset
+                                : nullptr;
+        allocation.memoryType = pool.memoryType;
+        allocation.block = block.get();
+        return true;
+    }
+
+    return false;
+}
+
+VeMemoryBlock &VeMemoryAllocator::createBlock(
+    Pool &pool, VkDeviceSize size, bool dedicated) {
+    auto block = std::make_unique<VeMemoryBlock>();
+    block->size = size;
+    block->pool =
+        static_cast<uint32_t>(&pool - pools.data());
+    block->dedicated = dedicated;
+
+    VkMemoryAllocateInfo allocInfo{};
+    allocInfo.sType =
+        VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    allocInfo.allocationSize = size;
+    allocInfo.memoryTypeIndex = pool.memoryType;
+
+    if (vkAllocateMemory(device, &allocInfo, nullptr,
+                         &block->memory) != VK_SUCCESS) {
+        throw std::runtime_error(
+            "failed to allocate device memory block!");
+    }
+
+    if (memoryProperties.memoryTypes[pool.memoryType]
+            .propertyFlags &
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) {
+        void *data;
+
+        if (vkMapMemory(device, block->memory, 0,
+                        VK_WHOLE_SIZE, 0,
+                        &data) != VK_SUCCESS) {
+            vkFreeMemory(device, block->memory, nullptr);
+            throw std::runtime_error(
+                "failed to map device memory block!");
+        }
+
+        block->mapped = static_cast<uint8_t *>(data);
+    }
+
+    if (!dedicated) {
+        insertFree(*block, 0, size);
+    }
+
+    pool.stats.reservedBytes += size;
+
+    if (dedicated) {
+        pool.stats.dedicatedCount++;
+    } else {
+        pool.stats.blockCount++;
+    }
+
+    pool.blocks.push_back(std::move(block));
+    return *pool.blocks.back();
+}
+
+void VeMemoryAllocator::destroyBlock(Pool &pool,
+                                     VeMemoryBlock *block) {
+    if (block->mapped != nullptr) {
+        vkUnmapMemory(device, block->memory);
+    }
+
+    vkFreeMemory(device, block->memory, nullptr);
+
+    pool.stats.reservedBytes -= block->size;
+
+    if (block->dedicated) {
+        pool.stats.dedicatedCount--;
+    } else {
+        pool.stats.blockCount--;
+    }
+
+    pool.blocks.erase(std::find_if(
+        pool.blocks.begin(), pool.blocks.end(),
+        [&](const auto &other) {
+            return other.get() == block;
+        }));
+}
+
+}  // namespace ve
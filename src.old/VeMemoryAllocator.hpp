@@ -0,0 +1,121 @@
+#pragma once
+
+#include <vulkan/vulkan_core.h>
+
+// std
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+
+namespace ve {
+
+struct VeMemoryBlock;
+
+// A range of device memory handed out by VeMemoryAllocator.
+// Resources are bound at memory + offset.
+struct VeAllocation {
+    VkDeviceMemory memory = VK_NULL_HANDLE;
+    VkDeviceSize offset = 0;
+    VkDeviceSize size = 0;
+    // Start of the range for host visible memory, which
+    // stays mapped for its whole lifetime, nullptr
+    // otherwise.
+    void *mapped = nullptr;
+    uint32_t memoryType = 0;
+    // Block the range was carved from.
+    VeMemoryBlock *block = nullptr;
+};
+
+// Sub-allocates device memory out of large blocks.
+//
+// Every memory type gets its own blocks, kept apart for
+// linear (buffers) and optimal tiling (images) resources
+// so bufferImageGranularity never has to be considered.
+// Free ranges of a block are indexed by offset, to merge
+// neighbours on free, and by size, to find the smallest
+// range that fits in logarithmic time. Allocations bigger
+// than half a block get a VkDeviceMemory of their own.
+// Host visible blocks are mapped once when created.
+//
+// Not thread safe.
+class VeMemoryAllocator {
+   public:
+    static constexpr VkDeviceSize BLOCK_SIZE = 64 << 20;
+
+    struct Stats {
+        // Bytes handed out, without alignment padding.
+        VkDeviceSize usedBytes = 0;
+        // Bytes allocated from the driver.
+        VkDeviceSize reservedBytes = 0;
+        uint32_t allocationCount = 0;
+        uint32_t blockCount = 0;
+        uint32_t dedicatedCount = 0;
+    };
+
+    // Called by defragment to move a resource. Has to copy
+    // the contents from one range to the other and bind the
+    // resource's replacement to the new range, returning
+    // false if the resource can't be moved.
+    using MoveFunction = std::function<bool(
+        const VeAllocation &from, const VeAllocation &to)>;
+
+    VeMemoryAllocator(VkDevice device,
+                      VkPhysicalDevice physicalDevice);
+    ~VeMemoryAllocator();
+
+    VeMemoryAllocator(const VeMemoryAllocator &) = delete;
+    VeMemoryAllocator &operator=(
+        const VeMemoryAllocator &) = delete;
+
+    // linear is true for buffers and linear tiling images.
+    VeAllocation allocate(
+        const VkMemoryRequirements &requirements,
+        VkMemoryPropertyFlags properties, bool linear);
+    void free(VeAllocation &allocation);
+
+    // Empties the least used block of every memory type
+    // that has more than one into the others, moving up to
+    // maxBytes, and releases the blocks left empty. Nothing
+    // in the moved ranges may be in use by the GPU. Returns
+    // the bytes moved.
+    VkDeviceSize defragment(const MoveFunction &move,
+                            VkDeviceSize maxBytes);
+
+    Stats stats() const;
+    Stats stats(uint32_t memoryType) const;
+
+   private:
+    // Blocks sharing a memory type and tiling, dedicated
+    // allocations included.
+    struct Pool {
+        uint32_t memoryType = 0;
+        VkDeviceSize blockSize = 0;
+        std::vector<std::unique_ptr<VeMemoryBlock>> blocks;
+        Stats stats;
+    };
+
+    uint32_t findMemoryType(
+        uint32_t typeFilter,
+        VkMemoryPropertyFlags properties) const;
+
+    // Allocates from the pool's existing blocks, skipping
+    // exclude.
+    bool allocateFromBlocks(Pool &pool, VkDeviceSize size,
+                            VkDeviceSize alignment,
+                            const VeMemoryBlock *exclude,
+                            VeAllocation &allocation);
+    VeMemoryBlock &createBlock(Pool &pool,
+                               VkDeviceSize size,
+                               bool dedicated);
+    void destroyBlock(Pool &pool, VeMemoryBlock *block);
+
+    VkDevice device;
+    VkPhysicalDeviceMemoryProperties memoryProperties;
+
+    // Linear and optimal tiling pool of memory type i are
+    // at 2 * i and 2 * i + 1.
+    std::vector<Pool> pools;
+};
+
+}  // namespace ve
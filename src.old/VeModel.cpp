@@ -9,37 +9,29 @@
 namespace ve {
 
 VeModel::VeModel(VeDevice& device,
+                 VeUploadManager& uploader,
                  const std::vector<Vertex>& vertices)
     : veDevice{device} {
-    createVertexBuffers(vertices);
+    createVertexBuffers(uploader, vertices);
 }
 
 VeModel::~VeModel() {
     vkDestroyBuffer(veDevice.device(), vertexBuffer,
                     nullptr);
-    vkFreeMemory(veDevice.device(), vertexBufferMemory,
-                 nullptr);
+    veDevice.freeMemory(vertexBufferMemory);
 }
 
 void VeModel::createVertexBuffers(
+    VeUploadManager& uploader,
     const std::vector<Vertex>& vertices) {
     vertexCount = static_cast<uint32_t>(vertices.size());
     assert(vertexCount >= 3 &&
            "vertex count must be at least 3");
     VkDeviceSize bufferSize = sizeof(Vertex) * vertexCount;
-    veDevice.createBuffer(
-        bufferSize, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
-        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
-            VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-        vertexBuffer, vertexBufferMemory);
-
-    void* data;
-
-    vkMapMemory(veDevice.device(), vertexBufferMemory, 0,
-                bufferSize, 0, &data);
-    memcpy(data, vertices.data(),
-           static_cast<size_t>(bufferSize));
-    vkUnmapMemory(veDevice.device(), vertexBufferMemory);
+    uploader.createBuffer(
+        vertices.data(), bufferSize,
+        VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, vertexBuffer,
+        vertexBufferMemory);
 }
 
 void VeModel::draw(VkCommandBuffer commandBuffer) {
@@ -3,6 +3,7 @@
 #include <vulkan/vulkan_core.h>
 
 #include "VeDevice.hpp"
+#include "VeUploadManager.hpp"
 
 // libs
 #define GLM_FORCE_RADIANS
@@ -27,7 +28,9 @@ class VeModel {
         getAttributeDescriptions();
     };
 
-    VeModel(VeDevice& device,
+    // The vertices live in device local memory, filled by
+    // the uploader's next batch.
+    VeModel(VeDevice& device, VeUploadManager& uploader,
             const std::vector<Vertex>& vertices);
     ~VeModel();
 
@@ -39,11 +42,12 @@ class VeModel {
 
    private:
     void createVertexBuffers(
+        VeUploadManager& uploader,
         const std::vector<Vertex>& vertices);
 
     VeDevice& veDevice;
     VkBuffer vertexBuffer;
-    VkDeviceMemory vertexBufferMemory;
+    VeAllocation vertexBufferMemory;
     uint32_t vertexCount;
 };
 
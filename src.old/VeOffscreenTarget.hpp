@@ -0,0 +1,83 @@
+#pragma once
+
+#include <vulkan/vulkan_core.h>
+
+#include "VeDevice.hpp"
+
+// std
+#include <cstdint>
+
+namespace ve {
+
+// A color and a depth image to render into instead of a
+// swap chain, with a host visible buffer to read the color
+// image back.
+//
+// The render pass matches the swap chain's apart from the
+// color format and final layout, so the same pipelines
+// work in both.
+class VeOffscreenTarget {
+   public:
+    // sRGB like the swap chain prefers, so pixels come back
+    // as they would be shown. Bytes are R, G, B, A.
+    static constexpr VkFormat COLOR_FORMAT =
+        VK_FORMAT_R8G8B8A8_SRGB;
+
+    VeOffscreenTarget(VeDevice &device, VkExtent2D extent);
+    ~VeOffscreenTarget();
+
+    VeOffscreenTarget(const VeOffscreenTarget &) = delete;
+    VeOffscreenTarget &operator=(
+        const VeOffscreenTarget &) = delete;
+
+    VkRenderPass getRenderPass() {
+        return renderPass;
+    }
+    VkFramebuffer getFrameBuffer() {
+        return framebuffer;
+    }
+    VkExtent2D getExtent() {
+        return extent;
+    }
+
+    // Records the copy of the color image into the readback
+    // buffer, after the render pass.
+    void recordReadback(VkCommandBuffer commandBuffer);
+
+    // Rows of width * 4 bytes, top to bottom, as of the
+    // last finished readback.
+    const uint8_t *pixels() const {
+        return static_cast<const uint8_t *>(
+            readbackMemory.mapped);
+    }
+    VkDeviceSize pixelsSize() const {
+        return VkDeviceSize{extent.width} *
+               extent.height * 4;
+    }
+
+   private:
+    void createImages();
+    void createRenderPass();
+    void createFramebuffer();
+    VkImageView createView(VkImage image, VkFormat format,
+                           VkImageAspectFlags aspect);
+
+    VeDevice &veDevice;
+    VkExtent2D extent;
+    VkFormat depthFormat;
+
+    VkImage colorImage;
+    VeAllocation colorMemory;
+    VkImageView colorView;
+    VkImage depthImage;
+    VeAllocation depthMemory;
+    VkImageView depthView;
+
+    VkRenderPass renderPass;
+    VkFramebuffer framebuffer;
+
+    VkBuffer readbackBuffer;
+    VeAllocation readbackMemory;
+};
+
+}  // namespace ve
@@ -91,10 +91,10 @@ void VePipeline::createGraphicsPipeline(
     shaderStages[1].pNext = nullptr;
     shaderStages[1].pSpecializationInfo = nullptr;
 
-    auto attributeDescriptions =
-        VeModel::Vertex::getAttributeDescriptions();
-    auto bindingDescriptions =
-        VeModel::Vertex::getBindingDescriptions();
+    auto& attributeDescriptions =
+        configInfo.attributeDescriptions;
+    auto& bindingDescriptions =
+        configInfo.bindingDescriptions;
 
     VkPipelineVertexInputStateCreateInfo vertexInputInfo{};
     vertexInputInfo.sType =
@@ -136,7 +136,8 @@ void VePipeline::createGraphicsPipeline(
     pipelineInfo.basePipelineIndex = -1;
 
     if (vkCreateGraphicsPipelines(
-            veDevice.device(), VK_NULL_HANDLE, 1,
+            veDevice.device(),
+            veDevice.pipelineCache().handle(), 1,
             &pipelineInfo, nullptr,
             &graphicsPipeline) != VK_SUCCESS) {
         throw std::runtime_error(
@@ -146,6 +147,11 @@ void VePipeline::createGraphicsPipeline(
 
 void VePipeline::defaultPipelineConfigInfo(
     PipelineConfigInfo& configInfo) {
+    configInfo.bindingDescriptions =
+        VeModel::Vertex::getBindingDescriptions();
+    configInfo.attributeDescriptions =
+        VeModel::Vertex::getAttributeDescriptions();
+
     configInfo.inputAssemblyInfo.sType =
         VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
     configInfo.inputAssemblyInfo.topology =
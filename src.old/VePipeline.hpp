@@ -16,6 +16,10 @@ struct PipelineConfigInfo {
     PipelineConfigInfo& operator=(
         const PipelineConfigInfo&) = delete;
 
+    std::vector<VkVertexInputBindingDescription>
+        bindingDescriptions{};
+    std::vector<VkVertexInputAttributeDescription>
+        attributeDescriptions{};
     VkPipelineViewportStateCreateInfo viewportInfo;
     VkPipelineInputAssemblyStateCreateInfo
         inputAssemblyInfo;
@@ -0,0 +1,234 @@
+#include "VePipelineCache.hpp"
+
+#include <vulkan/vulkan_core.h>
+
+// c std
+#include <sys/stat.h>
+
+// std
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <utility>
+
+namespace ve {
+
+namespace {
+
+// Anything larger is a damaged header, not a cache.
+constexpr uint64_t kMaxDataSize = 256 << 20;
+
+uint64_t fnv1a(const std::string &data) {
+    uint64_t hash = 0xcbf29ce484222325;
+
+    for (unsigned char c : data) {
+        hash = (hash ^ c) * 0x100000001b3;
+    }
+
+    return hash;
+}
+
+// Creates the directories leading up to path.
+bool createParentDirectories(const std::string &path) {
+    for (size_t slash = path.find('/', 1);
+         slash != std::string::npos;
+         slash = path.find('/', slash + 1)) {
+        std::string directory = path.substr(0, slash);
+
+        if (mkdir(directory.c_str(), 0755) == -1 &&
+            errno != EEXIST) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+}  // namespace
+
+VePipelineCache::VePipelineCache(
+    VkDevice device,
+    const VkPhysicalDeviceProperties &properties,
+    std::string path)
+    : device{device},
+      properties{properties},
+      path{std::move(path)} {
+    std::string data = load();
+
+    VkPipelineCacheCreateInfo cacheInfo{};
+    cacheInfo.sType =
+        VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+    cacheInfo.initialDataSize = data.size();
+    cacheInfo.pInitialData = data.data();
+
+    VkResult result = vkCreatePipelineCache(
+        device, &cacheInfo, nullptr, &pipelineCache);
+
+    // The driver has the final say on the data, start
+    // empty if it won't take it.
+    if (result != VK_SUCCESS && !data.empty()) {
+        data.clear();
+        cacheInfo.initialDataSize = 0;
+        cacheInfo.pInitialData = nullptr;
+        result = vkCreatePipelineCache(
+            device, &cacheInfo, nullptr, &pipelineCache);
+    }
+
+    if (result != VK_SUCCESS) {
+        throw std::runtime_error(
+            "failed to create pipeline cache!");
+    }
+
+    loadedSize_ = data.size();
+}
+
+VePipelineCache::~VePipelineCache() {
+    save();
+    vkDestroyPipelineCache(device, pipelineCache, nullptr);
+}
+
+std::string VePipelineCache::defaultPath() {
+    if (const char *cache =
+            getenv("EDITOR_PIPELINE_CACHE")) {
+        return cache;
+    }
+
+    std::string directory;
+
+    if (const char *xdg = getenv("XDG_CACHE_HOME");
+        xdg != nullptr && xdg[0] == '/') {
+        directory = xdg;
+    } else if (const char *home = getenv("HOME")) {
+#ifdef __APPLE__
+        directory = std::string{home} + "/Library/Caches";
+#else
+        directory = std::string{home} + "/.cache";
+#endif
+    } else {
+        return {};
+    }
+
+    return directory + "/editor/pipeline_cache.bin";
+}
+
+void VePipelineCache::save() {
+    if (path.empty()) {
+        return;
+    }
+
+    size_t size = 0;
+
+    if (vkGetPipelineCacheData(device, pipelineCache, &size,
+                               nullptr) != VK_SUCCESS) {
+        return;
+    }
+
+    std::string data(size, '\0');
+
+    if (vkGetPipelineCacheData(device, pipelineCache, &size,
+                               data.data()) != VK_SUCCESS) {
+        return;
+    }
+
+    data.resize(size);
+    Header fileHeader = header(data);
+
+    // Written next to the old file and renamed over it, so
+    // a crash can't leave half a cache behind.
+    std::string temporaryPath = path + ".tmp";
+
+    if (!createParentDirectories(path)) {
+        std::cerr << "failed to create directory for "
+                  << path << ": " << strerror(errno)
+                  << std::endl;
+        return;
+    }
+
+    {
+        std::ofstream file{temporaryPath,
+                           std::ios::binary |
+                               std::ios::trunc};
+        file.write(
+            reinterpret_cast<const char *>(&fileHeader),
+            sizeof(fileHeader));
+        file.write(
+            data.data(),
+            static_cast<std::streamsize>(data.size()));
+
+        if (!file) {
+            std::cerr << "failed to write " << temporaryPath
+                      << std::endl;
+            std::remove(temporaryPath.c_str());
+            return;
+        }
+    }
+
+    if (std::rename(temporaryPath.c_str(), path.c_str()) !=
+        0) {
+        std::cerr << "failed to replace " << path << ": "
+                  << strerror(errno) << std::endl;
+        std::remove(temporaryPath.c_str());
+    }
+}
+
+std::string VePipelineCache::load() const {
+    if (path.empty()) {
+        return {};
+    }
+
+    std::ifstream file{path, std::ios::binary};
+    Header fileHeader;
+
+    if (!file.read(reinterpret_cast<char *>(&fileHeader),
+                   sizeof(fileHeader))) {
+        return {};
+    }
+
+    Header expected = header({});
+
+    if (fileHeader.magic != expected.magic ||
+        fileHeader.version != expected.version ||
+        fileHeader.vendorID != expected.vendorID ||
+        fileHeader.deviceID != expected.deviceID ||
+        fileHeader.driverVersion !=
+            expected.driverVersion ||
+        memcmp(fileHeader.pipelineCacheUUID,
+               expected.pipelineCacheUUID,
+               VK_UUID_SIZE) != 0 ||
+        fileHeader.dataSize > kMaxDataSize) {
+        return {};
+    }
+
+    std::string data(fileHeader.dataSize, '\0');
+
+    if (!file.read(
+            data.data(),
+            static_cast<std::streamsize>(data.size())) ||
+        fnv1a(data) != fileHeader.checksum) {
+        return {};
+    }
+
+    return data;
+}
+
+VePipelineCache::Header VePipelineCache::header(
+    const std::string &data) const {
+    Header fileHeader{};
+    fileHeader.magic = MAGIC;
+    fileHeader.version = VERSION;
+    fileHeader.vendorID = properties.vendorID;
+    fileHeader.deviceID = properties.deviceID;
+    fileHeader.driverVersion = properties.driverVersion;
+    memcpy(fileHeader.pipelineCacheUUID,
+           properties.pipelineCacheUUID, VK_UUID_SIZE);
+    fileHeader.dataSize = data.size();
+    fileHeader.checksum = fnv1a(data);
+
+    return fileHeader;
+}
+
+}  // namespace ve
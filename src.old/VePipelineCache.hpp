@@ -0,0 +1,78 @@
+#pragma once
+
+#include <vulkan/vulkan_core.h>
+
+// std
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace ve {
+
+// VkPipelineCache kept on disk between runs.
+//
+// The file starts with a header of our own recording the
+// vendor, device, driver version and pipelineCacheUUID it
+// was written for and a checksum of the data. A cache from
+// another GPU or driver, or a damaged one, is ignored and
+// replaced on exit, so the worst case is a cold start.
+class VePipelineCache {
+   public:
+    // An empty path keeps the cache in memory only.
+    VePipelineCache(
+        VkDevice device,
+        const VkPhysicalDeviceProperties &properties,
+        std::string path);
+    // Saves the cache.
+    ~VePipelineCache();
+
+    VePipelineCache(const VePipelineCache &) = delete;
+    VePipelineCache &operator=(const VePipelineCache &) =
+        delete;
+
+    // $EDITOR_PIPELINE_CACHE, or pipeline_cache.bin in the
+    // user's cache directory. Empty if there is none.
+    static std::string defaultPath();
+
+    VkPipelineCache handle() const {
+        return pipelineCache;
+    }
+    // Bytes of cache data loaded from disk, 0 on a cold
+    // start.
+    size_t loadedSize() const {
+        return loadedSize_;
+    }
+
+    // Writes the cache to disk, replacing the old file
+    // atomically.
+    void save();
+
+   private:
+    struct Header {
+        uint32_t magic;
+        uint32_t version;
+        uint32_t vendorID;
+        uint32_t deviceID;
+        uint32_t driverVersion;
+        uint8_t pipelineCacheUUID[VK_UUID_SIZE];
+        uint64_t dataSize;
+        uint64_t checksum;
+    };
+
+    static constexpr uint32_t MAGIC = 0x43505645;  // "EVPC"
+    static constexpr uint32_t VERSION = 1;
+
+    // Returns the cache data in the file, empty if there
+    // is none or it doesn't match this device.
+    std::string load() const;
+    Header header(const std::string &data) const;
+
+    VkDevice device;
+    VkPhysicalDeviceProperties properties;
+    std::string path;
+
+    VkPipelineCache pipelineCache;
+    size_t loadedSize_ = 0;
+};
+
+}  // namespace ve
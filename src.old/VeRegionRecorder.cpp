@@ -0,0 +1,238 @@
+#include "VeRegionRecorder.hpp"
+
+#include <vulkan/vulkan_core.h>
+
+// std
+#include <algorithm>
+#include <cassert>
+#include <stdexcept>
+
+namespace ve {
+
+VeRegionRecorder::VeRegionRecorder(VeDevice &device,
+                                   uint32_t regionCount,
+                                   uint32_t frameCount)
+    : veDevice{device},
+      frameCount{frameCount},
+      drawn(regionCount, false) {
+    for (uint32_t i = 0; i < regionCount; i++) {
+        workers.push_back(std::make_unique<Worker>());
+        createWorker(*workers.back());
+    }
+
+    // Only started once nothing can throw any more.
+    for (auto &worker : workers) {
+        worker->thread =
+            std::thread(&VeRegionRecorder::run, this,
+                        std::ref(*worker));
+    }
+}
+
+VeRegionRecorder::~VeRegionRecorder() {
+    {
+        std::lock_guard<std::mutex> lock{mutex};
+        stopping = true;
+    }
+
+    for (auto &worker : workers) {
+        worker->wake.notify_one();
+        worker->thread.join();
+        // Frees its command buffers too.
+        vkDestroyCommandPool(veDevice.device(),
+                             worker->commandPool, nullptr);
+    }
+}
+
+void VeRegionRecorder::beginFrame(uint32_t frameIndex,
+                                  VkRenderPass renderPass) {
+    assert(frameIndex < frameCount &&
+           "frame index outside of the recorder");
+
+    if (renderPass != this->renderPass) {
+        invalidate();
+        this->renderPass = renderPass;
+    }
+
+    frame = frameIndex;
+    std::fill(drawn.begin(), drawn.end(), false);
+}
+
+void VeRegionRecorder::record(uint32_t region, uint64_t key,
+                              RecordFunction record) {
+    assert(region < workers.size() && "unknown region");
+    assert(!drawn[region] && "region recorded twice");
+
+    Worker &worker = *workers[region];
+    Slot &slot = worker.slots[frame];
+    drawn[region] = true;
+
+    // Its fence was waited for, so the buffer isn't
+    // pending any more and can be executed again.
+    if (slot.valid && slot.key == key) {
+        reused++;
+        return;
+    }
+
+    slot.valid = false;
+    slot.key = key;
+    recorded++;
+
+    {
+        std::lock_guard<std::mutex> lock{mutex};
+        worker.job = std::move(record);
+        worker.jobSlot = &slot;
+        worker.pending = true;
+    }
+    worker.wake.notify_one();
+}
+
+const std::vector<VkCommandBuffer> &
+VeRegionRecorder::endFrame() {
+    std::exception_ptr error;
+
+    {
+        std::unique_lock<std::mutex> lock{mutex};
+
+        for (auto &worker : workers) {
+            done.wait(lock,
+                      [&] { return !worker->pending; });
+
+            if (worker->error != nullptr) {
+                error = worker->error;
+                worker->error = nullptr;
+            }
+        }
+    }
+
+    if (error != nullptr) {
+        std::rethrow_exception(error);
+    }
+
+    commandBuffers.clear();
+
+    for (size_t i = 0; i < workers.size(); i++) {
+        if (drawn[i]) {
+            commandBuffers.push_back(
+                workers[i]->slots[frame].commandBuffer);
+        }
+    }
+
+    return commandBuffers;
+}
+
+void VeRegionRecorder::invalidate() {
+    for (auto &worker : workers) {
+        for (auto &slot : worker->slots) {
+            slot.valid = false;
+        }
+    }
+}
+
+void VeRegionRecorder::run(Worker &worker) {
+    std::unique_lock<std::mutex> lock{mutex};
+
+    while (true) {
+        worker.wake.wait(lock, [&] {
+            return stopping || worker.pending;
+        });
+
+        if (stopping) {
+            return;
+        }
+
+        RecordFunction job = std::move(worker.job);
+        Slot &slot = *worker.jobSlot;
+        lock.unlock();
+
+        std::exception_ptr error;
+
+        try {
+            recordSlot(slot, job);
+        } catch (...) {
+            error = std::current_exception();
+        }
+
+        lock.lock();
+        worker.error = error;
+        worker.pending = false;
+        done.notify_all();
+    }
+}
+
+void VeRegionRecorder::recordSlot(
+    Slot &slot, const RecordFunction &record) {
+    // Not tied to a framebuffer, so one recording serves
+    // every swap chain image.
+    VkCommandBufferInheritanceInfo inheritanceInfo{};
+    inheritanceInfo.sType =
+        VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+    inheritanceInfo.renderPass = renderPass;
+    inheritanceInfo.subpass = 0;
+    inheritanceInfo.framebuffer = VK_NULL_HANDLE;
+
+    VkCommandBufferBeginInfo beginInfo{};
+    beginInfo.sType =
+        VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags =
+        VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
+    beginInfo.pInheritanceInfo = &inheritanceInfo;
+
+    // Resets the buffer, the pool allows that.
+    if (vkBeginCommandBuffer(slot.commandBuffer,
+                             &beginInfo) != VK_SUCCESS) {
+        throw std::runtime_error(
+            "failed to start recording region");
+    }
+
+    record(slot.commandBuffer);
+
+    if (vkEndCommandBuffer(slot.commandBuffer) !=
+        VK_SUCCESS) {
+        throw std::runtime_error(
+            "failed to record region");
+    }
+
+    slot.valid = true;
+}
+
+void VeRegionRecorder::createWorker(Worker &worker) {
+    VkCommandPoolCreateInfo poolInfo{};
+    poolInfo.sType =
+        VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    poolInfo.queueFamilyIndex =
+        veDevice.findPhysicalQueueFamilies().graphicsFamily;
+    poolInfo.flags =
+        VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+
+    if (vkCreateCommandPool(veDevice.device(), &poolInfo,
+                            nullptr, &worker.commandPool) !=
+        VK_SUCCESS) {
+        throw std::runtime_error(
+            "failed to create region command pool");
+    }
+
+    std::vector<VkCommandBuffer> buffers(frameCount);
+
+    VkCommandBufferAllocateInfo allocInfo{};
+    allocInfo.sType =
+        VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    allocInfo.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+    allocInfo.commandPool = worker.commandPool;
+    allocInfo.commandBufferCount = frameCount;
+
+    if (vkAllocateCommandBuffers(veDevice.device(),
+                                 &allocInfo,
+                                 buffers.data()) !=
+        VK_SUCCESS) {
+        throw std::runtime_error(
+            "failed to allocate region command buffers");
+    }
+
+    worker.slots.resize(frameCount);
+
+    for (uint32_t i = 0; i < frameCount; i++) {
+        worker.slots[i].commandBuffer = buffers[i];
+    }
+}
+
+}  // namespace ve
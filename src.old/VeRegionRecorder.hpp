@@ -0,0 +1,118 @@
+#pragma once
+
+#include <vulkan/vulkan_core.h>
+
+#include "VeDevice.hpp"
+#include "VeSwapChain.hpp"
+
+// std
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace ve {
+
+// Records the regions of the window into secondary command
+// buffers on worker threads.
+//
+// Every region has its own worker, and every worker its
+// own command pool, so recording needs no locks. A region
+// keeps one secondary buffer per frame in flight. When it
+// is recorded with the same key as the last time its
+// buffer for that frame was, the buffer is executed again
+// as it is, so only regions that changed cost recording.
+class VeRegionRecorder {
+   public:
+    using RecordFunction =
+        std::function<void(VkCommandBuffer)>;
+
+    VeRegionRecorder(VeDevice &device, uint32_t regionCount,
+                     uint32_t frameCount =
+                         VeSwapChain::MAX_FRAMES_IN_FLIGHT);
+    ~VeRegionRecorder();
+
+    VeRegionRecorder(const VeRegionRecorder &) = delete;
+    VeRegionRecorder &operator=(const VeRegionRecorder &) =
+        delete;
+
+    // Starts a frame whose regions are drawn in subpass 0
+    // of renderPass. The fence of frameIndex must have been
+    // waited for. Another render pass than last frame's
+    // invalidates all buffers.
+    void beginFrame(uint32_t frameIndex,
+                    VkRenderPass renderPass);
+
+    // Has region drawn this frame. Unless the buffer can be
+    // reused, record is called on the region's worker and
+    // must only touch what nothing else uses before
+    // endFrame returns. Viewport and scissor are not
+    // inherited and have to be set by it.
+    void record(uint32_t region, uint64_t key,
+                RecordFunction record);
+
+    // Waits for the workers and returns the buffers of the
+    // regions drawn this frame, in region order, for
+    // vkCmdExecuteCommands. Rethrows what a worker threw.
+    const std::vector<VkCommandBuffer> &endFrame();
+
+    // Has every region recorded again, e.g. because the
+    // pipelines they bind were recreated.
+    void invalidate();
+
+    // Regions recorded and reused since construction.
+    uint64_t recordedCount() const {
+        return recorded;
+    }
+    uint64_t reusedCount() const {
+        return reused;
+    }
+
+   private:
+    struct Slot {
+        VkCommandBuffer commandBuffer;
+        uint64_t key = 0;
+        bool valid = false;
+    };
+
+    struct Worker {
+        VkCommandPool commandPool = VK_NULL_HANDLE;
+        // One per frame in flight.
+        std::vector<Slot> slots;
+        std::thread thread;
+        std::condition_variable wake;
+
+        // Guarded by mutex.
+        RecordFunction job;
+        Slot *jobSlot = nullptr;
+        bool pending = false;
+        std::exception_ptr error;
+    };
+
+    void run(Worker &worker);
+    void recordSlot(Slot &slot,
+                    const RecordFunction &record);
+    void createWorker(Worker &worker);
+
+    VeDevice &veDevice;
+    uint32_t frameCount;
+    std::vector<std::unique_ptr<Worker>> workers;
+
+    std::mutex mutex;
+    std::condition_variable done;
+    bool stopping = false;
+
+    uint32_t frame = 0;
+    VkRenderPass renderPass = VK_NULL_HANDLE;
+    std::vector<bool> drawn;
+    std::vector<VkCommandBuffer> commandBuffers;
+
+    uint64_t recorded = 0;
+    uint64_t reused = 0;
+};
+
+}  // namespace ve
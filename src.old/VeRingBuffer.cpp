@@ -0,0 +1,94 @@
+#include "VeRingBuffer.hpp"
+
+#include <vulkan/vulkan_core.h>
+
+// std
+#include <algorithm>
+#include <cassert>
+#include <stdexcept>
+
+namespace ve {
+
+VeRingBuffer::VeRingBuffer(VeDevice &device,
+                           VkDeviceSize frameSize,
+                           VkBufferUsageFlags usage,
+                           uint32_t frameCount)
+    : veDevice{device}, usage{usage}, frameCount{frameCount} {
+    assert(frameCount > 0 && "ring buffer needs a frame");
+    current = createBlock(frameSize);
+}
+
+VeRingBuffer::~VeRingBuffer() {
+    for (auto &retiredBlock : retired) {
+        destroyBlock(retiredBlock.block);
+    }
+
+    destroyBlock(current);
+}
+
+void VeRingBuffer::beginFrame(uint32_t frameIndex) {
+    assert(frameIndex < frameCount &&
+           "frame index outside of the ring");
+
+    frame = frameIndex;
+    head = 0;
+
+    // A block retired during frame N was last used by
+    // frame N, whose fence has been waited on by the time
+    // its region comes around again.
+    for (auto it = retired.begin(); it != retired.end();) {
+        if (--it->frames == 0) {
+            destroyBlock(it->block);
+            it = retired.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+VeRingBuffer::Allocation VeRingBuffer::allocate(
+    VkDeviceSize size, VkDeviceSize alignment) {
+    VkDeviceSize offset =
+        (head + alignment - 1) / alignment * alignment;
+
+    if (offset + size > current.frameSize) {
+        // Only happens when a frame needs more than any
+        // before it, so doubling settles quickly.
+        retired.push_back({current, frameCount});
+        current = createBlock(
+            std::max(current.frameSize * 2, size * 2));
+        generation_++;
+        offset = 0;
+    }
+
+    head = offset + size;
+
+    VkDeviceSize base = current.frameSize * frame;
+    return {current.buffer, base + offset,
+            current.mapped + base + offset};
+}
+
+VeRingBuffer::Block VeRingBuffer::createBlock(
+    VkDeviceSize frameSize) {
+    Block block;
+    block.frameSize = frameSize;
+
+    veDevice.createBuffer(
+        frameSize * frameCount, usage,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+            VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+        block.buffer, block.memory);
+
+    block.mapped =
+        static_cast<uint8_t *>(block.memory.mapped);
+    return block;
+}
+
+void VeRingBuffer::destroyBlock(Block &block) {
+    vkDestroyBuffer(veDevice.device(), block.buffer,
+                    nullptr);
+    veDevice.freeMemory(block.memory);
+    block = {};
+}
+
+}  // namespace ve
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <vulkan/vulkan_core.h>
+
+#include "VeDevice.hpp"
+#include "VeSwapChain.hpp"
+
+// std
+#include <cstdint>
+#include <vector>
+
+namespace ve {
+
+// Persistently mapped buffer for data that is rewritten
+// every frame, like glyph instances.
+//
+// The buffer is split into one region per frame in flight.
+// The CPU fills the region of frame N while the GPU still
+// reads the one of frame N - 1, and a region is only
+// reused once VeSwapChain::acquireNextImage has waited for
+// the fence of the frame that used it last. Allocating is
+// a pointer bump, nothing is mapped or allocated per frame.
+class VeRingBuffer {
+   public:
+    struct Allocation {
+        VkBuffer buffer;
+        VkDeviceSize offset;
+        void *data;
+    };
+
+    VeRingBuffer(VeDevice &device, VkDeviceSize frameSize,
+                 VkBufferUsageFlags usage,
+                 uint32_t frameCount =
+                     VeSwapChain::MAX_FRAMES_IN_FLIGHT);
+    ~VeRingBuffer();
+
+    VeRingBuffer(const VeRingBuffer &) = delete;
+    VeRingBuffer &operator=(const VeRingBuffer &) = delete;
+
+    // Starts writing the region of frameIndex, the
+    // swap chain's current frame.
+    void beginFrame(uint32_t frameIndex);
+
+    // Returns size bytes in the current frame's region.
+    // Running out grows the buffer, the old one is kept
+    // until no frame in flight can be using it.
+    Allocation allocate(VkDeviceSize size,
+                        VkDeviceSize alignment = 16);
+
+    // Counts how often the buffer grew. Unlike the
+    // VkBuffer handle, which the driver may hand out again
+    // once the old buffer is destroyed, it never repeats.
+    uint64_t generation() const {
+        return generation_;
+    }
+    VkDeviceSize frameSize() const {
+        return current.frameSize;
+    }
+    // Bytes allocated in the current frame so far.
+    VkDeviceSize used() const {
+        return head;
+    }
+
+   private:
+    struct Block {
+        VkBuffer buffer = VK_NULL_HANDLE;
+        VeAllocation memory;
+        uint8_t *mapped = nullptr;
+        VkDeviceSize frameSize = 0;
+    };
+
+    struct RetiredBlock {
+        Block block;
+        // Frames to begin before nothing can be using it.
+        uint32_t frames;
+    };
+
+    Block createBlock(VkDeviceSize frameSize);
+    void destroyBlock(Block &block);
+
+    VeDevice &veDevice;
+    VkBufferUsageFlags usage;
+    uint32_t frameCount;
+
+    Block current;
+    std::vector<RetiredBlock> retired;
+    uint32_t frame = 0;
+    VkDeviceSize head = 0;
+    uint64_t generation_ = 0;
+};
+
+}  // namespace ve
@@ -3,6 +3,7 @@
 #include <vulkan/vulkan_core.h>
 
 // std
+#include <algorithm>
 #include <array>
 #include <cstdlib>
 #include <cstring>
@@ -13,17 +14,37 @@
 
 namespace ve {
 
+const char *presentProfileName(PresentProfile profile) {
+    switch (profile) {
+        case PresentProfile::VSync:
+            return "V-Sync";
+        case PresentProfile::LowLatency:
+            return "Low Latency";
+        case PresentProfile::Immediate:
+            return "Immediate";
+        case PresentProfile::Relaxed:
+            return "Relaxed V-Sync";
+    }
+
+    return "Unknown";
+}
+
 VeSwapChain::VeSwapChain(VeDevice &deviceRef,
-                         VkExtent2D extent)
-    : device{deviceRef}, windowExtent{extent} {
+                         VkExtent2D extent,
+                         PresentProfile profile)
+    : device{deviceRef},
+      windowExtent{extent},
+      presentProfile{profile} {
     init();
 }
 
 VeSwapChain::VeSwapChain(
     VeDevice &deviceRef, VkExtent2D extent,
-    std::shared_ptr<VeSwapChain> previous)
+    std::shared_ptr<VeSwapChain> previous,
+    PresentProfile profile)
     : device{deviceRef},
       windowExtent{extent},
+      presentProfile{profile},
       oldSwapChain{previous} {
     init();
     oldSwapChain = nullptr;
@@ -56,8 +77,7 @@ VeSwapChain::~VeSwapChain() {
                            depthImageViews[i], nullptr);
         vkDestroyImage(device.device(), depthImages[i],
                        nullptr);
-        vkFreeMemory(device.device(), depthImageMemorys[i],
-                     nullptr);
+        device.freeMemory(depthImageMemorys[i]);
     }
 
     for (auto framebuffer : swapChainFramebuffers) {
@@ -69,7 +89,7 @@ VeSwapChain::~VeSwapChain() {
                         nullptr);
 
     // cleanup synchronization objects
-    for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+    for (size_t i = 0; i < framesInFlight(); i++) {
         vkDestroySemaphore(device.device(),
                            renderFinishedSemaphores[i],
                            nullptr);
@@ -99,7 +119,8 @@ VkResult VeSwapChain::acquireNextImage(
 }
 
 VkResult VeSwapChain::submitCommandBuffers(
-    const VkCommandBuffer *buffers, uint32_t *imageIndex) {
+    const VkCommandBuffer *buffers, uint32_t *imageIndex,
+    const FrameSync &sync) {
     if (imagesInFlight[*imageIndex] != VK_NULL_HANDLE) {
         vkWaitForFences(device.device(), 1,
                         &imagesInFlight[*imageIndex],
@@ -112,10 +133,15 @@ VkResult VeSwapChain::submitCommandBuffers(
     submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
 
     VkSemaphore waitSemaphores[] = {
-        imageAvailableSemaphores[currentFrame]};
+        imageAvailableSemaphores[currentFrame],
+        sync.waitSemaphore};
     VkPipelineStageFlags waitStages[] = {
-        VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT};
-    submitInfo.waitSemaphoreCount = 1;
+        VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+        sync.waitStages};
+    // Binary semaphores ignore their value.
+    uint64_t waitValues[] = {0, sync.waitValue};
+    submitInfo.waitSemaphoreCount =
+        sync.waitSemaphore != VK_NULL_HANDLE ? 2 : 1;
     submitInfo.pWaitSemaphores = waitSemaphores;
     submitInfo.pWaitDstStageMask = waitStages;
 
@@ -123,10 +149,30 @@ VkResult VeSwapChain::submitCommandBuffers(
     submitInfo.pCommandBuffers = buffers;
 
     VkSemaphore signalSemaphores[] = {
-        renderFinishedSemaphores[currentFrame]};
-    submitInfo.signalSemaphoreCount = 1;
+        renderFinishedSemaphores[currentFrame],
+        sync.signalSemaphore};
+    uint64_t signalValues[] = {0, sync.signalValue};
+    submitInfo.signalSemaphoreCount =
+        sync.signalSemaphore != VK_NULL_HANDLE ? 2 : 1;
     submitInfo.pSignalSemaphores = signalSemaphores;
 
+    VkTimelineSemaphoreSubmitInfo timelineInfo{};
+    timelineInfo.sType =
+        VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+    timelineInfo.waitSemaphoreValueCount =
+        submitInfo.waitSemaphoreCount;
+    timelineInfo.pWaitSemaphoreValues = waitValues;
+    timelineInfo.signalSemaphoreValueCount =
+        submitInfo.signalSemaphoreCount;
+    timelineInfo.pSignalSemaphoreValues = signalValues;
+
+    // Only devices with timeline semaphores know the
+    // struct.
+    if (submitInfo.waitSemaphoreCount > 1 ||
+        submitInfo.signalSemaphoreCount > 1) {
+        submitInfo.pNext = &timelineInfo;
+    }
+
     vkResetFences(device.device(), 1,
                   &inFlightFences[currentFrame]);
     if (vkQueueSubmit(
@@ -151,8 +197,7 @@ VkResult VeSwapChain::submitCommandBuffers(
     auto result = vkQueuePresentKHR(device.presentQueue(),
                                     &presentInfo);
 
-    currentFrame =
-        (currentFrame + 1) % MAX_FRAMES_IN_FLIGHT;
+    currentFrame = (currentFrame + 1) % framesInFlight();
 
     return result;
 }
@@ -163,19 +208,13 @@ void VeSwapChain::createSwapChain() {
 
     VkSurfaceFormatKHR surfaceFormat =
         chooseSwapSurfaceFormat(swapChainSupport.formats);
-    VkPresentModeKHR presentMode = chooseSwapPresentMode(
+    presentMode = chooseSwapPresentMode(
         swapChainSupport.presentModes);
     VkExtent2D extent =
         chooseSwapExtent(swapChainSupport.capabilities);
 
     uint32_t imageCount =
-        swapChainSupport.capabilities.minImageCount + 1;
-    if (swapChainSupport.capabilities.maxImageCount > 0 &&
-        imageCount >
-            swapChainSupport.capabilities.maxImageCount) {
-        imageCount =
-            swapChainSupport.capabilities.maxImageCount;
-    }
+        chooseImageCount(swapChainSupport.capabilities);
 
     VkSwapchainCreateInfoKHR createInfo = {};
     createInfo.sType =
@@ -433,9 +472,21 @@ void VeSwapChain::createDepthResources() {
 }
 
 void VeSwapChain::createSyncObjects() {
-    imageAvailableSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
-    renderFinishedSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
-    inFlightFences.resize(MAX_FRAMES_IN_FLIGHT);
+    // FIFO throttles to the refresh rate anyway, a second
+    // frame in flight keeps the GPU busy meanwhile. The
+    // other modes never block on present, so a single
+    // frame in flight keeps input from waiting behind an
+    // older frame.
+    size_t frames = MAX_FRAMES_IN_FLIGHT;
+
+    if (presentMode == VK_PRESENT_MODE_MAILBOX_KHR ||
+        presentMode == VK_PRESENT_MODE_IMMEDIATE_KHR) {
+        frames = 1;
+    }
+
+    imageAvailableSemaphores.resize(frames);
+    renderFinishedSemaphores.resize(frames);
+    inFlightFences.resize(frames);
     imagesInFlight.resize(imageCount(), VK_NULL_HANDLE);
 
     VkSemaphoreCreateInfo semaphoreInfo = {};
@@ -446,7 +497,7 @@ void VeSwapChain::createSyncObjects() {
     fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
     fenceInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
 
-    for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+    for (size_t i = 0; i < frames; i++) {
         if (vkCreateSemaphore(
                 device.device(), &semaphoreInfo, nullptr,
                 &imageAvailableSemaphores[i]) !=
@@ -484,74 +535,64 @@ VkSurfaceFormatKHR VeSwapChain::chooseSwapSurfaceFormat(
 VkPresentModeKHR VeSwapChain::chooseSwapPresentMode(
     const std::vector<VkPresentModeKHR>
         &availablePresentModes) {
-    for (const auto &avaliablePresentMode :
-         availablePresentModes) {
-        switch (avaliablePresentMode) {
-            case VK_PRESENT_MODE_MAILBOX_KHR:
-                std::cout
-                    << "Avaliable Present Mode: Mailbox"
-                    << std::endl;
-                break;
-            case VK_PRESENT_MODE_FIFO_KHR:
-                std::cout << "Avaliable Present Mode: Fifo"
-                          << std::endl;
-                break;
-            case VK_PRESENT_MODE_IMMEDIATE_KHR:
-                std::cout
-                    << "Avaliable Present Mode: Immediate"
-                    << std::endl;
-                break;
-            case VK_PRESENT_MODE_FIFO_RELAXED_KHR:
-                std::cout << "Avaliable Present Mode: Fifo "
-                             "Relaxed"
-                          << std::endl;
-                break;
-            case VK_PRESENT_MODE_SHARED_DEMAND_REFRESH_KHR:
-                std::cout
-                    << "Avaliable Present Mode: Shared "
-                       "Demand Refresh"
-                    << std::endl;
-                break;
-            case VK_PRESENT_MODE_SHARED_CONTINUOUS_REFRESH_KHR:
-                std::cout
-                    << "Avaliable Present Mode: Shared "
-                       "Continuous Refresh"
-                    << std::endl;
-                break;
-            case VK_PRESENT_MODE_MAX_ENUM_KHR:
-                std::cout
-                    << "Avaliable Present Mode: Max Enum"
-                    << std::endl;
-                break;
-            default:
-                std::cout
-                    << "Avaliable Present Mode: Unkown"
-                    << std::endl;
-                break;
+    std::vector<VkPresentModeKHR> preferred;
+
+    switch (presentProfile) {
+        case PresentProfile::VSync:
+            break;
+        case PresentProfile::LowLatency:
+            preferred = {VK_PRESENT_MODE_MAILBOX_KHR,
+                         VK_PRESENT_MODE_FIFO_RELAXED_KHR};
+            break;
+        case PresentProfile::Immediate:
+            preferred = {VK_PRESENT_MODE_IMMEDIATE_KHR,
+                         VK_PRESENT_MODE_MAILBOX_KHR,
+                         VK_PRESENT_MODE_FIFO_RELAXED_KHR};
+            break;
+        case PresentProfile::Relaxed:
+            preferred = {VK_PRESENT_MODE_FIFO_RELAXED_KHR};
+            break;
+    }
+
+    for (auto mode : preferred) {
+        if (std::find(availablePresentModes.begin(),
+                      availablePresentModes.end(),
+                      mode) != availablePresentModes.end()) {
+            return mode;
         }
     }
-    // for (const auto &availablePresentMode :
-    // availablePresentModes) {
-    //   if (availablePresentMode ==
-    //   VK_PRESENT_MODE_MAILBOX_KHR) {
-    //     std::cout << "Present mode: Mailbox" <<
-    //     std::endl; return availablePresentMode;
-    //   }
-    // }
-
-    // for (const auto &availablePresentMode :
-    // availablePresentModes) {
-    //   if (availablePresentMode ==
-    //   VK_PRESENT_MODE_IMMEDIATE_KHR) {
-    //     std::cout << "Present mode: Immediate" <<
-    //     std::endl; return availablePresentMode;
-    //   }
-    // }
-
-    std::cout << "Present mode: V-Sync" << std::endl;
+
     return VK_PRESENT_MODE_FIFO_KHR;
-    // std::cout << "Present mode: Relaxed V-Sync" <<
-    // std::endl; return VK_PRESENT_MODE_FIFO_RELAXED_KHR;
+}
+
+uint32_t VeSwapChain::chooseImageCount(
+    const VkSurfaceCapabilitiesKHR &capabilities) {
+    // MAILBOX needs an image on screen, one queued and one
+    // to render to, to never wait. IMMEDIATE never queues,
+    // and every further FIFO image is another refresh a
+    // frame can wait before it is shown.
+    uint32_t imageCount;
+
+    switch (presentMode) {
+        case VK_PRESENT_MODE_MAILBOX_KHR:
+            imageCount =
+                std::max(capabilities.minImageCount + 1, 3u);
+            break;
+        case VK_PRESENT_MODE_IMMEDIATE_KHR:
+            imageCount =
+                std::max(capabilities.minImageCount, 2u);
+            break;
+        default:
+            imageCount = capabilities.minImageCount + 1;
+            break;
+    }
+
+    if (capabilities.maxImageCount > 0 &&
+        imageCount > capabilities.maxImageCount) {
+        imageCount = capabilities.maxImageCount;
+    }
+
+    return imageCount;
 }
 
 VkExtent2D VeSwapChain::chooseSwapExtent(
@@ -12,15 +12,48 @@
 
 namespace ve {
 
+// How frames get to the screen. Each profile falls back to
+// the next best mode the surface supports, ending at FIFO,
+// which every surface has.
+enum class PresentProfile {
+    // FIFO. Never tears, frames may queue for a refresh.
+    VSync,
+    // MAILBOX, else FIFO_RELAXED. Never tears, a new frame
+    // replaces the one waiting for the refresh.
+    LowLatency,
+    // IMMEDIATE, else MAILBOX, else FIFO_RELAXED. Presents
+    // right away and may tear.
+    Immediate,
+    // FIFO_RELAXED. Like VSync, but a frame that missed its
+    // refresh is shown right away and may tear.
+    Relaxed,
+};
+
+const char *presentProfileName(PresentProfile profile);
+
+// Timeline semaphores a frame waits for and signals besides
+// the swap chain's own. Null semaphores are left out.
+struct FrameSync {
+    VkSemaphore waitSemaphore = VK_NULL_HANDLE;
+    uint64_t waitValue = 0;
+    VkPipelineStageFlags waitStages = 0;
+    VkSemaphore signalSemaphore = VK_NULL_HANDLE;
+    uint64_t signalValue = 0;
+};
+
 class VeSwapChain {
    public:
+    // Frames in flight of the profile with the most, size
+    // of per frame resources outside the swap chain.
     static constexpr int MAX_FRAMES_IN_FLIGHT = 2;
 
-    VeSwapChain(VeDevice &deviceRef,
-                VkExtent2D windowExtent);
-    VeSwapChain(VeDevice &deviceRef,
-                VkExtent2D windowExtent,
-                std::shared_ptr<VeSwapChain> previous);
+    VeSwapChain(
+        VeDevice &deviceRef, VkExtent2D windowExtent,
+        PresentProfile profile = PresentProfile::VSync);
+    VeSwapChain(
+        VeDevice &deviceRef, VkExtent2D windowExtent,
+        std::shared_ptr<VeSwapChain> previous,
+        PresentProfile profile = PresentProfile::VSync);
 
     ~VeSwapChain();
 
@@ -39,6 +72,22 @@ class VeSwapChain {
     size_t imageCount() {
         return swapChainImages.size();
     }
+    // Frame in flight being recorded, between
+    // acquireNextImage and submitCommandBuffers.
+    size_t getCurrentFrame() const {
+        return currentFrame;
+    }
+    // At most MAX_FRAMES_IN_FLIGHT, fewer for the low
+    // latency profiles.
+    size_t framesInFlight() const {
+        return inFlightFences.size();
+    }
+    PresentProfile getPresentProfile() const {
+        return presentProfile;
+    }
+    VkPresentModeKHR getPresentMode() const {
+        return presentMode;
+    }
     VkFormat getSwapChainImageFormat() {
         return swapChainImageFormat;
     }
@@ -61,7 +110,7 @@ class VeSwapChain {
     VkResult acquireNextImage(uint32_t *imageIndex);
     VkResult submitCommandBuffers(
         const VkCommandBuffer *buffers,
-        uint32_t *imageIndex);
+        uint32_t *imageIndex, const FrameSync &sync = {});
 
     bool compareSwapFormats(
         const VeSwapChain &swapChain) const {
@@ -87,6 +136,8 @@ class VeSwapChain {
     VkPresentModeKHR chooseSwapPresentMode(
         const std::vector<VkPresentModeKHR>
             &availablePresentModes);
+    uint32_t chooseImageCount(
+        const VkSurfaceCapabilitiesKHR &capabilities);
     VkExtent2D chooseSwapExtent(
         const VkSurfaceCapabilitiesKHR &capabilities);
 
@@ -98,13 +149,15 @@ class VeSwapChain {
     VkRenderPass renderPass;
 
     std::vector<VkImage> depthImages;
-    std::vector<VkDeviceMemory> depthImageMemorys;
+    std::vector<VeAllocation> depthImageMemorys;
     std::vector<VkImageView> depthImageViews;
     std::vector<VkImage> swapChainImages;
     std::vector<VkImageView> swapChainImageViews;
 
     VeDevice &device;
     VkExtent2D windowExtent;
+    PresentProfile presentProfile;
+    VkPresentModeKHR presentMode;
 
     VkSwapchainKHR swapChain;
     std::shared_ptr<VeSwapChain> oldSwapChain;
@@ -0,0 +1,369 @@
+#include "VeTextRenderer.hpp"
+
+#include <vulkan/vulkan_core.h>
+
+#include "Utf8.hpp"
+
+// std
+#include <cassert>
+#include <cstring>
+#include <stdexcept>
+
+namespace ve {
+
+struct TextPushConstantData {
+    glm::vec2 viewportSize;
+    glm::vec2 atlasSize;
+    float scale;
+};
+
+VeTextRenderer::VeTextRenderer(VeDevice &device,
+                               VeGlyphAtlas &glyphAtlas)
+    : veDevice{device}, veGlyphAtlas{glyphAtlas} {
+    createPaletteBuffer();
+    createDescriptorSet();
+    createPipelineLayout();
+
+    std::array<glm::vec4, PALETTE_SIZE> colors;
+    colors.fill({0.9f, 0.9f, 0.9f, 1.0f});
+    setPalette(colors);
+}
+
+VeTextRenderer::~VeTextRenderer() {
+    vePipeline.reset();
+    vkDestroyPipelineLayout(veDevice.device(),
+                            pipelineLayout, nullptr);
+
+    vkDestroyDescriptorPool(veDevice.device(),
+                            descriptorPool, nullptr);
+    vkDestroyDescriptorSetLayout(
+        veDevice.device(), descriptorSetLayout, nullptr);
+
+    vkDestroyBuffer(veDevice.device(), paletteBuffer,
+                    nullptr);
+    veDevice.freeMemory(paletteBufferMemory);
+}
+
+void VeTextRenderer::createPipeline(
+    VkRenderPass renderPass) {
+    PipelineConfigInfo pipelineConfig{};
+    VePipeline::defaultPipelineConfigInfo(pipelineConfig);
+
+    pipelineConfig.bindingDescriptions =
+        Instance::getBindingDescriptions();
+    pipelineConfig.attributeDescriptions =
+        Instance::getAttributeDescriptions();
+    pipelineConfig.inputAssemblyInfo.topology =
+        VK_PRIMITIVE_TOPOLOGY_TRIANGLE_STRIP;
+
+    // Text is drawn over everything else in order, with
+    // the glyph coverage as alpha.
+    pipelineConfig.depthStencilInfo.depthTestEnable =
+        VK_FALSE;
+    pipelineConfig.depthStencilInfo.depthWriteEnable =
+        VK_FALSE;
+    pipelineConfig.colorBlendAttachment.blendEnable =
+        VK_TRUE;
+    pipelineConfig.colorBlendAttachment
+        .srcColorBlendFactor = VK_BLEND_FACTOR_SRC_ALPHA;
+    pipelineConfig.colorBlendAttachment
+        .dstColorBlendFactor =
+        VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
+    pipelineConfig.colorBlendAttachment
+        .srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+    pipelineConfig.colorBlendAttachment
+        .dstAlphaBlendFactor =
+        VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
+
+    pipelineConfig.renderPass = renderPass;
+    pipelineConfig.piplineLayout = pipelineLayout;
+
+    // Distance fields need their edge found per pixel.
+    const char *fragmentShader =
+        veGlyphAtlas.font().mode() == GlyphMode::Distance
+            ? "res/shaders/text_sdf.frag.spv"
+            : "res/shaders/text.frag.spv";
+
+    vePipeline.reset();
+    vePipeline = std::make_unique<VePipeline>(
+        veDevice, "res/shaders/text.vert.spv",
+        fragmentShader, pipelineConfig);
+}
+
+void VeTextRenderer::setPalette(
+    const std::array<glm::vec4, PALETTE_SIZE> &colors) {
+    memcpy(paletteBufferMemory.mapped, colors.data(),
+           sizeof(colors));
+}
+
+float VeTextRenderer::addText(float x, float y,
+                              std::string_view text,
+                              uint32_t colorIndex,
+                              float maxX) {
+    assert(colorIndex < PALETTE_SIZE &&
+           "color index outside of the palette");
+
+    size_t offset = 0;
+
+    while (offset < text.size() && x < maxX) {
+        size_t length;
+        char32_t codepoint =
+            utf8::decode(text.data() + offset,
+                         text.size() - offset, length);
+        offset += length;
+
+        const auto &glyph = veGlyphAtlas.glyph(codepoint);
+
+        if (glyph.width != 0) {
+            Instance instance;
+            instance.x = static_cast<int16_t>(
+                x + glyph.left * scale_);
+            instance.y = static_cast<int16_t>(
+                y + glyph.top * scale_);
+            instance.atlasX = glyph.x;
+            instance.atlasY = glyph.y;
+            instance.width = glyph.width;
+            instance.height = glyph.height;
+            instance.colorIndex = colorIndex;
+            instances.push_back(instance);
+        }
+
+        x += glyph.advance * scale_;
+    }
+
+    return x;
+}
+
+uint64_t VeTextRenderer::contentHash() const {
+    // FNV-1a, instances have no padding.
+    uint64_t hash = 0xcbf29ce484222325;
+    auto bytes =
+        reinterpret_cast<const uint8_t *>(instances.data());
+
+    size_t size = sizeof(Instance) * instances.size();
+
+    for (size_t i = 0; i < size; i++) {
+        hash = (hash ^ bytes[i]) * 0x100000001b3;
+    }
+
+    // The instances keep their atlas size when zooming.
+    uint32_t scaleBits;
+    memcpy(&scaleBits, &scale_, sizeof(scaleBits));
+
+    return (hash ^ scaleBits) * 0x100000001b3;
+}
+
+void VeTextRenderer::render(VkCommandBuffer commandBuffer,
+                            VeRingBuffer &frameData,
+                            VkExtent2D extent) {
+    assert(vePipeline != nullptr &&
+           "cannot render text before creating pipeline");
+
+    if (instances.empty()) {
+        return;
+    }
+
+    VkDeviceSize size = sizeof(Instance) * instances.size();
+    auto allocation =
+        frameData.allocate(size, alignof(Instance));
+    memcpy(allocation.data, instances.data(),
+           static_cast<size_t>(size));
+
+    vePipeline->bind(commandBuffer);
+    vkCmdBindDescriptorSets(
+        commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
+        pipelineLayout, 0, 1, &descriptorSet, 0, nullptr);
+
+    TextPushConstantData push{};
+    push.viewportSize = {static_cast<float>(extent.width),
+                         static_cast<float>(extent.height)};
+    push.atlasSize = {
+        static_cast<float>(VeGlyphAtlas::SIZE),
+        static_cast<float>(VeGlyphAtlas::SIZE)};
+    push.scale = scale_;
+    vkCmdPushConstants(commandBuffer, pipelineLayout,
+                       VK_SHADER_STAGE_VERTEX_BIT, 0,
+                       sizeof(TextPushConstantData), &push);
+
+    VkBuffer buffers[] = {allocation.buffer};
+    VkDeviceSize offsets[] = {allocation.offset};
+
+    vkCmdBindVertexBuffers(commandBuffer, 0, 1, buffers,
+                           offsets);
+    vkCmdDraw(commandBuffer, 4,
+              static_cast<uint32_t>(instances.size()), 0,
+              0);
+}
+
+void VeTextRenderer::createDescriptorSet() {
+    std::array<VkDescriptorSetLayoutBinding, 2> bindings{};
+    bindings[0].binding = 0;
+    bindings[0].descriptorType =
+        VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    bindings[0].descriptorCount = 1;
+    bindings[0].stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+    bindings[1].binding = 1;
+    bindings[1].descriptorType =
+        VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+    bindings[1].descriptorCount = 1;
+    bindings[1].stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+
+    VkDescriptorSetLayoutCreateInfo layoutInfo{};
+    layoutInfo.sType =
+        VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    layoutInfo.bindingCount =
+        static_cast<uint32_t>(bindings.size());
+    layoutInfo.pBindings = bindings.data();
+
+    if (vkCreateDescriptorSetLayout(
+            veDevice.device(), &layoutInfo, nullptr,
+            &descriptorSetLayout) != VK_SUCCESS) {
+        throw std::runtime_error(
+            "failed to create text descriptor set layout");
+    }
+
+    std::array<VkDescriptorPoolSize, 2> poolSizes{};
+    poolSizes[0].type =
+        VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    poolSizes[0].descriptorCount = 1;
+    poolSizes[1].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+    poolSizes[1].descriptorCount = 1;
+
+    VkDescriptorPoolCreateInfo poolInfo{};
+    poolInfo.sType =
+        VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    poolInfo.maxSets = 1;
+    poolInfo.poolSizeCount =
+        static_cast<uint32_t>(poolSizes.size());
+    poolInfo.pPoolSizes = poolSizes.data();
+
+    if (vkCreateDescriptorPool(veDevice.device(), &poolInfo,
+                               nullptr, &descriptorPool) !=
+        VK_SUCCESS) {
+        throw std::runtime_error(
+            "failed to create text descriptor pool");
+    }
+
+    VkDescriptorSetAllocateInfo allocInfo{};
+    allocInfo.sType =
+        VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    allocInfo.descriptorPool = descriptorPool;
+    allocInfo.descriptorSetCount = 1;
+    allocInfo.pSetLayouts = &descriptorSetLayout;
+
+    if (vkAllocateDescriptorSets(veDevice.device(),
+                                 &allocInfo,
+                                 &descriptorSet) !=
+        VK_SUCCESS) {
+        throw std::runtime_error(
+            "failed to allocate text descriptor set");
+    }
+
+    VkDescriptorImageInfo imageInfo =
+        veGlyphAtlas.descriptorInfo();
+    VkDescriptorBufferInfo bufferInfo{
+        paletteBuffer, 0,
+        sizeof(glm::vec4) * PALETTE_SIZE};
+
+    std::array<VkWriteDescriptorSet, 2> writes{};
+    writes[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    writes[0].dstSet = descriptorSet;
+    writes[0].dstBinding = 0;
+    writes[0].descriptorCount = 1;
+    writes[0].descriptorType =
+        VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    writes[0].pImageInfo = &imageInfo;
+    writes[1].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    writes[1].dstSet = descriptorSet;
+    writes[1].dstBinding = 1;
+    writes[1].descriptorCount = 1;
+    writes[1].descriptorType =
+        VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+    writes[1].pBufferInfo = &bufferInfo;
+
+    vkUpdateDescriptorSets(
+        veDevice.device(),
+        static_cast<uint32_t>(writes.size()), writes.data(),
+        0, nullptr);
+}
+
+void VeTextRenderer::createPaletteBuffer() {
+    veDevice.createBuffer(
+        sizeof(glm::vec4) * PALETTE_SIZE,
+        VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+            VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+        paletteBuffer, paletteBufferMemory);
+}
+
+void VeTextRenderer::createPipelineLayout() {
+    VkPushConstantRange pushConstantRange{};
+    pushConstantRange.stageFlags =
+        VK_SHADER_STAGE_VERTEX_BIT;
+    pushConstantRange.offset = 0;
+    pushConstantRange.size = sizeof(TextPushConstantData);
+
+    VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+    pipelineLayoutInfo.sType =
+        VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipelineLayoutInfo.setLayoutCount = 1;
+    pipelineLayoutInfo.pSetLayouts = &descriptorSetLayout;
+    pipelineLayoutInfo.pushConstantRangeCount = 1;
+    pipelineLayoutInfo.pPushConstantRanges =
+        &pushConstantRange;
+
+    if (vkCreatePipelineLayout(
+            veDevice.device(), &pipelineLayoutInfo, nullptr,
+            &pipelineLayout) != VK_SUCCESS) {
+        throw std::runtime_error(
+            "failed to create text pipeline layout");
+    }
+}
+
+std::vector<VkVertexInputBindingDescription>
+VeTextRenderer::Instance::getBindingDescriptions() {
+    std::vector<VkVertexInputBindingDescription>
+        bindingDescriptions(1);
+    bindingDescriptions[0].binding = 0;
+    bindingDescriptions[0].stride = sizeof(Instance);
+    bindingDescriptions[0].inputRate =
+        VK_VERTEX_INPUT_RATE_INSTANCE;
+
+    return bindingDescriptions;
+}
+
+std::vector<VkVertexInputAttributeDescription>
+VeTextRenderer::Instance::getAttributeDescriptions() {
+    std::vector<VkVertexInputAttributeDescription>
+        attributeDescriptions(4);
+    attributeDescriptions[0].binding = 0;
+    attributeDescriptions[0].offset =
+        offsetof(Instance, x);
+    attributeDescriptions[0].location = 0;
+    attributeDescriptions[0].format =
+        VK_FORMAT_R16G16_SINT;
+
+    attributeDescriptions[1].binding = 0;
+    attributeDescriptions[1].offset =
+        offsetof(Instance, atlasX);
+    attributeDescriptions[1].location = 1;
+    attributeDescriptions[1].format =
+        VK_FORMAT_R16G16_UINT;
+
+    attributeDescriptions[2].binding = 0;
+    attributeDescriptions[2].offset =
+        offsetof(Instance, width);
+    attributeDescriptions[2].location = 2;
+    attributeDescriptions[2].format =
+        VK_FORMAT_R16G16_UINT;
+
+    attributeDescriptions[3].binding = 0;
+    attributeDescriptions[3].offset =
+        offsetof(Instance, colorIndex);
+    attributeDescriptions[3].location = 3;
+    attributeDescriptions[3].format = VK_FORMAT_R32_UINT;
+
+    return attributeDescriptions;
+}
+
+}  // namespace ve
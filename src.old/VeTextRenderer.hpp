@@ -0,0 +1,122 @@
+#pragma once
+
+#include <vulkan/vulkan_core.h>
+
+#include "VeDevice.hpp"
+#include "VeGlyphAtlas.hpp"
+#include "VePipeline.hpp"
+#include "VeRingBuffer.hpp"
+
+// libs
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+
+// std
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+namespace ve {
+
+// Draws text as instanced quads.
+//
+// Every glyph on screen is one 16 byte instance record and
+// the quad it is drawn on is generated in the vertex
+// shader, so a whole viewport is a single vkCmdDraw no
+// matter how many glyphs it shows.
+//
+// With a font in GlyphMode::Distance the atlas entries are
+// drawn at any scale, and zooming changes no glyphs.
+class VeTextRenderer {
+   public:
+    static constexpr uint32_t PALETTE_SIZE = 16;
+
+    struct Instance {
+        // Top left corner in framebuffer pixels.
+        int16_t x;
+        int16_t y;
+        // Top left corner in the atlas.
+        uint16_t atlasX;
+        uint16_t atlasY;
+        uint16_t width;
+        uint16_t height;
+        uint32_t colorIndex;
+
+        static std::vector<VkVertexInputBindingDescription>
+        getBindingDescriptions();
+        static std::vector<
+            VkVertexInputAttributeDescription>
+        getAttributeDescriptions();
+    };
+
+    VeTextRenderer(VeDevice &device,
+                   VeGlyphAtlas &glyphAtlas);
+    ~VeTextRenderer();
+
+    VeTextRenderer(const VeTextRenderer &) = delete;
+    VeTextRenderer &operator=(const VeTextRenderer &) =
+        delete;
+
+    // (Re)creates the pipeline for the given render pass.
+    void createPipeline(VkRenderPass renderPass);
+
+    // Must not be called while frames are in flight.
+    void setPalette(
+        const std::array<glm::vec4, PALETTE_SIZE> &colors);
+
+    // Screen pixels per font pixel. Anything but 1 only
+    // looks right if the atlas holds distance fields.
+    void setScale(float scale) {
+        scale_ = scale;
+    }
+    float scale() const {
+        return scale_;
+    }
+
+    // Drops the instances of the previous layout.
+    void clear() {
+        instances.clear();
+    }
+
+    // Lays out a line of UTF-8 text with its baseline at y
+    // and returns the pen position after it. Stops at
+    // maxX.
+    float addText(float x, float y, std::string_view text,
+                  uint32_t colorIndex, float maxX);
+
+    size_t instanceCount() const {
+        return instances.size();
+    }
+    // Changes whenever the laid out instances do.
+    uint64_t contentHash() const;
+
+    // Writes the instances into the frame's region of
+    // frameData and records the draw.
+    void render(VkCommandBuffer commandBuffer,
+                VeRingBuffer &frameData, VkExtent2D extent);
+
+   private:
+    void createDescriptorSet();
+    void createPaletteBuffer();
+    void createPipelineLayout();
+
+    VeDevice &veDevice;
+    VeGlyphAtlas &veGlyphAtlas;
+
+    VkDescriptorSetLayout descriptorSetLayout;
+    VkDescriptorPool descriptorPool;
+    VkDescriptorSet descriptorSet;
+    VkBuffer paletteBuffer;
+    VeAllocation paletteBufferMemory;
+
+    VkPipelineLayout pipelineLayout;
+    std::unique_ptr<VePipeline> vePipeline;
+
+    std::vector<Instance> instances;
+    float scale_ = 1.0f;
+};
+
+}  // namespace ve
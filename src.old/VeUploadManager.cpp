@@ -0,0 +1,612 @@
+#include "VeUploadManager.hpp"
+
+#include <vulkan/vulkan_core.h>
+
+// std
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+
+namespace ve {
+
+VeUploadManager::VeUploadManager(VeDevice &device)
+    : veDevice{device},
+      timelines{device.timelineSemaphores()},
+      queue{timelines ? device.transferQueue()
+                      : device.graphicsQueue()} {
+    QueueFamilyIndices indices =
+        veDevice.findPhysicalQueueFamilies();
+    queueFamilies.push_back(indices.graphicsFamily);
+
+    // Copies on another queue could only be ordered
+    // against frames with semaphores.
+    if (timelines && indices.transferFamilyHasValue) {
+        queueFamilies.push_back(indices.transferFamily);
+    }
+
+    createCommandPool();
+
+    if (timelines) {
+        uploadTimeline = createTimeline();
+        frameTimeline = createTimeline();
+    }
+}
+
+VeUploadManager::~VeUploadManager() {
+    wait(submitted);
+
+    for (auto &block : pendingBlocks) {
+        destroyBlock(block);
+    }
+
+    for (auto &block : freeBlocks) {
+        destroyBlock(block);
+    }
+
+    for (VkFence fence : freeFences) {
+        vkDestroyFence(veDevice.device(), fence, nullptr);
+    }
+
+    vkDestroySemaphore(veDevice.device(), uploadTimeline,
+                       nullptr);
+    vkDestroySemaphore(veDevice.device(), frameTimeline,
+                       nullptr);
+    vkDestroyCommandPool(veDevice.device(), commandPool,
+                         nullptr);
+}
+
+void VeUploadManager::setSharing(
+    VkBufferCreateInfo &bufferInfo) const {
+    // Concurrent sharing spares the queue family ownership
+    // transfers exclusive resources would need both ways.
+    bool shared = queueFamilies.size() > 1;
+    bufferInfo.sharingMode =
+        shared ? VK_SHARING_MODE_CONCURRENT
+               : VK_SHARING_MODE_EXCLUSIVE;
+    bufferInfo.queueFamilyIndexCount =
+        static_cast<uint32_t>(queueFamilies.size());
+    bufferInfo.pQueueFamilyIndices = queueFamilies.data();
+}
+
+void VeUploadManager::setSharing(
+    VkImageCreateInfo &imageInfo) const {
+    bool shared = queueFamilies.size() > 1;
+    imageInfo.sharingMode =
+        shared ? VK_SHARING_MODE_CONCURRENT
+               : VK_SHARING_MODE_EXCLUSIVE;
+    imageInfo.queueFamilyIndexCount =
+        static_cast<uint32_t>(queueFamilies.size());
+    imageInfo.pQueueFamilyIndices = queueFamilies.data();
+}
+
+void VeUploadManager::createBuffer(
+    const void *data, VkDeviceSize size,
+    VkBufferUsageFlags usage, VkBuffer &buffer,
+    VeAllocation &bufferMemory) {
+    VkBufferCreateInfo bufferInfo{};
+    bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    bufferInfo.size = size;
+    bufferInfo.usage =
+        usage | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+    setSharing(bufferInfo);
+
+    veDevice.createBufferWithInfo(
+        bufferInfo, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+        buffer, bufferMemory);
+
+    memcpy(uploadBuffer(buffer, 0, size), data,
+           static_cast<size_t>(size));
+}
+
+void *VeUploadManager::uploadBuffer(VkBuffer dstBuffer,
+                                    VkDeviceSize dstOffset,
+                                    VkDeviceSize size) {
+    BufferCopy copy{};
+    uint8_t *data = stage(size, copy.src,
+                          copy.region.srcOffset);
+
+    copy.dst = dstBuffer;
+    copy.region.dstOffset = dstOffset;
+    copy.region.size = size;
+    bufferCopies.push_back(copy);
+
+    return data;
+}
+
+void *VeUploadManager::uploadImage(
+    VkImage image, VkOffset3D offset, VkExtent3D extent,
+    VkDeviceSize size, VkImageLayout oldLayout,
+    VkImageLayout newLayout) {
+    VkBuffer source;
+    VkBufferImageCopy region{};
+    uint8_t *data =
+        stage(size, source, region.bufferOffset);
+
+    region.bufferRowLength = 0;
+    region.bufferImageHeight = 0;
+    region.imageSubresource.aspectMask =
+        VK_IMAGE_ASPECT_COLOR_BIT;
+    region.imageSubresource.mipLevel = 0;
+    region.imageSubresource.baseArrayLayer = 0;
+    region.imageSubresource.layerCount = 1;
+    region.imageOffset = offset;
+    region.imageExtent = extent;
+
+    auto copies = std::find_if(
+        imageCopies.begin(), imageCopies.end(),
+        [&](const ImageCopies &c) {
+            return c.image == image;
+        });
+
+    // Only the layout before the first copy of the batch
+    // matters, the image stays in TRANSFER_DST until the
+    // last.
+    if (copies == imageCopies.end()) {
+        imageCopies.push_back(
+            {image, oldLayout, newLayout, {}, {}});
+        copies = imageCopies.end() - 1;
+    }
+
+    copies->newLayout = newLayout;
+    copies->sources.push_back(source);
+    copies->regions.push_back(region);
+
+    return data;
+}
+
+uint64_t VeUploadManager::submit() {
+    collect();
+
+    if (bufferCopies.empty() && imageCopies.empty()) {
+        return submitted;
+    }
+
+    Batch batch;
+    batch.ticket = ++submitted;
+
+    if (!freeCommandBuffers.empty()) {
+        batch.commandBuffer = freeCommandBuffers.back();
+        freeCommandBuffers.pop_back();
+        vkResetCommandBuffer(batch.commandBuffer, 0);
+    } else {
+        VkCommandBufferAllocateInfo allocInfo{};
+        allocInfo.sType =
+            VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+        allocInfo.commandPool = commandPool;
+        allocInfo.commandBufferCount = 1;
+
+        if (vkAllocateCommandBuffers(
+                veDevice.device(), &allocInfo,
+                &batch.commandBuffer) != VK_SUCCESS) {
+            throw std::runtime_error(
+                "failed to allocate upload command buffer");
+        }
+    }
+
+    VkCommandBufferBeginInfo beginInfo{};
+    beginInfo.sType =
+        VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags =
+        VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+    vkBeginCommandBuffer(batch.commandBuffer, &beginInfo);
+    record(batch.commandBuffer);
+    vkEndCommandBuffer(batch.commandBuffer);
+
+    // Frames submitted so far may still read what the
+    // batch overwrites, glyph atlas pixels above all.
+    VkPipelineStageFlags waitStage =
+        VK_PIPELINE_STAGE_TRANSFER_BIT;
+
+    VkTimelineSemaphoreSubmitInfo timelineInfo{};
+    timelineInfo.sType =
+        VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+    timelineInfo.waitSemaphoreValueCount =
+        framesSubmitted > 0 ? 1 : 0;
+    timelineInfo.pWaitSemaphoreValues = &framesSubmitted;
+    timelineInfo.signalSemaphoreValueCount = 1;
+    timelineInfo.pSignalSemaphoreValues = &batch.ticket;
+
+    VkSubmitInfo submitInfo{};
+    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submitInfo.commandBufferCount = 1;
+    submitInfo.pCommandBuffers = &batch.commandBuffer;
+
+    if (timelines) {
+        submitInfo.pNext = &timelineInfo;
+        submitInfo.waitSemaphoreCount =
+            timelineInfo.waitSemaphoreValueCount;
+        submitInfo.pWaitSemaphores = &frameTimeline;
+        submitInfo.pWaitDstStageMask = &waitStage;
+        submitInfo.signalSemaphoreCount = 1;
+        submitInfo.pSignalSemaphores = &uploadTimeline;
+    } else {
+        batch.fence = takeFence();
+    }
+
+    if (vkQueueSubmit(queue, 1, &submitInfo,
+                      batch.fence) != VK_SUCCESS) {
+        throw std::runtime_error(
+            "failed to submit upload batch");
+    }
+
+    batch.blocks.swap(pendingBlocks);
+    pendingUsed = 0;
+    bufferCopies.clear();
+    imageCopies.clear();
+    inFlight.push_back(std::move(batch));
+
+    return submitted;
+}
+
+bool VeUploadManager::isComplete(uint64_t ticket) {
+    collect();
+    return ticket <= completed;
+}
+
+void VeUploadManager::wait(uint64_t ticket) {
+    if (!timelines) {
+        // Tickets are consecutive, so this is the batch of
+        // ticket unless it was collected already.
+        auto batch = std::find_if(
+            inFlight.begin(), inFlight.end(),
+            [&](const Batch &b) {
+                return b.ticket >= ticket;
+            });
+
+        if (batch != inFlight.end() &&
+            batch->ticket == ticket) {
+            vkWaitForFences(
+                veDevice.device(), 1, &batch->fence,
+                VK_TRUE,
+                std::numeric_limits<uint64_t>::max());
+        }
+
+        collect();
+        return;
+    }
+
+    VkSemaphoreWaitInfo waitInfo{};
+    waitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+    waitInfo.semaphoreCount = 1;
+    waitInfo.pSemaphores = &uploadTimeline;
+    waitInfo.pValues = &ticket;
+
+    vkWaitSemaphores(veDevice.device(), &waitInfo,
+                     std::numeric_limits<uint64_t>::max());
+    collect();
+}
+
+FrameSync VeUploadManager::frameSync() {
+    FrameSync sync;
+
+    if (!timelines) {
+        return sync;
+    }
+
+    sync.waitSemaphore = uploadTimeline;
+    sync.waitValue = submitted;
+    sync.waitStages = VK_PIPELINE_STAGE_VERTEX_INPUT_BIT |
+                      VK_PIPELINE_STAGE_VERTEX_SHADER_BIT |
+                      VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+    sync.signalSemaphore = frameTimeline;
+    sync.signalValue = ++framesSubmitted;
+    return sync;
+}
+
+uint8_t *VeUploadManager::stage(VkDeviceSize size,
+                                VkBuffer &buffer,
+                                VkDeviceSize &offset) {
+    // Copy offsets must be a multiple of 4, which also
+    // covers the texel size of every format we upload.
+    VkDeviceSize aligned =
+        (pendingUsed + 3) & ~VkDeviceSize{3};
+
+    if (pendingBlocks.empty() ||
+        aligned + size > pendingBlocks.back().size) {
+        pendingBlocks.push_back(takeBlock(size));
+        aligned = 0;
+    }
+
+    auto &block = pendingBlocks.back();
+    pendingUsed = aligned + size;
+    buffer = block.buffer;
+    offset = aligned;
+
+    return block.mapped + aligned;
+}
+
+VeUploadManager::StagingBlock VeUploadManager::takeBlock(
+    VkDeviceSize size) {
+    if (size <= STAGING_BLOCK_SIZE) {
+        collect();
+
+        if (!freeBlocks.empty()) {
+            StagingBlock block = freeBlocks.back();
+            freeBlocks.pop_back();
+            return block;
+        }
+    }
+
+    StagingBlock block;
+    block.size = std::max(size, STAGING_BLOCK_SIZE);
+
+    veDevice.createBuffer(
+        block.size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+            VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+        block.buffer, block.memory);
+
+    block.mapped =
+        static_cast<uint8_t *>(block.memory.mapped);
+    stagingBytes += block.size;
+
+    return block;
+}
+
+void VeUploadManager::destroyBlock(StagingBlock &block) {
+    vkDestroyBuffer(veDevice.device(), block.buffer,
+                    nullptr);
+    veDevice.freeMemory(block.memory);
+    stagingBytes -= block.size;
+    block = {};
+}
+
+void VeUploadManager::collect() {
+    if (inFlight.empty()) {
+        return;
+    }
+
+    uint64_t reached = 0;
+
+    if (timelines) {
+        vkGetSemaphoreCounterValue(
+            veDevice.device(), uploadTimeline, &reached);
+    }
+
+    // Batches go to a single queue, so they finish in
+    // order.
+    while (!inFlight.empty()) {
+        Batch &batch = inFlight.front();
+
+        bool done =
+            timelines ? batch.ticket <= reached
+                      : vkGetFenceStatus(veDevice.device(),
+                                         batch.fence) ==
+                            VK_SUCCESS;
+
+        if (!done) {
+            break;
+        }
+
+        for (auto &block : batch.blocks) {
+            // Keep the standard blocks around, one off
+            // large ones would only hoard memory.
+            if (block.size == STAGING_BLOCK_SIZE) {
+                freeBlocks.push_back(block);
+            } else {
+                destroyBlock(block);
+            }
+        }
+
+        freeCommandBuffers.push_back(batch.commandBuffer);
+
+        if (batch.fence != VK_NULL_HANDLE) {
+            freeFences.push_back(batch.fence);
+        }
+
+        completed = batch.ticket;
+        inFlight.pop_front();
+    }
+}
+
+void VeUploadManager::record(
+    VkCommandBuffer commandBuffer) {
+    // Stages frames read uploads in.
+    const VkPipelineStageFlags readStages =
+        VK_PIPELINE_STAGE_VERTEX_INPUT_BIT |
+        VK_PIPELINE_STAGE_VERTEX_SHADER_BIT |
+        VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+    const VkAccessFlags readAccess =
+        VK_ACCESS_INDEX_READ_BIT |
+        VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT |
+        VK_ACCESS_UNIFORM_READ_BIT |
+        VK_ACCESS_SHADER_READ_BIT;
+
+    std::vector<VkImageMemoryBarrier> barriers;
+
+    for (const auto &copies : imageCopies) {
+        VkImageMemoryBarrier barrier{};
+        barrier.sType =
+            VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+        barrier.oldLayout = copies.oldLayout;
+        barrier.newLayout =
+            VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        barrier.srcQueueFamilyIndex =
+            VK_QUEUE_FAMILY_IGNORED;
+        barrier.dstQueueFamilyIndex =
+            VK_QUEUE_FAMILY_IGNORED;
+        barrier.image = copies.image;
+        barrier.subresourceRange.aspectMask =
+            VK_IMAGE_ASPECT_COLOR_BIT;
+        barrier.subresourceRange.baseMipLevel = 0;
+        barrier.subresourceRange.levelCount = 1;
+        barrier.subresourceRange.baseArrayLayer = 0;
+        barrier.subresourceRange.layerCount = 1;
+        barrier.srcAccessMask = 0;
+        barrier.dstAccessMask =
+            VK_ACCESS_TRANSFER_WRITE_BIT;
+        barriers.push_back(barrier);
+    }
+
+    // Chains to the wait for earlier frames, which is at
+    // the transfer stage. A transfer queue has no shader
+    // stages to name. On the graphics queue, without
+    // timelines, the barrier waits for the frames itself,
+    // buffer copies included.
+    if (!timelines) {
+        vkCmdPipelineBarrier(
+            commandBuffer, readStages,
+            VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr,
+            0, nullptr,
+            static_cast<uint32_t>(barriers.size()),
+            barriers.data());
+    } else if (!barriers.empty()) {
+        vkCmdPipelineBarrier(
+            commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT,
+            VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr,
+            0, nullptr,
+            static_cast<uint32_t>(barriers.size()),
+            barriers.data());
+    }
+
+    // Runs of copies between the same pair of buffers go
+    // into a single command.
+    std::vector<VkBufferCopy> regions;
+
+    for (size_t i = 0; i < bufferCopies.size();) {
+        size_t end = i;
+        regions.clear();
+
+        while (end < bufferCopies.size() &&
+               bufferCopies[end].src == bufferCopies[i].src &&
+               bufferCopies[end].dst == bufferCopies[i].dst) {
+            regions.push_back(bufferCopies[end].region);
+            end++;
+        }
+
+        vkCmdCopyBuffer(
+            commandBuffer, bufferCopies[i].src,
+            bufferCopies[i].dst,
+            static_cast<uint32_t>(regions.size()),
+            regions.data());
+        i = end;
+    }
+
+    for (const auto &copies : imageCopies) {
+        for (size_t i = 0; i < copies.regions.size();) {
+            size_t end = i;
+
+            while (end < copies.regions.size() &&
+                   copies.sources[end] == copies.sources[i]) {
+                end++;
+            }
+
+            vkCmdCopyBufferToImage(
+                commandBuffer, copies.sources[i],
+                copies.image,
+                VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                static_cast<uint32_t>(end - i),
+                copies.regions.data() + i);
+            i = end;
+        }
+    }
+
+    if (timelines && barriers.empty()) {
+        return;
+    }
+
+    for (size_t i = 0; i < imageCopies.size(); i++) {
+        barriers[i].oldLayout =
+            VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        barriers[i].newLayout = imageCopies[i].newLayout;
+        barriers[i].srcAccessMask =
+            VK_ACCESS_TRANSFER_WRITE_BIT;
+        barriers[i].dstAccessMask =
+            timelines ? 0 : readAccess;
+    }
+
+    if (timelines) {
+        // Only the layout transitions, the frames waiting
+        // on the ticket see the writes through the
+        // semaphore.
+        vkCmdPipelineBarrier(
+            commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT,
+            VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0,
+            nullptr, 0, nullptr,
+            static_cast<uint32_t>(barriers.size()),
+            barriers.data());
+        return;
+    }
+
+    // Makes the writes visible to the frames submitted
+    // after the batch.
+    VkMemoryBarrier memoryBarrier{};
+    memoryBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    memoryBarrier.srcAccessMask =
+        VK_ACCESS_TRANSFER_WRITE_BIT;
+    memoryBarrier.dstAccessMask = readAccess;
+
+    vkCmdPipelineBarrier(
+        commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT,
+        readStages, 0, 1, &memoryBarrier, 0, nullptr,
+        static_cast<uint32_t>(barriers.size()),
+        barriers.data());
+}
+
+void VeUploadManager::createCommandPool() {
+    VkCommandPoolCreateInfo poolInfo = {};
+    poolInfo.sType =
+        VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    poolInfo.queueFamilyIndex = queueFamilies.back();
+    poolInfo.flags =
+        VK_COMMAND_POOL_CREATE_TRANSIENT_BIT |
+        VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+
+    if (vkCreateCommandPool(veDevice.device(), &poolInfo,
+                            nullptr,
+                            &commandPool) != VK_SUCCESS) {
+        throw std::runtime_error(
+            "failed to create upload command pool");
+    }
+}
+
+VkSemaphore VeUploadManager::createTimeline() {
+    VkSemaphoreTypeCreateInfo typeInfo{};
+    typeInfo.sType =
+        VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+    typeInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+    typeInfo.initialValue = 0;
+
+    VkSemaphoreCreateInfo semaphoreInfo{};
+    semaphoreInfo.sType =
+        VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+    semaphoreInfo.pNext = &typeInfo;
+
+    VkSemaphore semaphore;
+
+    if (vkCreateSemaphore(veDevice.device(), &semaphoreInfo,
+                          nullptr,
+                          &semaphore) != VK_SUCCESS) {
+        throw std::runtime_error(
+            "failed to create upload timeline");
+    }
+
+    return semaphore;
+}
+
+VkFence VeUploadManager::takeFence() {
+    if (!freeFences.empty()) {
+        VkFence fence = freeFences.back();
+        freeFences.pop_back();
+        vkResetFences(veDevice.device(), 1, &fence);
+        return fence;
+    }
+
+    VkFenceCreateInfo fenceInfo{};
+    fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+
+    VkFence fence;
+
+    if (vkCreateFence(veDevice.device(), &fenceInfo,
+                      nullptr, &fence) != VK_SUCCESS) {
+        throw std::runtime_error(
+            "failed to create upload fence");
+    }
+
+    return fence;
+}
+
+}  // namespace ve
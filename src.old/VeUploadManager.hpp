@@ -0,0 +1,177 @@
+#pragma once
+
+#include <vulkan/vulkan_core.h>
+
+#include "VeDevice.hpp"
+#include "VeSwapChain.hpp"
+
+// std
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+namespace ve {
+
+// Fills device local buffers and images through host
+// visible staging memory.
+//
+// Uploads hand out a pointer into staging memory for the
+// caller to write and queue the copy. submit records every
+// queued copy into one command buffer with one set of
+// barriers and submits it to the transfer queue, without
+// waiting. It returns a ticket, the value the batch
+// signals on a timeline semaphore, and a frame using the
+// data waits on the GPU for just that value. Batches in
+// turn wait for the frames submitted before them, which
+// may still read what they overwrite.
+//
+// With a dedicated transfer family the copies run beside
+// rendering. Resources uploads write are then shared by
+// both families, see setSharing. Staging memory and command
+// buffers are recycled once a batch's value is reached, so
+// steady state uploads allocate nothing.
+//
+// Devices without timeline semaphores submit batches to
+// the graphics queue instead, each with a fence. Barriers
+// in the batch order it against the frames around it, and
+// frameSync has nothing to add.
+class VeUploadManager {
+   public:
+    // Staging memory is carved out of blocks of this size,
+    // larger uploads get a block of their own.
+    static constexpr VkDeviceSize STAGING_BLOCK_SIZE = 4
+                                                      << 20;
+
+    explicit VeUploadManager(VeDevice &device);
+    ~VeUploadManager();
+
+    VeUploadManager(const VeUploadManager &) = delete;
+    VeUploadManager &operator=(const VeUploadManager &) =
+        delete;
+
+    // Sets sharingMode and the queue families of a buffer
+    // or image for uploads to write and frames to read.
+    void setSharing(VkBufferCreateInfo &bufferInfo) const;
+    void setSharing(VkImageCreateInfo &imageInfo) const;
+
+    // Creates a device local buffer with the given usage
+    // and queues data to be copied into it.
+    void createBuffer(const void *data, VkDeviceSize size,
+                      VkBufferUsageFlags usage,
+                      VkBuffer &buffer,
+                      VeAllocation &bufferMemory);
+
+    // Returns size bytes of staging memory to be copied to
+    // dstBuffer at dstOffset. dstBuffer needs
+    // VK_BUFFER_USAGE_TRANSFER_DST_BIT.
+    void *uploadBuffer(VkBuffer dstBuffer,
+                       VkDeviceSize dstOffset,
+                       VkDeviceSize size);
+
+    // Returns staging memory for a tightly packed single
+    // channel or other texel region to be copied into the
+    // first layer of image. The image is moved from
+    // oldLayout, its layout before this batch, to
+    // newLayout once all of the batch's copies are done.
+    void *uploadImage(VkImage image, VkOffset3D offset,
+                      VkExtent3D extent, VkDeviceSize size,
+                      VkImageLayout oldLayout,
+                      VkImageLayout newLayout);
+
+    // Submits everything queued since the last submit and
+    // returns its ticket, or the last batch's if nothing
+    // was queued.
+    uint64_t submit();
+
+    // Whether the GPU finished the batch of ticket.
+    bool isComplete(uint64_t ticket);
+    void wait(uint64_t ticket);
+
+    // Semaphores of the next frame: it waits for the last
+    // ticket and signals the value later batches wait for.
+    // Only to be called for a frame that is submitted.
+    FrameSync frameSync();
+
+    uint64_t batchCount() const {
+        return submitted;
+    }
+    // Bytes of staging memory owned, in use or not.
+    VkDeviceSize stagingSize() const {
+        return stagingBytes;
+    }
+
+   private:
+    struct StagingBlock {
+        VkBuffer buffer = VK_NULL_HANDLE;
+        VeAllocation memory;
+        uint8_t *mapped = nullptr;
+        VkDeviceSize size = 0;
+    };
+
+    struct BufferCopy {
+        VkBuffer src;
+        VkBuffer dst;
+        VkBufferCopy region;
+    };
+
+    struct ImageCopies {
+        VkImage image;
+        VkImageLayout oldLayout;
+        VkImageLayout newLayout;
+        // Parallel arrays, copies are grouped by source
+        // when recorded.
+        std::vector<VkBuffer> sources;
+        std::vector<VkBufferImageCopy> regions;
+    };
+
+    struct Batch {
+        uint64_t ticket;
+        VkCommandBuffer commandBuffer;
+        // Only without timeline semaphores.
+        VkFence fence = VK_NULL_HANDLE;
+        std::vector<StagingBlock> blocks;
+    };
+
+    // Returns size bytes of staging memory, 4 byte aligned
+    // as copies require, and the buffer and offset they
+    // sit at.
+    uint8_t *stage(VkDeviceSize size, VkBuffer &buffer,
+                   VkDeviceSize &offset);
+    StagingBlock takeBlock(VkDeviceSize size);
+    void destroyBlock(StagingBlock &block);
+    // Recycles the resources of finished batches.
+    void collect();
+    void record(VkCommandBuffer commandBuffer);
+    void createCommandPool();
+    VkSemaphore createTimeline();
+    VkFence takeFence();
+
+    VeDevice &veDevice;
+    bool timelines;
+    VkQueue queue;
+    VkCommandPool commandPool;
+    // Graphics and transfer, if they differ.
+    std::vector<uint32_t> queueFamilies;
+    // Signalled with tickets.
+    VkSemaphore uploadTimeline = VK_NULL_HANDLE;
+    // Signalled by frames with framesSubmitted.
+    VkSemaphore frameTimeline = VK_NULL_HANDLE;
+
+    // Staging being filled for the next batch.
+    std::vector<StagingBlock> pendingBlocks;
+    VkDeviceSize pendingUsed = 0;
+    std::vector<BufferCopy> bufferCopies;
+    std::vector<ImageCopies> imageCopies;
+
+    std::deque<Batch> inFlight;
+    std::vector<StagingBlock> freeBlocks;
+    std::vector<VkCommandBuffer> freeCommandBuffers;
+    std::vector<VkFence> freeFences;
+
+    uint64_t submitted = 0;
+    uint64_t completed = 0;
+    uint64_t framesSubmitted = 0;
+    VkDeviceSize stagingBytes = 0;
+};
+
+}  // namespace ve
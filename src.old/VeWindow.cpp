@@ -2,6 +2,8 @@
 
 #include <vulkan/vulkan_core.h>
 
+// std
+#include <cmath>
 #include <stdexcept>
 
 namespace ve {
@@ -41,6 +43,21 @@ void VeWindow::initWindow() {
     glfwSetWindowUserPointer(window, this);
     glfwSetFramebufferSizeCallback(
         window, framebufferResizeCallback);
+    glfwSetWindowRefreshCallback(window, refreshCallback);
+    glfwSetKeyCallback(window, keyCallback);
+    glfwSetCharCallback(window, charCallback);
+    glfwSetScrollCallback(window, scrollCallback);
+    glfwSetWindowFocusCallback(window, focusCallback);
+}
+
+void VeWindow::waitEvents(double timeout) const {
+    if (timeout <= 0.0) {
+        glfwPollEvents();
+    } else if (std::isinf(timeout)) {
+        glfwWaitEvents();
+    } else {
+        glfwWaitEventsTimeout(timeout);
+    }
 }
 
 void VeWindow::createWindowSurface(VkInstance instance,
@@ -62,4 +79,64 @@ void VeWindow::framebufferResizeCallback(GLFWwindow* window,
     veWindow->height = height;
 }
 
+void VeWindow::refreshCallback(GLFWwindow* window) {
+    auto veWindow = reinterpret_cast<VeWindow*>(
+        glfwGetWindowUserPointer(window));
+    veWindow->windowDamaged = true;
+}
+
+void VeWindow::keyCallback(GLFWwindow* window, int key,
+                           int scancode, int action,
+                           int mods) {
+    if (action == GLFW_RELEASE) {
+        return;
+    }
+
+    auto veWindow = reinterpret_cast<VeWindow*>(
+        glfwGetWindowUserPointer(window));
+    InputEvent event{InputEvent::Type::Key};
+    event.key = key;
+    event.mods = mods;
+    event.time = glfwGetTime();
+    veWindow->inputEvents.push_back(event);
+}
+
+void VeWindow::charCallback(GLFWwindow* window,
+                            unsigned int codepoint) {
+    auto veWindow = reinterpret_cast<VeWindow*>(
+        glfwGetWindowUserPointer(window));
+    InputEvent event{InputEvent::Type::Char};
+    event.codepoint = codepoint;
+    event.time = glfwGetTime();
+    veWindow->inputEvents.push_back(event);
+}
+
+void VeWindow::scrollCallback(GLFWwindow* window,
+                              double xoffset,
+                              double yoffset) {
+    auto veWindow = reinterpret_cast<VeWindow*>(
+        glfwGetWindowUserPointer(window));
+    InputEvent event{InputEvent::Type::Scroll};
+    event.scroll = yoffset;
+    // GLFW doesn't pass modifiers with scrolling.
+    if (glfwGetKey(window, GLFW_KEY_LEFT_CONTROL) ==
+            GLFW_PRESS ||
+        glfwGetKey(window, GLFW_KEY_RIGHT_CONTROL) ==
+            GLFW_PRESS) {
+        event.mods = GLFW_MOD_CONTROL;
+    }
+    event.time = glfwGetTime();
+    veWindow->inputEvents.push_back(event);
+}
+
+void VeWindow::focusCallback(GLFWwindow* window,
+                             int focused) {
+    auto veWindow = reinterpret_cast<VeWindow*>(
+        glfwGetWindowUserPointer(window));
+    InputEvent event{InputEvent::Type::Focus};
+    event.focused = focused == GLFW_TRUE;
+    event.time = glfwGetTime();
+    veWindow->inputEvents.push_back(event);
+}
+
 }  // namespace ve
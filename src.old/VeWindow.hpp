@@ -5,9 +5,27 @@
 #include <GLFW/glfw3.h>
 
 #include <iostream>
+#include <vector>
 
 namespace ve {
 
+// Input received since the application last looked.
+struct InputEvent {
+    enum class Type { Key, Char, Scroll, Focus };
+
+    Type type;
+    // GLFW key and modifiers, for Key. Scroll only has
+    // GLFW_MOD_CONTROL.
+    int key = 0;
+    int mods = 0;
+    char32_t codepoint = 0;
+    // Lines, positive towards the top of the file.
+    double scroll = 0.0;
+    bool focused = false;
+    // glfwGetTime() when the event arrived.
+    double time = 0.0;
+};
+
 class VeWindow {
    public:
     VeWindow(unsigned int w, unsigned int h,
@@ -30,6 +48,16 @@ class VeWindow {
         framebufferResized = false;
     }
 
+    // Set when the window system lost the window contents
+    // and they have to be drawn again.
+    bool wasWindowDamaged() const {
+        return windowDamaged;
+    }
+
+    void resetWindowDamagedFlag() {
+        windowDamaged = false;
+    }
+
     VkExtent2D getExtent() {
         return {static_cast<uint32_t>(width),
                 static_cast<uint32_t>(height)};
@@ -42,14 +70,38 @@ class VeWindow {
         glfwPollEvents();
     }
 
+    // Blocks until there are events or timeout seconds
+    // passed. A timeout of zero only polls, an infinite one
+    // waits for events alone.
+    void waitEvents(double timeout) const;
+
+    std::vector<InputEvent> takeInputEvents() {
+        std::vector<InputEvent> events;
+        events.swap(inputEvents);
+        return events;
+    }
+
    private:
     static void framebufferResizeCallback(
         GLFWwindow* window, int width, int height);
+    static void refreshCallback(GLFWwindow* window);
+    static void keyCallback(GLFWwindow* window, int key,
+                            int scancode, int action,
+                            int mods);
+    static void charCallback(GLFWwindow* window,
+                             unsigned int codepoint);
+    static void scrollCallback(GLFWwindow* window,
+                               double xoffset,
+                               double yoffset);
+    static void focusCallback(GLFWwindow* window,
+                              int focused);
     void initWindow();
 
     int width;
     int height;
     bool framebufferResized = false;
+    bool windowDamaged = false;
+    std::vector<InputEvent> inputEvents;
 
     std::string windowName;
     GLFWwindow* window = nullptr;
@@ -444,7 +444,10 @@ class Application {
 
     void mainLoop() {
         while (!glfwWindowShouldClose(window)) {
-            glfwPollEvents();
+            // Nothing is drawn yet, so there is no reason to
+            // wake up other than events and checking for
+            // Ctrl+C now and then.
+            glfwWaitEventsTimeout(0.1);
 
             if (gSignalStatus == SIGINT) {
                 glfwSetWindowShouldClose(window, GLFW_TRUE);
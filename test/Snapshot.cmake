@@ -0,0 +1,46 @@
+# Runs editor --snapshot and compares its image with the
+# golden one, see test/CMakeLists.txt.
+#
+#   cmake -DEDITOR=... -DFONT=... -DTEXT=... -DGOLDEN=...
+#     -DOUTPUT=... -P Snapshot.cmake
+
+if(NOT EXISTS "${FONT}")
+  message("SKIP: DejaVu Sans Mono is not installed")
+  return()
+endif()
+
+execute_process(
+  COMMAND ${CMAKE_COMMAND} -E env EDITOR_FONT=${FONT}
+    ${EDITOR} --snapshot ${OUTPUT} ${TEXT}
+  RESULT_VARIABLE RESULT
+  ERROR_VARIABLE ERROR
+)
+
+# See EXIT_NO_DEVICE in Editor.cpp.
+if(RESULT EQUAL 77)
+  message("SKIP: no Vulkan device")
+  return()
+elseif(NOT RESULT EQUAL 0)
+  message(FATAL_ERROR "editor --snapshot failed: ${ERROR}")
+endif()
+
+if("$ENV{SNAPSHOT_BLESS}")
+  file(COPY_FILE ${OUTPUT} ${GOLDEN})
+  message("updated ${GOLDEN}")
+  return()
+endif()
+
+if(NOT EXISTS "${GOLDEN}")
+  message(FATAL_ERROR "no golden image ${GOLDEN}, render "
+    "one with the snapshot_bless target")
+endif()
+
+execute_process(
+  COMMAND ${CMAKE_COMMAND} -E compare_files ${OUTPUT}
+    ${GOLDEN}
+  RESULT_VARIABLE DIFFERENT
+)
+
+if(DIFFERENT)
+  message(FATAL_ERROR "${OUTPUT} differs from ${GOLDEN}")
+endif()